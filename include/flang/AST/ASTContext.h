@@ -17,8 +17,12 @@
 #include "flang/AST/Decl.h"
 #include "flang/AST/Type.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/AlignOf.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/SourceMgr.h"
+#include <memory>
 #include <new>
 #include <set>
 #include <vector>
@@ -31,6 +35,7 @@ namespace llvm {
 namespace flang {
 
 class StoredDeclsMap;
+class IntegerConstantExpr;
 
 // Decls
 class DeclContext;
@@ -39,17 +44,80 @@ class RecordDecl;
 class TypeDecl;
 class TargetInfo;
 
+/// OptionalScopedLock - Holds the lock of a mutex for its lifetime when
+/// Enabled is true, and does nothing otherwise.
+class OptionalScopedLock {
+  llvm::sys::Mutex *M;
+public:
+  OptionalScopedLock(llvm::sys::Mutex &Mtx, bool Enabled)
+    : M(Enabled? &Mtx : nullptr) {
+    if(M) M->lock();
+  }
+  ~OptionalScopedLock() {
+    if(M) M->unlock();
+  }
+};
+
+/// ShardedFoldingSet - A folding set which can be used by several threads at
+/// the same time. The nodes are split into shards by the hash of their
+/// profile, and every shard has its own lock, so the threads which unique
+/// different nodes rarely wait for each other. The shard is only locked
+/// when \p Concurrent is true, so a single thread doesn't pay for the locks.
+template<typename T>
+class ShardedFoldingSet {
+  enum { NumShardBits = 4, NumShards = 1 << NumShardBits };
+
+  struct Shard {
+    llvm::sys::Mutex Lock;
+    llvm::FoldingSet<T> Nodes;
+  };
+  mutable Shard Shards[NumShards];
+
+  Shard &getShard(const llvm::FoldingSetNodeID &ID) const {
+    // The high bits are used, as a folding set picks its buckets using
+    // the low bits of the hash.
+    return Shards[ID.ComputeHash() >> (32 - NumShardBits)];
+  }
+
+public:
+  /// find - Returns the node with the given profile, or null if there's none.
+  T *find(const llvm::FoldingSetNodeID &ID, bool Concurrent) const {
+    auto &S = getShard(ID);
+    OptionalScopedLock Lock(S.Lock, Concurrent);
+    void *InsertPos = 0;
+    return S.Nodes.FindNodeOrInsertPos(ID, InsertPos);
+  }
+
+  /// getOrInsert - Returns the node with the given profile, or inserts the
+  /// node returned by \p Create if there's none. \p Create is called while
+  /// the shard is locked, so it must not use this set.
+  template<typename CreateFn>
+  T *getOrInsert(const llvm::FoldingSetNodeID &ID, bool Concurrent,
+                 CreateFn Create) const {
+    auto &S = getShard(ID);
+    OptionalScopedLock Lock(S.Lock, Concurrent);
+    void *InsertPos = 0;
+    if (T *Node = S.Nodes.FindNodeOrInsertPos(ID, InsertPos))
+      return Node;
+    T *Node = Create();
+    S.Nodes.InsertNode(Node, InsertPos);
+    return Node;
+  }
+};
+
 class ASTContext : public llvm::RefCountedBase<ASTContext> {
   ASTContext &this_() { return *this; }
 
   mutable std::vector<Type*>            Types;
-  mutable llvm::FoldingSet<ExtQuals>    ExtQualNodes;
-  mutable llvm::FoldingSet<BuiltinType> BuiltinTypes;
-  mutable llvm::FoldingSet<CharacterType> CharTypes;
-  mutable llvm::FoldingSet<PointerType> PointerTypes;
-  mutable llvm::FoldingSet<ArrayType>   ArrayTypes;
-  mutable llvm::FoldingSet<RecordType>  RecordTypes;
-  mutable llvm::FoldingSet<FunctionType> FunctionTypes;
+  mutable llvm::sys::Mutex              TypesLock;
+  ShardedFoldingSet<ExtQuals>           ExtQualNodes;
+  ShardedFoldingSet<BuiltinType>        BuiltinTypes;
+  ShardedFoldingSet<CharacterType>      CharTypes;
+  ShardedFoldingSet<PointerType>        PointerTypes;
+  ShardedFoldingSet<FunctionType>       FunctionTypes;
+
+  /// \brief Serializes the creation of the record types.
+  mutable llvm::sys::Mutex              RecordTypesLock;
 
   /// \brief The allocator used to create AST objects.
   ///
@@ -57,6 +125,19 @@ class ASTContext : public llvm::RefCountedBase<ASTContext> {
   /// AST objects will be released when the ASTContext itself is destroyed.
   mutable llvm::BumpPtrAllocator BumpAlloc;
 
+  /// \brief The allocators which are used instead of BumpAlloc in the
+  /// concurrent access mode, one per thread, so that the threads don't have
+  /// to synchronize their allocations.
+  mutable std::vector<std::unique_ptr<llvm::BumpPtrAllocator>> ThreadAllocators;
+  mutable llvm::sys::Mutex ThreadAllocatorsLock;
+  mutable llvm::sys::ThreadLocal<llvm::BumpPtrAllocator> ThreadAllocator;
+
+  /// \brief Returns the allocator of the current thread.
+  llvm::BumpPtrAllocator &getThreadAllocator() const;
+
+  /// \brief Records a newly created type.
+  void addType(Type *T) const;
+
   TranslationUnitDecl *TUDecl;
 
   /// SrcMgr - The associated SourceMgr object.
@@ -70,6 +151,11 @@ class ASTContext : public llvm::RefCountedBase<ASTContext> {
 
   const TargetInfo *Target;
 
+  /// \brief The shared locationless integer constants 0 and 1.
+  IntegerConstantExpr *IntegerConstants[2];
+
+  bool ConcurrentAccess;
+
 public:
   ASTContext(llvm::SourceMgr &SM, LangOptions LangOpts);
   ~ASTContext();
@@ -82,12 +168,42 @@ public:
   const llvm::SourceMgr &getSourceManager() const { return SrcMgr; }
 
   void *Allocate(unsigned Size, unsigned Align = 8) const {
+    if(ConcurrentAccess)
+      return getThreadAllocator().Allocate(Size, Align);
     return BumpAlloc.Allocate(Size, Align);
   }
   void Deallocate(void *Ptr, size_t size) const {
-    BumpAlloc.Deallocate((const void*) Ptr, size);
+    if(!ConcurrentAccess)
+      BumpAlloc.Deallocate((const void*) Ptr, size);
+  }
+
+  /// \brief Enables or disables the concurrent access mode, in which every
+  /// thread allocates the AST nodes from its own arena, so that several
+  /// threads can use the context at the same time (e.g. the parallel code
+  /// generation). The types are uniqued in the same way in both modes, but
+  /// their tables are only locked in the concurrent mode. This must not be
+  /// changed while other threads are using the context.
+  void setConcurrentAccess(bool Value) { ConcurrentAccess = Value; }
+  bool hasConcurrentAccess() const { return ConcurrentAccess; }
+
+  /// \brief Allocates the memory for an AST node which is immediately
+  /// followed by the given number of trailing objects.
+  template<typename NodeT, typename TrailingT>
+  void *AllocateWithTrailing(unsigned NumTrailing) const {
+    return Allocate(sizeof(NodeT) + NumTrailing * sizeof(TrailingT),
+                    llvm::alignOf<NodeT>());
   }
 
+  /// \brief Returns an integer constant without a source location. The
+  /// constants 0 and 1 are created once and shared by all their users.
+  IntegerConstantExpr *getIntegerConstant(int64_t Value);
+
+  /// \brief Returns the number of bytes allocated by the AST allocators.
+  size_t getASTAllocatedMemory() const;
+
+  /// PrintStats - Print the number and the size of the allocated AST nodes.
+  void PrintStats() const;
+
   const LangOptions& getLangOpts() const { return LanguageOptions; }
 
   // Builtin Types: [R404]
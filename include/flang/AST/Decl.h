@@ -140,7 +140,8 @@ protected:
     : NextDeclInContext(0), DeclCtx(DC), Loc(L), DeclKind(DK),
       InvalidDecl(false), HasAttrs(false), Implicit(false),
       ImplicitType(0),
-      SubDeclKind(0) {}
+      SubDeclKind(0), CustomBoolAttr1(0), CustomBoolAttr2(0),
+      CustomBoolAttr3(0), CustomBoolAttr4(0) {}
 
   virtual ~Decl();
 
@@ -990,6 +991,11 @@ public:
     Storage = S;
   }
 
+  /// \brief Returns true if every thread gets its own copy of
+  /// this variable (THREADPRIVATE).
+  bool isThreadPrivate() const { return CustomBoolAttr1 != 0; }
+  void setThreadPrivate(bool V = true) { CustomBoolAttr1 = V; }
+
   // Implement isa/cast/dyncast/etc.
   static bool classof(const Decl *D) { return classofKind(D->getKind()); }
   static bool classof(const VarDecl *D) { return true; }
@@ -1023,6 +1029,11 @@ public:
     Set = S;
   }
 
+  /// \brief Returns true if every thread gets its own copy of
+  /// this common block (THREADPRIVATE).
+  bool isThreadPrivate() const { return CustomBoolAttr1 != 0; }
+  void setThreadPrivate(bool V = true) { CustomBoolAttr1 = V; }
+
   static bool classof(const Decl *D) { return classofKind(D->getKind()); }
   static bool classof(const CommonBlockDecl *D) { return true; }
   static bool classofKind(Kind K) { return K == CommonBlock; }
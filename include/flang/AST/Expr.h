@@ -23,6 +23,7 @@
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/StringRef.h"
 #include "flang/Basic/LLVM.h"
+#include <algorithm>
 
 namespace flang {
 
@@ -51,12 +52,17 @@ public:
 
 private:
   QualType Ty;
-  ExprClass ExprID;
   SourceLocation Loc;
+  /// The class is stored last so that the subclasses can place
+  /// their small members into the tail padding of an Expr.
+  unsigned ExprID : 8;
   friend class ASTContext;
+
+  static bool StatisticsEnabled;
 protected:
-  Expr(ExprClass ET, QualType T, SourceLocation L) : ExprID(ET), Loc(L) {
+  Expr(ExprClass ET, QualType T, SourceLocation L) : Loc(L), ExprID(ET) {
     setType(T);
+    if(StatisticsEnabled) addExprClass(ET);
   }
   //virtual ~Expr() {}
 
@@ -64,7 +70,7 @@ public:
   QualType getType() const { return Ty; }
   void setType(QualType T) { Ty = T; }
 
-  ExprClass getExprClass() const { return ExprID; }
+  ExprClass getExprClass() const { return ExprClass(ExprID); }
   SourceLocation getLocation() const { return Loc; }
 
   SourceLocation getLocStart() const { return Loc; }
@@ -95,23 +101,54 @@ public:
   void dump() const;
   void dump(llvm::raw_ostream &OS) const;
 
+  // Statistics
+  static void addExprClass(ExprClass C);
+  static void EnableStatistics();
+  static void PrintStats(llvm::raw_ostream &OS);
+
   static bool classof(const Expr *) { return true; }
 };
 
 /// An expression with multiple arguments.
+/// A single argument is stored inline, and the other numbers of arguments
+/// are stored in the trailing memory which is allocated together with the
+/// node of the class Derived, see ASTContext::AllocateWithTrailing.
+template<typename Derived>
 class MultiArgumentExpr {
 private:
   unsigned NumArguments;
-  union {
-    Expr **Arguments;
-    Expr *Argument;
-  };
-public:
-  MultiArgumentExpr(ASTContext &C, ArrayRef<Expr*> Args);
+  Expr *Argument;
 
+  Expr **getTrailingArguments() const {
+    return reinterpret_cast<Expr**>(
+             const_cast<Derived*>(static_cast<const Derived*>(this)) + 1);
+  }
+protected:
+  MultiArgumentExpr(ArrayRef<Expr*> Args)
+    : NumArguments(Args.size()), Argument(nullptr) {
+    if(NumArguments == 1)
+      Argument = Args[0];
+    else
+      std::copy(Args.begin(), Args.end(), getTrailingArguments());
+  }
+
+  /// \brief Returns the number of the arguments which are stored in the
+  /// trailing memory of a node with the given number of arguments.
+  static unsigned getNumTrailingArguments(unsigned N) {
+    return N == 1? 0 : N;
+  }
+
+  void setArgument(unsigned I, Expr *E) {
+    assert(I < NumArguments);
+    if(NumArguments == 1)
+      Argument = E;
+    else
+      getTrailingArguments()[I] = E;
+  }
+public:
   ArrayRef<Expr*> getArguments() const {
     return NumArguments == 1? ArrayRef<Expr*>(Argument) :
-                              ArrayRef<Expr*>(Arguments,NumArguments);
+                              ArrayRef<Expr*>(getTrailingArguments(), NumArguments);
   }
 };
 
@@ -215,9 +252,9 @@ public:
                                      StringRef Data);
   static IntegerConstantExpr *Create(ASTContext &C, SourceRange Range,
                                      APInt Value);
-  static IntegerConstantExpr *Create(ASTContext &C, int64_t Value) {
-    return Create(C, SourceRange(), APInt(64, Value, true));
-  }
+  /// \brief Returns an integer constant without a source location.
+  /// The common constants are shared, see ASTContext::getIntegerConstant.
+  static IntegerConstantExpr *Create(ASTContext &C, int64_t Value);
 
   APInt getValue() const { return Num.getValue(); }
 
@@ -442,7 +479,8 @@ public:
 
 //===----------------------------------------------------------------------===//
 /// ArrayElementExpr - Returns an element of an array.
-class ArrayElementExpr : public DesignatorExpr, public MultiArgumentExpr {
+class ArrayElementExpr : public DesignatorExpr,
+                         public MultiArgumentExpr<ArrayElementExpr> {
 
   ArrayElementExpr(ASTContext &C, SourceLocation Loc, Expr *E,
                    ArrayRef<Expr*> Subs);
@@ -469,7 +507,8 @@ public:
 
 //===----------------------------------------------------------------------===//
 /// ArraySectionExpr - Returns a section of an array.
-class ArraySectionExpr : public DesignatorExpr, public MultiArgumentExpr {
+class ArraySectionExpr : public DesignatorExpr,
+                         public MultiArgumentExpr<ArraySectionExpr> {
 
   ArraySectionExpr(ASTContext &C, SourceLocation Loc, Expr *E,
                    ArrayRef<Expr*> Subscripts, QualType T);
@@ -586,7 +625,9 @@ public:
   virtual const Expr *getUpperBoundOrNull() const { return nullptr; }
 
   /// Returns true if the bounds of this dimension specification are constants.
-  virtual bool Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx) const;
+  /// The scope can associate the variables in the bounds with values.
+  virtual bool Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx,
+                        const ExprEvalScope *Scope = nullptr) const;
 
   static bool classof(const ArraySpec *) { return true; }
 };
@@ -615,7 +656,8 @@ public:
 
   bool hasLowerBound() const { return LowerBound != nullptr; }
 
-  bool Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx) const;
+  bool Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx,
+                const ExprEvalScope *Scope = nullptr) const;
 
   static bool classof(const ExplicitShapeSpec *) { return true; }
   static bool classof(const ArraySpec *AS) {
@@ -916,7 +958,7 @@ public:
 };
 
 /// CallExpr - represents a call to a function.
-class CallExpr : public Expr, public MultiArgumentExpr {
+class CallExpr : public Expr, public MultiArgumentExpr<CallExpr> {
   FunctionDecl *Function;
   CallExpr(ASTContext &C, SourceLocation Loc,
            FunctionDecl *Func, ArrayRef<Expr*> Args);
@@ -935,7 +977,8 @@ public:
 };
 
 /// IntrinsicCallExpr - represents a call to an intrinsic function
-class IntrinsicCallExpr : public Expr, public MultiArgumentExpr {
+class IntrinsicCallExpr : public Expr,
+                          public MultiArgumentExpr<IntrinsicCallExpr> {
   intrinsic::FunctionKind Function;
   IntrinsicCallExpr(ASTContext &C, SourceLocation Loc,
                             intrinsic::FunctionKind Func,
@@ -958,9 +1001,9 @@ public:
 };
 
 /// ImpliedDoExpr - represents an implied do in a DATA statement
-class ImpliedDoExpr : public Expr {
+class ImpliedDoExpr : public Expr, protected MultiArgumentExpr<ImpliedDoExpr> {
+  friend class MultiArgumentExpr<ImpliedDoExpr>;
   VarDecl *DoVar;
-  MultiArgumentExpr DoList;
   Expr *Init, *Terminate, *Increment;
 
   ImpliedDoExpr(ASTContext &C, SourceLocation Loc,
@@ -974,7 +1017,7 @@ public:
                                Expr *IncrementationParam);
 
   VarDecl *getVarDecl() const { return DoVar; }
-  ArrayRef<Expr*> getBody() const { return DoList.getArguments(); }
+  ArrayRef<Expr*> getBody() const { return getArguments(); }
   Expr *getInitialParameter() const { return Init; }
   Expr *getTerminalParameter() const { return Terminate; }
   Expr *getIncrementationParameter() const { return Increment; }
@@ -991,7 +1034,9 @@ public:
 };
 
 /// ArrayConstructorExpr - (/ /)
-class ArrayConstructorExpr : public Expr, protected MultiArgumentExpr {
+class ArrayConstructorExpr : public Expr,
+                             protected MultiArgumentExpr<ArrayConstructorExpr> {
+  friend class MultiArgumentExpr<ArrayConstructorExpr>;
   ArrayConstructorExpr(ASTContext &C, SourceLocation Loc,
                        ArrayRef<Expr*> Items, QualType Ty);
 public:
@@ -1000,6 +1045,9 @@ public:
 
   ArrayRef<Expr*> getItems() const { return getArguments(); }
 
+  /// \brief Replaces an item in this constructor.
+  void setItem(unsigned I, Expr *E) { setArgument(I, E); }
+
   SourceLocation getLocEnd() const;
 
   static bool classof(const Expr *E) {
@@ -1009,7 +1057,8 @@ public:
 };
 
 /// TypeConstructorExpr - Record(args)
-class TypeConstructorExpr : public Expr, public MultiArgumentExpr {
+class TypeConstructorExpr : public Expr,
+                            public MultiArgumentExpr<TypeConstructorExpr> {
   const RecordDecl *Record;
   TypeConstructorExpr(ASTContext &C, SourceLocation Loc,
                       const RecordDecl *record,
@@ -46,15 +46,19 @@ public:
   };
 
 private:
+  SourceLocation Loc;
+  Expr *StmtLabel;
+  /// The class and the flags are stored last so that the subclasses can
+  /// place their small members into the tail padding of a Stmt.
   unsigned StmtID : 16;
   unsigned IsStmtLabelUsed : 1;
   unsigned IsStmtLabelUsedAsGotoTarget : 1;
   unsigned IsStmtLabelUsedAsAssignTarget : 1;
-  SourceLocation Loc;
-  Expr *StmtLabel;
 
   Stmt(const Stmt &);           // Do not implement!
   friend class ASTContext;
+
+  static bool StatisticsEnabled;
 protected:
   // Make vanilla 'new' and 'delete' illegal for Stmts.
   void* operator new(size_t bytes) throw() {
@@ -66,11 +70,13 @@ protected:
   }
 
   Stmt(StmtClass ID, SourceLocation L, Expr *SLT)
-    : StmtID(ID),
+    : Loc(L), StmtLabel(SLT),
+      StmtID(ID),
       IsStmtLabelUsed(0),
       IsStmtLabelUsedAsGotoTarget(0),
-      IsStmtLabelUsedAsAssignTarget(0),
-      Loc(L), StmtLabel(SLT) {}
+      IsStmtLabelUsedAsAssignTarget(0) {
+    if(StatisticsEnabled) addStmtClass(ID);
+  }
 public:
   virtual ~Stmt();
 
@@ -127,6 +133,11 @@ public:
   void dump() const;
   void dump(llvm::raw_ostream &OS) const;
 
+  // Statistics
+  static void addStmtClass(StmtClass C);
+  static void EnableStatistics();
+  static void PrintStats(llvm::raw_ostream &OS);
+
   static bool classof(const Stmt*) { return true; }
 
 public:
@@ -581,7 +592,7 @@ public:
 };
 
 /// EquivalenceStmt - this is a part of EQUIVALENCE statement.
-class EquivalenceStmt : public Stmt, public MultiArgumentExpr {
+class EquivalenceStmt : public Stmt, public MultiArgumentExpr<EquivalenceStmt> {
   EquivalenceStmt(ASTContext &C, SourceLocation Loc,
                   ArrayRef<Expr*> Objects, Expr *StmtLabel);
 public:
@@ -966,7 +977,7 @@ public:
 };
 
 /// CaseStmt
-class CaseStmt : public SelectionCase, public MultiArgumentExpr {
+class CaseStmt : public SelectionCase, public MultiArgumentExpr<CaseStmt> {
   CaseStmt *Next;
 
   CaseStmt(ASTContext &C, SourceLocation Loc,
@@ -1079,7 +1090,7 @@ public:
 };
 
 /// CallStmt
-class CallStmt : public Stmt, public MultiArgumentExpr {
+class CallStmt : public Stmt, public MultiArgumentExpr<CallStmt> {
   FunctionDecl *Function;
   CallStmt(ASTContext &C, SourceLocation Loc,
            FunctionDecl *Func, ArrayRef<Expr*> Args, Expr *StmtLabel);
@@ -1116,7 +1127,8 @@ public:
 };
 
 /// PrintStmt
-class PrintStmt : public Stmt, protected MultiArgumentExpr {
+class PrintStmt : public Stmt, protected MultiArgumentExpr<PrintStmt> {
+  friend class MultiArgumentExpr<PrintStmt>;
   FormatSpec *FS;
   PrintStmt(ASTContext &C, SourceLocation L, FormatSpec *fs,
             ArrayRef<Expr*> OutList, Expr *StmtLabel);
@@ -1137,7 +1149,8 @@ public:
 };
 
 /// WriteStmt
-class WriteStmt : public Stmt, protected MultiArgumentExpr {
+class WriteStmt : public Stmt, protected MultiArgumentExpr<WriteStmt> {
+  friend class MultiArgumentExpr<WriteStmt>;
   UnitSpec *US;
   FormatSpec *FS;
   WriteStmt(ASTContext &C, SourceLocation Loc, UnitSpec *us,
@@ -21,6 +21,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include <list>
+#include <vector>
 
 namespace llvm {
   class SourceMgr;
@@ -77,6 +78,8 @@ private:
   bool OwnsDiagClient;
   llvm::SourceMgr *SrcMgr;
   unsigned ErrorLimit;           // Cap of # errors emitted, 0 -> no limit.
+  unsigned WarningLimit;         // Cap of # warnings emitted, 0 -> no limit.
+  bool SuppressAllDiagnostics;   // Suppress all diagnostics.
   llvm::IntrusiveRefCntPtr<DiagnosticIDs> Diags;
 
   /// \brief Mapping information for diagnostics.
@@ -112,6 +115,16 @@ private:
   /// \brief Keeps and automatically disposes all DiagStates that we create.
   std::list<DiagState> DiagStates;
 
+  /// \brief The levels of the builtin diagnostics, plus one, which are used
+  /// to drop the ignored diagnostics before their arguments are captured.
+  ///
+  /// Zero means that the level wasn't computed yet. The cache is cleared
+  /// whenever a mapping changes.
+  mutable std::vector<unsigned char> CachedLevels;
+
+  /// \brief Computes the level of the given diagnostic and caches it.
+  bool isIgnoredSlow(unsigned DiagID) const;
+
   /// \brief Represents a point in source where the diagnostic state was
   /// modified because of a pragma.
   ///
@@ -193,6 +206,7 @@ private:
   unsigned NumWarnings;         ///< Number of warnings reported
   unsigned NumErrors;           ///< Number of errors reported
   unsigned NumErrorsSuppressed; ///< Number of errors suppressed
+  unsigned NumWarningsSuppressed; ///< Number of warnings suppressed
 
   /// \brief ID of the "delayed" diagnostic, which is a (typically
   /// fatal) diagnostic that had to be delayed because it was found
@@ -208,7 +222,8 @@ public:
   DiagnosticsEngine(const llvm::IntrusiveRefCntPtr<DiagnosticIDs> &D,
                     llvm::SourceMgr *SM, DiagnosticClient *DC,
                     bool ShouldOwnClient = true)
-    : Client(DC), OwnsDiagClient(ShouldOwnClient), SrcMgr(SM), Diags(D)
+    : Client(DC), OwnsDiagClient(ShouldOwnClient), SrcMgr(SM), ErrorLimit(0),
+    WarningLimit(0), SuppressAllDiagnostics(false), Diags(D)
   { Reset(); }
 
   const llvm::IntrusiveRefCntPtr<DiagnosticIDs> &getDiagnosticIDs() const {
@@ -255,6 +270,31 @@ public:
   /// Zero disables the limit.
   void setErrorLimit(unsigned Limit) { ErrorLimit = Limit; }
 
+  /// \brief Specify a limit for the number of warnings we should
+  /// emit. The warnings after the limit are still counted.
+  ///
+  /// Zero disables the limit.
+  void setWarningLimit(unsigned Limit) { WarningLimit = Limit; }
+
+  /// \brief Suppress all diagnostics, to silence the parser when it skips
+  /// the statements which are parsed again later.
+  ///
+  /// The suppressed diagnostics aren't counted.
+  void setSuppressAllDiagnostics(bool Val = true) {
+    SuppressAllDiagnostics = Val;
+  }
+  bool getSuppressAllDiagnostics() const { return SuppressAllDiagnostics; }
+
+  /// \brief Determine whether the given diagnostic is ignored.
+  ///
+  /// This is checked before the diagnostic's arguments are captured, so it
+  /// has to be cheap for the diagnostics which are reported very often.
+  bool isIgnored(unsigned DiagID) const {
+    if (DiagID < CachedLevels.size() && CachedLevels[DiagID])
+      return CachedLevels[DiagID] == DiagnosticIDs::Ignored + 1;
+    return isIgnoredSlow(DiagID);
+  }
+
   /// \brief This allows the client to specify that certain warnings are
   /// ignored.
   ///
@@ -266,6 +306,24 @@ public:
   void setDiagnosticMapping(diag::kind Diag, diag::Mapping Map,
                             SourceLocation Loc);
 
+  /// \brief Change an entire diagnostic group (e.g. "loop-idiom") to
+  /// the specified mapping.
+  ///
+  /// \returns true (and ignores the request) if "Group" was unknown, false
+  /// otherwise.
+  ///
+  /// \param Loc The source location that this change of diagnostic state should
+  /// take affect. It can be null if we are setting the state from command-line.
+  bool setDiagnosticGroupMapping(StringRef Group, diag::Mapping Map,
+                                 SourceLocation Loc = SourceLocation());
+
+  /// \brief Copies the current diagnostic mappings of the given engine,
+  /// e.g. to report the diagnostics of another thread in the same way as
+  /// \p Other does. The limits aren't copied, because the diagnostics of
+  /// the other thread are replayed through \p Other with ReportFormatted,
+  /// which applies them.
+  void copyMappings(const DiagnosticsEngine &Other);
+
   /// \brief Reset the state of the diagnostic object to its initial
   /// configuration.
   void Reset();
@@ -302,10 +360,30 @@ public:
   /// clients
   bool ReportNote(SourceLocation L, const llvm::Twine &Msg);
 
+  /// \brief Report a diagnostic which was already formatted, e.g. by the
+  /// engine of another thread.
+  ///
+  /// Unlike ReportError and ReportWarning, the diagnostic is counted
+  /// towards the error and warning limits of this engine.
+  ///
+  /// \returns \c true if the diagnostic was emitted.
+  bool ReportFormatted(Level DiagLevel, SourceLocation L,
+                       const llvm::Twine &Msg,
+                       llvm::ArrayRef<SourceRange> Ranges =
+                         llvm::ArrayRef<SourceRange>());
+
   bool hasErrorOccurred() const {
     return NumErrors!=0;
   }
 
+  /// \brief The number of errors which weren't shown because of the
+  /// error limit.
+  unsigned getNumErrorsSuppressed() const { return NumErrorsSuppressed; }
+
+  /// \brief The number of warnings which weren't shown because of the
+  /// warning limit.
+  unsigned getNumWarningsSuppressed() const { return NumWarningsSuppressed; }
+
   /// \brief Clear out the current diagnostic.
   void Clear() { CurDiagID = ~0U; }
 private:
@@ -566,8 +644,10 @@ public:
   /// \endcode
   operator bool() const { return true; }
 
+  // The builders of the ignored diagnostics are inactive from the start, and
+  // drop their arguments.
   void AddString(llvm::StringRef S) const {
-    assert(isActive() && "Clients must not add to cleared diagnostic!");
+    if (!isActive()) return;
     assert(NumArgs < DiagnosticsEngine::MaxArguments &&
            "Too many arguments to diagnostic!");
     DiagObj->DiagArgumentsKind[NumArgs] = DiagnosticsEngine::ak_std_string;
@@ -575,7 +655,7 @@ public:
   }
 
   void AddTaggedVal(intptr_t V, DiagnosticsEngine::ArgumentKind Kind) const {
-    assert(isActive() && "Clients must not add to cleared diagnostic!");
+    if (!isActive()) return;
     assert(NumArgs < DiagnosticsEngine::MaxArguments &&
            "Too many arguments to diagnostic!");
     DiagObj->DiagArgumentsKind[NumArgs] = Kind;
@@ -583,13 +663,14 @@ public:
   }
 
   void AddSourceRange(const SourceRange &R) const {
-    assert(isActive() && "Clients must not add to cleared diagnostic!");
+    if (!isActive()) return;
     assert(NumRanges < DiagnosticsEngine::MaxRanges &&
            "Too many arguments to diagnostic!");
     DiagObj->DiagRanges[NumRanges++] = R;
   }
 
   void AddFixItHint(const FixItHint &Hint) const {
+    if (!isActive()) return;
     DiagObj->DiagFixItHints.push_back(Hint);
   }
 
@@ -649,6 +730,12 @@ inline const DiagnosticBuilder &operator<<(const DiagnosticBuilder &DB,
 inline DiagnosticBuilder DiagnosticsEngine::Report(SourceLocation Loc,
                                             unsigned DiagID){
   assert(CurDiagID == ~0U && "Multiple diagnostics in flight at once!");
+  // Ignored diagnostics don't go through the builder at all, so that the
+  // reports of disabled warnings don't pay for their arguments.
+  if (isIgnored(DiagID)) {
+    LastDiagLevel = DiagnosticIDs::Ignored;
+    return DiagnosticBuilder();
+  }
   CurDiagLoc = Loc;
   CurDiagID = DiagID;
   return DiagnosticBuilder(this);
@@ -826,6 +913,14 @@ public:
                                   llvm::ArrayRef<SourceRange>(),
                                 llvm::ArrayRef<FixItHint> FixIts =
                                   llvm::ArrayRef<FixItHint>());
+
+  /// HandleSuppressedDiagnostic - Handle a diagnostic which isn't shown
+  /// because the error or the warning limit was reached. The message of
+  /// such a diagnostic isn't formatted.
+  ///
+  /// Default implementation just keeps track of the total number of warnings
+  /// and errors.
+  virtual void HandleSuppressedDiagnostic(DiagnosticsEngine::Level DiagLevel);
 };
 
 } // end namespace flang
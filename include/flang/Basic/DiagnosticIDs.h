@@ -265,6 +265,13 @@ private:
   /// suppressed.
   bool ProcessDiag(DiagnosticsEngine &Diag) const;
 
+  /// \brief Counts a diagnostic of the given level towards the error and
+  /// warning limits.
+  ///
+  /// \returns \c false if the diagnostic isn't shown because a limit was
+  /// reached.
+  bool CountDiag(DiagnosticsEngine &Diag, Level DiagLevel) const;
+
   /// \brief Used to emit a diagnostic that is finally fully formed,
   /// ignoring suppression.
   void EmitDiag(DiagnosticsEngine &Diag, Level DiagLevel) const;
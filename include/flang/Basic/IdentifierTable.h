@@ -16,6 +16,7 @@
 #define FLANG_BASIC_IDENTIFIERTABLE_H__
 
 #include "TokenKinds.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include <string>
@@ -127,6 +128,13 @@ class IdentifierTable {
   HashTableTy FormatSpecHashTable;
   IdentifierInfoLookup *ExternalLookup;
 
+  /// EnabledKeywords - The keyword flags of the current language.
+  unsigned EnabledKeywords;
+
+  /// PredefinedInfos - The identifier info of every keyword and format
+  /// specification which was seen, indexed by its token kind.
+  IdentifierInfo *PredefinedInfos[tok::NUM_TOKENS];
+
 public:
   /// IdentifierTable ctor - Create the identifier table, populating it with
   /// info about the language keywords for the language specified by LangOpts.
@@ -139,13 +147,11 @@ public:
   }
 
   IdentifierInfo &get(const char *NameStart, const char *NameEnd) {
-    std::string Name = llvm::StringRef(NameStart, NameEnd-NameStart).str();
-    return get(Name);
+    return get(llvm::StringRef(NameStart, NameEnd-NameStart));
   }
 
   IdentifierInfo &get(const char *NameStart, size_t NameLen) {
-    std::string Name = llvm::StringRef(NameStart, NameLen).str();
-    return get(Name);
+    return get(llvm::StringRef(NameStart, NameLen));
   }
 
   IdentifierInfo &getKeyword(const char *NameStart, const char *NameEnd,
@@ -168,7 +174,14 @@ public:
 
   /// get - Return the identifier token info for the specified named identifier.
   IdentifierInfo &get(std::string &Name) {
-    std::string UCName = Name;
+    return get(llvm::StringRef(Name));
+  }
+
+  /// get - Return the identifier token info for the specified named identifier.
+  /// The name is lowered into a stack buffer, which is only heap allocated
+  /// when the name is longer than 64 characters.
+  IdentifierInfo &get(llvm::StringRef Name) {
+    llvm::SmallString<64> UCName(Name);
     for (size_t I = 0, E = UCName.size(); I != E; ++I)
       UCName[I] = ::tolower(UCName[I]);
 
@@ -271,26 +284,13 @@ public:
     return Iter != IdentifierHashTable.end() ? Iter->getValue() : 0;
   }
 
-  /// lookupKeyword - Return the iterator pointing to the keyword if found.
-  IdentifierInfo *lookupKeyword(std::string &Name) const {
-    std::string UCName = Name;
-    for (size_t I = 0, E = UCName.size(); I != E; ++I)
-      UCName[I] = ::tolower(UCName[I]);
-
-    HashTableTy::const_iterator Iter = KeywordHashTable.find(UCName);
-    return Iter != KeywordHashTable.end() ? Iter->getValue() : 0;
-  }
-
-  /// lookupFormatSpec - Return the iterator pointing to the format spec if found.
-  IdentifierInfo *lookupFormatSpec(llvm::StringRef Name) const {
-    if(Name.size() > 2) return nullptr;
-    char UCName[4] = {0,0,0,0};
-    for (size_t I = 0, E = Name.size(); I != E; ++I)
-      UCName[I] = ::tolower(Name[I]);
+  /// lookupKeyword - Return the keyword with the given name, or null if the
+  /// name isn't a keyword of the current language.
+  IdentifierInfo *lookupKeyword(llvm::StringRef Name);
 
-    HashTableTy::const_iterator Iter = FormatSpecHashTable.find(UCName);
-    return Iter != FormatSpecHashTable.end() ? Iter->getValue() : nullptr;
-  }
+  /// lookupFormatSpec - Return the format spec with the given name, or null
+  /// if the name isn't a format spec.
+  IdentifierInfo *lookupFormatSpec(llvm::StringRef Name);
 
   /// isaIdentifier - Return 'true' if the name is in the identifier hashtable.
   bool isaIdentifier(llvm::StringRef Name) const {
@@ -301,8 +301,9 @@ public:
   /// isaKeyword - Return 'true' if the name is in the keyword hashtable. I.e.,
   /// it can be treated as a keyword in the correct context.
   bool isaKeyword(const llvm::StringRef Name) const {
-    std::string NameStr = Name.str();    
-    return lookupKeyword(NameStr) ? true : false;
+    unsigned Flags;
+    return tok::getKeywordKind(Name, Flags) != tok::unknown &&
+           (Flags & EnabledKeywords);
   }
 
   /// \brief Creates a new IdentifierInfo from the given string.
@@ -332,8 +333,6 @@ public:
   /// PrintStats - Print some statistics to stderr that indicate how well the
   /// hashing is doing.
   void PrintStats() const;
-
-  void AddPredefineds(const LangOptions &LangOpts);
 };
 
 }  // end namespace flang
@@ -0,0 +1,92 @@
+//===--- StreamedSource.h - Sources which are read in chunks ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the StreamedSource class, which reads a source from a pipe or a
+// file in large chunks while it is being parsed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FLANG_BASIC_STREAMEDSOURCE_H
+#define FLANG_BASIC_STREAMEDSOURCE_H
+
+#include "flang/Basic/LLVM.h"
+#include "flang/Basic/SourceLocation.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class SourceMgr;
+}
+
+namespace flang {
+
+/// StreamedSource - Reads a source in chunks of a given size, which are
+/// added to the source manager as separate buffers. A chunk always ends
+/// before the initial line of a statement, so no token or statement
+/// spans two chunks, and the parser just continues with the next chunk when
+/// it reaches the end of the current one.
+///
+/// The buffers of the source manager are never moved, so the source
+/// locations stay valid, and at most one chunk of the input is held outside
+/// of them. This lets the compiler parse the output of a generator from a
+/// pipe without reading all of it first.
+class StreamedSource {
+  llvm::SourceMgr &SrcMgr;
+  std::string Name;
+  int FD;
+  bool FixedForm;
+  size_t ChunkSize;
+
+  /// Pending - The text which was read but isn't in a chunk yet.
+  std::vector<char> Pending;
+  bool ReachedEnd;
+
+  /// Lines - The number of lines in the chunks which were read.
+  unsigned Lines;
+
+  /// Chunks - The buffer ID and the number of the preceding lines
+  /// of every chunk.
+  std::vector<std::pair<unsigned, unsigned>> Chunks;
+
+  /// ReadMore - Reads up to the given number of bytes into the
+  /// pending text.
+  void ReadMore(size_t Size);
+
+  /// FindChunkEnd - Returns the offset of the last line in the pending text
+  /// which begins a statement, or 0 if there's no such line.
+  size_t FindChunkEnd() const;
+
+public:
+  /// The default size of the chunks.
+  static const size_t DefaultChunkSize = 16 * 1024 * 1024;
+
+  StreamedSource(llvm::SourceMgr &SM, bool IsFixedForm,
+                 size_t Size = DefaultChunkSize);
+  ~StreamedSource();
+
+  /// Open - Opens the given file, or the standard input if the file
+  /// name is '-'.
+  std::error_code Open(StringRef Filename);
+
+  /// ReadNextChunk - Reads the next chunk and adds it to the source manager.
+  /// Returns the ID of the new buffer, or 0 when the whole source was read.
+  /// The first call always returns a buffer, even for an empty source.
+  unsigned ReadNextChunk();
+
+  /// getLineOffset - Returns the number of the lines before the chunk which
+  /// contains the given location.
+  unsigned getLineOffset(SourceLocation Loc) const;
+};
+
+} // end namespace flang
+
+#endif
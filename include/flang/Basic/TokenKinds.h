@@ -14,6 +14,8 @@
 #ifndef LLVM_FLANG_TOKENKINDS_H__
 #define LLVM_FLANG_TOKENKINDS_H__
 
+#include "llvm/ADT/StringRef.h"
+
 namespace flang {
 namespace tok {
 
@@ -25,6 +27,18 @@ enum TokenKind {
   NUM_TOKENS
 };
 
+/// KeywordFlags - The languages in which a keyword from TokenKinds.def
+/// is available.
+enum KeywordFlags {
+  KEYALL    = 0x01,
+  KEYF77    = 0x02,
+  KEYF90    = 0x04,
+  KEYF95    = 0x08,
+  KEYF2003  = 0x10,
+  KEYF2008  = 0x20,
+  KEYNOTF77 = 0x40
+};
+
 /// \brief Determines the name of a token as used within the front end.
 ///
 /// The name of a token will be an internal name (such as "l_paren") and should
@@ -38,6 +52,18 @@ const char *getTokenName(enum TokenKind Kind);
 /// produce any alternative spellings.
 const char *getTokenSimpleSpelling(enum TokenKind Kind);
 
+/// \brief Returns the keyword with the given case insensitive spelling, or
+/// tok::unknown if the name isn't a keyword. The languages which have the
+/// keyword are returned in Flags.
+///
+/// The keywords are recognized by a matcher which is generated from
+/// TokenKinds.def, so this doesn't need any tables or allocations.
+TokenKind getKeywordKind(llvm::StringRef Name, unsigned &Flags);
+
+/// \brief Returns the format descriptor with the given case insensitive
+/// spelling, or tok::unknown if the name isn't a format descriptor.
+TokenKind getFormatSpecKind(llvm::StringRef Name, unsigned &Flags);
+
 }  // end namespace tok
 }  // end namespace flang
 
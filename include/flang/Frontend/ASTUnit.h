@@ -15,184 +15,168 @@
 #define LLVM_FLANG_FRONTEND_ASTUNIT_H
 
 #include "flang/AST/ASTContext.h"
-#include "flang/AST/ASTConsumer.h"
+#include "flang/Basic/Diagnostic.h"
 #include "flang/Basic/LangOptions.h"
-#include "flang/Basic/TargetOptions.h"
 #include "flang/Sema/Sema.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallVector.h"
-#include "llvm/ADT/StringMap.h"
-#include "llvm/Support/Path.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/SourceMgr.h"
 #include <cassert>
-#include <map>
+#include <memory>
 #include <string>
-#include <sys/types.h>
-#include <utility>
 #include <vector>
 
-namespace llvm {
-  class MemoryBuffer;
-}
-
 namespace flang {
-class ASTContext;
-class ASTReader;
-class CodeCompleteConsumer;
-class CompilerInvocation;
-class CompilerInstance;
+
 class Decl;
-class DiagnosticsEngine;
-class FileEntry;
-class FileManager;
-class HeaderSearch;
-class Preprocessor;
-class SourceManager;
-class TargetInfo;
-class ASTFrontendAction;
-class ASTDeserializationListener;
-
-/// \brief Utility class for loading a ASTContext from an AST file.
+class Parser;
+
+/// StoredDiagnostic - A diagnostic which was reported while an
+/// ASTUnit was parsed.
+struct StoredDiagnostic {
+  DiagnosticsEngine::Level Level;
+  SourceLocation Loc;
+  std::string Message;
+
+  StoredDiagnostic(DiagnosticsEngine::Level L, SourceLocation Location,
+                   StringRef Msg)
+    : Level(L), Loc(Location), Message(Msg) {}
+};
+
+/// SourceProgramUnit - A span of the source which contains one program unit,
+/// together with the declarations and the diagnostics which were produced
+/// when this span was parsed.
+class SourceProgramUnit {
+public:
+  /// BufferID - The buffer with the text of this program unit.
+  unsigned BufferID;
+
+  /// Offset - The offset of the first character of this program unit in
+  /// the source.
+  size_t Offset;
+
+  /// Line - The number of the lines before this program unit in the source.
+  unsigned Line;
+
+  /// Text - The source text of this program unit.
+  std::string Text;
+
+  /// Decls - The declarations which this program unit has added to the
+  /// translation unit.
+  SmallVector<Decl*, 2> Decls;
+
+  /// Diagnostics - The diagnostics which were reported for this program
+  /// unit.
+  std::vector<StoredDiagnostic> Diagnostics;
+
+  /// Identifiers - The upper case identifiers which appear in this program
+  /// unit.
+  llvm::StringSet<> Identifiers;
+
+  /// Reparsed - True if this program unit was parsed by the last
+  /// parse or reparse of the ASTUnit.
+  bool Reparsed;
+
+  SourceProgramUnit()
+    : BufferID(0), Offset(0), Line(0), Reparsed(false) {}
+};
+
+/// \brief Utility class for loading an ASTContext from a source file.
 ///
+/// The source is split into the spans of the program units, and every span
+/// is parsed separately into the same translation unit. This allows Reparse
+/// to parse only the program units which were changed, together with the
+/// program units which refer to the changed ones by name.
 class ASTUnit {
-private:
-  llvm::IntrusiveRefCntPtr<LangOptions>         LangOpts;
-  llvm::IntrusiveRefCntPtr<DiagnosticsEngine>   Diagnostics;
-  llvm::IntrusiveRefCntPtr<TargetInfo>          Target;
-  llvm::IntrusiveRefCntPtr<ASTContext>          Ctx;
-  llvm::IntrusiveRefCntPtr<TargetOptions>       TargetOpts;
-
-  /// \brief The AST consumer that received information about the translation
-  /// unit as it was parsed or loaded.
-  std::unique_ptr<ASTConsumer> Consumer;
-  
-  /// \brief The semantic analysis object used to type-check the translation
-  /// unit.
+  class StoredDiagnosticClient;
+
+  LangOptions LangOpts;
+  llvm::SourceMgr SrcMgr;
+  std::unique_ptr<StoredDiagnosticClient> DiagClient;
+  llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diagnostics;
+  std::unique_ptr<ASTContext> Ctx;
   std::unique_ptr<Sema> TheSema;
-  
-  /// Optional owned invocation, just used to make the invocation used in
-  /// LoadFromCommandLine available.
-  llvm::IntrusiveRefCntPtr<CompilerInvocation> Invocation;
-  
+  std::unique_ptr<Parser> TheParser;
+
   /// The name of the original source file used to generate this ASTUnit.
   std::string OriginalSourceFile;
 
- 
-  /// \brief The language options used when we load an AST file.
-  LangOptions ASTFileLangOpts;
-  
+  /// The program units, in the order of the source.
+  std::vector<std::unique_ptr<SourceProgramUnit>> ProgramUnits;
+
+  /// The program unit which is being parsed.
+  SourceProgramUnit *CurrentUnit;
+
   ASTUnit(const ASTUnit &) = delete;
   void operator=(const ASTUnit &) = delete;
-  
-  explicit ASTUnit(bool MainFileIsAST);
 
-  void CleanTemporaryFiles();
-  bool Parse(llvm::MemoryBuffer *OverrideMainBuffer);
+  ASTUnit(StringRef Filename, const LangOptions &Opts);
+
+  /// ParseProgramUnit - Parses the text of the given program unit into
+  /// the translation unit.
+  void ParseProgramUnit(SourceProgramUnit &Unit);
 
-  /// \brief Transfers ownership of the objects (like SourceManager) from
-  /// \param CI to this ASTUnit.
-  void transferASTDataFromCompilerInstance(CompilerInstance &CI);
+  /// RemoveProgramUnit - Removes the declarations of the given program
+  /// unit from the translation unit.
+  void RemoveProgramUnit(SourceProgramUnit &Unit);
 
 public:
-  
   ~ASTUnit();
 
   const DiagnosticsEngine &getDiagnostics() const { return *Diagnostics; }
   DiagnosticsEngine &getDiagnostics()             { return *Diagnostics; }
 
-
   const ASTContext &getASTContext() const { return *Ctx; }
         ASTContext &getASTContext()       { return *Ctx; }
 
-  void setASTContext(ASTContext *ctx) { Ctx = ctx; }
-
   bool hasSema() const { return TheSema.get() != nullptr; }
-  Sema &getSema() const { 
+  Sema &getSema() const {
     assert(TheSema && "ASTUnit does not have a Sema object!");
-    return *TheSema; 
+    return *TheSema;
   }
 
   StringRef getOriginalSourceFileName() {
     return OriginalSourceFile;
   }
 
+  unsigned getNumProgramUnits() const { return ProgramUnits.size(); }
+  const SourceProgramUnit &getProgramUnit(unsigned I) const {
+    assert(I < ProgramUnits.size());
+    return *ProgramUnits[I];
+  }
 
-  /// \brief Get the source location for the given file:line:col triplet.
-  ///
-  /// The difference with SourceManager::getLocation is that this method checks
-  /// whether the requested location points inside the precompiled preamble
-  /// in which case the returned source location will be a "loaded" one.
-  SourceLocation getLocation(const FileEntry *File,
-                             unsigned Line, unsigned Col) const;
-
-  /// \brief Get the source location for the given file:offset pair.
-  SourceLocation getLocation(const FileEntry *File, unsigned Offset) const;
-
+  /// hadErrors - Returns true if any of the program units has errors.
+  bool hadErrors() const;
 
-  llvm::MemoryBuffer *getBufferForFile(StringRef Filename,
-                                       std::string *ErrorStr = 0);
+  /// getLineAndColumn - Finds the line and the column of the given location
+  /// in the original source. Returns true if the location isn't inside
+  /// any of the program units.
+  bool getLineAndColumn(SourceLocation Loc, unsigned &Line,
+                        unsigned &Column) const;
 
-  /// \brief Create a ASTUnit. Gets ownership of the passed CompilerInvocation. 
-  static ASTUnit *create(CompilerInvocation *CI,
-                         llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags);
-  
-public:
-  
-  /// \brief Create an ASTUnit from a source file, via a CompilerInvocation
-  /// object, by invoking the optionally provided ASTFrontendAction. 
+  /// Reparse - Replaces the source with the new text. Only the program units
+  /// whose text has changed, and the program units which use the names
+  /// declared by the changed program units, are parsed again.
   ///
-  /// \param CI - The compiler invocation to use; it must have exactly one input
-  /// source file. The ASTUnit takes ownership of the CompilerInvocation object.
-  ///
-  /// \param Diags - The diagnostics engine to use for reporting errors; its
-  /// lifetime is expected to extend past that of the returned ASTUnit.
-  ///
-  /// \param Action - The ASTFrontendAction to invoke. Its ownership is not
-  /// transfered.
-  ///
-  /// \param Unit - optionally an already created ASTUnit. Its ownership is not
-  /// transfered.
-  ///
-  /// \param Persistent - if true the returned ASTUnit will be complete.
-  /// false means the caller is only interested in getting info through the
-  /// provided \see Action.
-  ///
-  /// \param ErrAST - If non-null and parsing failed without any AST to return
-  /// (e.g. because the PCH could not be loaded), this accepts the ASTUnit
-  /// mainly to allow the caller to see the diagnostics.
-  /// This will only receive an ASTUnit if a new one was created. If an already
-  /// created ASTUnit was passed in \p Unit then the caller can check that.
-  ///
-  static ASTUnit *LoadFromCompilerInvocationAction(CompilerInvocation *CI,
-                              llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags,
-                                             ASTFrontendAction *Action = 0,
-                                             ASTUnit *Unit = 0,
-                                             bool Persistent = true,
-                                      StringRef ResourceFilesPath = StringRef(),
-                                             bool OnlyLocalDecls = false,
-                                             bool CaptureDiagnostics = false,
-                                             bool PrecompilePreamble = false,
-                                       bool CacheCodeCompletionResults = false,
-                              bool IncludeBriefCommentsInCodeCompletion = false,
-                                       bool UserFilesAreVolatile = false,
-                                       std::unique_ptr<ASTUnit> *ErrAST = 0);
-
-  /// LoadFromCompilerInvocation - Create an ASTUnit from a source file, via a
-  /// CompilerInvocation object.
-  ///
-  /// \param CI - The compiler invocation to use; it must have exactly one input
-  /// source file. The ASTUnit takes ownership of the CompilerInvocation object.
-  ///
-  /// \param Diags - The diagnostics engine to use for reporting errors; its
-  /// lifetime is expected to extend past that of the returned ASTUnit.
-  //
-  // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
-  // shouldn't need to specify them at construction time.
-  static ASTUnit *LoadFromCompilerInvocation(CompilerInvocation *CI,
-                                             llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags);
+  /// The memory used by the replaced declarations is only released
+  /// with the ASTUnit.
+  void Reparse(StringRef NewSource);
 
+  /// LoadFromSource - Creates an ASTUnit from the given source text.
+  static ASTUnit *LoadFromSource(StringRef Filename, StringRef Source,
+                                 const LangOptions &Opts);
 
+  /// LoadFromFile - Creates an ASTUnit from the given source file. Returns
+  /// null if the file can't be read.
+  static ASTUnit *LoadFromFile(StringRef Filename, const LangOptions &Opts);
 };
 
-} // namespace clang
+/// SplitProgramUnits - Splits the source into the spans of the program units.
+/// Comments and blank lines after the last program unit are included in it.
+void SplitProgramUnits(StringRef Source, bool FixedForm,
+                       SmallVectorImpl<StringRef> &Units);
+
+} // namespace flang
 
 #endif
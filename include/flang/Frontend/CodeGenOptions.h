@@ -72,6 +72,20 @@ public:
     FPC_Fast        // Aggressively fuse FP ops (E.g. FMA).
   };
 
+  enum FPDenormalModeKind {
+    FPD_IEEE,         // Denormal values are supported.
+    FPD_PreserveSign, // Flush denormal values to a zero with the same sign.
+    FPD_PositiveZero  // Flush denormal values to +0.0.
+  };
+
+  enum FPExceptionKind {
+    FPE_Invalid   = 0x1,
+    FPE_Zero      = 0x2,
+    FPE_Overflow  = 0x4,
+    FPE_Underflow = 0x8,
+    FPE_Inexact   = 0x10
+  };
+
   enum StructReturnConventionKind {
     SRCK_Default,  // No special option was passed.
     SRCK_OnStack,  // Small structs on the stack (-fpcc-struct-return).
@@ -129,6 +143,10 @@ public:
   /// A list of command-line options to forward to the LLVM backend.
   std::vector<std::string> BackendOptions;
 
+  /// The lower case names of the derived types whose local arrays are stored
+  /// with one array per component (-fsoa-derived-types).
+  std::vector<std::string> SoADerivedTypes;
+
 public:
   // Define accessors/mutators for code generation options of enumeration type.
 #define CODEGENOPT(Name, Bits, Default)
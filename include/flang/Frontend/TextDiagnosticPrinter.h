@@ -16,6 +16,7 @@
 #define FLANG_FRONTEND_TEXT_DIAGNOSTIC_PRINTER_H_
 
 #include "flang/Basic/Diagnostic.h"
+#include <string>
 
 namespace llvm {
   class raw_ostream;
@@ -26,13 +27,31 @@ namespace llvm {
 namespace flang {
 
 class LangOptions;
+class StreamedSource;
 
 class TextDiagnosticPrinter : public DiagnosticClient {
   llvm::SourceMgr &SrcMgr;
+  const StreamedSource *Streamed;
+
+  /// The formatted diagnostics which weren't written yet. When the
+  /// diagnostics aren't shown with colors, the warnings and the notes are
+  /// written in batches instead of one unbuffered write per diagnostic.
+  std::string Pending;
+
+  void PrintMessage(const llvm::SMDiagnostic &D, bool IsError);
 public:
-  TextDiagnosticPrinter(llvm::SourceMgr &SM) : SrcMgr(SM) {}
+  TextDiagnosticPrinter(llvm::SourceMgr &SM) : SrcMgr(SM), Streamed(nullptr) {}
   virtual ~TextDiagnosticPrinter();
 
+  /// flush - Writes the pending diagnostics to standard error.
+  void flush();
+
+  virtual void EndSourceFile();
+
+  /// setStreamedSource - Reports the line numbers of the given streamed
+  /// source relative to the start of the source instead of the chunk.
+  void setStreamedSource(const StreamedSource *S) { Streamed = S; }
+
   // TODO: Emit caret diagnostics and Highlight range.
   virtual void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel, SourceLocation L,
                                 const llvm::Twine &Msg,
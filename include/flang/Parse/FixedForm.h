@@ -12,8 +12,8 @@
 
 #include "flang/Basic/LLVM.h"
 #include "flang/Basic/TokenKinds.h"
-#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/ArrayRef.h"
+#include <bitset>
 
 namespace flang {
 namespace fixedForm {
@@ -37,7 +37,7 @@ public:
 /// KeywordMatcher - represents a set of keywords that
 /// can be matched.
 class KeywordMatcher {
-  llvm::StringSet<llvm::BumpPtrAllocator> Keywords;
+  std::bitset<tok::NUM_TOKENS> Keywords;
 public:
   KeywordMatcher() {}
   KeywordMatcher(ArrayRef<KeywordFilter> Filters);
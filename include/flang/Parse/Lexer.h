@@ -354,6 +354,13 @@ public:
   void getSpelling(const Token &Tok,
                    llvm::SmallVectorImpl<llvm::StringRef> &Spelling) const;
 
+  /// getSpelling - Return the cleaned up spelling of the Tok token. The
+  /// spelling of a token which doesn't need cleaning points into the source
+  /// buffer, so only the tokens with blanks, continuations or comments in
+  /// them are copied into the given buffer.
+  llvm::StringRef getSpelling(const Token &Tok,
+                              llvm::SmallVectorImpl<char> &Buffer) const;
+
   /// getFixedFormIdentifierSpelling - Return the 'spelling' of the Tok token
   /// as determined by fixed-form identifier rules (i.e. whitespaces are ignored)
   void getFixedFormIdentifierSpelling(const Token &Tok,
@@ -24,9 +24,12 @@
 #include "flang/Parse/Lexer.h"
 #include "flang/Sema/DeclSpec.h"
 #include "flang/Sema/Ownership.h"
+#include "flang/Sema/Scope.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
+#include <memory>
 #include <vector>
 
 namespace llvm {
@@ -44,6 +47,7 @@ class ArraySpec;
 class Parser;
 class Selector;
 class Sema;
+class StreamedSource;
 class UnitSpec;
 class FormatSpec;
 
@@ -66,6 +70,15 @@ public:
     WrongConstruct,         //< The construct we wanted to parse wasn't present
     Error                   //< There was an error parsing
   };
+
+  /// ExecutionPartMode - Determines when the execution parts of the
+  /// program units are parsed.
+  enum ExecutionPartMode {
+    EP_Parse,               //< The execution parts are parsed in place
+    EP_Defer,               //< The execution parts are parsed after all the
+                            //< specification parts
+    EP_Skip                 //< The execution parts aren't parsed
+  };
 private:
 
   Lexer TheLexer;
@@ -81,6 +94,19 @@ private:
   /// SourceMgr object.
   std::vector<int> CurBufferIndex;
 
+  /// Streamed - The source which provides the next chunk of the main
+  /// file when the lexer reaches the end of the current one.
+  StreamedSource *Streamed;
+
+  /// SpliceIncludes - if set, every included file is read only once, and
+  /// the diagnostic client is notified only when the outermost included
+  /// file is entered and left.
+  bool SpliceIncludes;
+
+  /// IncludedFiles - The buffers which were read for the included files
+  /// when the includes are spliced.
+  llvm::StringMap<const llvm::MemoryBuffer*> IncludedFiles;
+
   ASTContext &Context;
 
   /// Diag - Diagnostics for parsing errors.
@@ -144,6 +170,25 @@ private:
   /// was select case and a case or an end select statement is expected.
   bool PrevStmtWasSelectCase;
 
+  /// ExecutionParts - Determines when the execution parts are parsed.
+  ExecutionPartMode ExecutionParts;
+
+  /// DeferredExecutionPart - The execution part of a program unit which
+  /// is parsed after the specification parts of all the units.
+  struct DeferredExecutionPart {
+    DeclContext *Unit;
+    std::unique_ptr<ExecutableProgramUnitScope> Scope;
+    unsigned BufferID;
+    /// Begin - The location of the first statement of the execution part.
+    SourceLocation Begin;
+    tok::TokenKind EndKw;
+  };
+  std::vector<DeferredExecutionPart> DeferredExecutionParts;
+
+  /// SkippingExecutionPart - if set, the execution part is being skipped,
+  /// so the included files aren't entered.
+  bool SkippingExecutionPart;
+
 private:
 
   /// getIdentifierInfo - Return information about the specified identifier
@@ -163,7 +208,9 @@ private:
   void CleanLiteral(Token T, std::string &NameStr);
 
   bool EnterIncludeFile(const std::string &Filename);
+  unsigned AddSplicedIncludeFile(const std::string &Filename);
   bool LeaveIncludeFile();
+  bool EnterNextChunk();
 
   /// IsNextToken - Returns true if the next token is a token kind
   bool IsNextToken(tok::TokenKind TokKind);
@@ -188,6 +235,26 @@ public:
   Parser(llvm::SourceMgr &SrcMgr, const LangOptions &Opts,
          DiagnosticsEngine &D, Sema &actions);
 
+  /// EnterMainBuffer - Makes the parser parse the given buffer instead of
+  /// the main file of the source manager. The identifier table is kept,
+  /// so the program units from the different buffers share the same
+  /// identifiers.
+  void EnterMainBuffer(unsigned BufferID);
+
+  /// setStreamedSource - Makes the parser continue with the next chunk of
+  /// the given source at the end of the main buffer.
+  void setStreamedSource(StreamedSource *S) { Streamed = S; }
+
+  /// setExecutionPartMode - Makes the parser defer or skip the execution
+  /// parts of the program units. The execution parts of the units which
+  /// are streamed or included are always parsed in place.
+  void setExecutionPartMode(ExecutionPartMode M) { ExecutionParts = M; }
+
+  /// setSpliceIncludes - Makes the parser reuse the contents of the files
+  /// which are included more than once, and batch the diagnostic client
+  /// notifications for the nested included files.
+  void setSpliceIncludes(bool B) { SpliceIncludes = B; }
+
   llvm::SourceMgr &getSourceManager() { return SrcMgr; }
 
   const Token &getCurToken() const { return Tok; }
@@ -361,7 +428,12 @@ private:
   bool ParseExternalSubprogram(DeclSpec &ReturnType, int Attr);
   bool ParseTypedExternalSubprogram(int Attr);
   bool ParseRecursiveExternalSubprogram();
-  bool ParseExecutableSubprogramBody(tok::TokenKind EndKw);
+  bool ParseExecutableSubprogramBody(tok::TokenKind EndKw,
+                                     std::unique_ptr<ExecutableProgramUnitScope> &Scope);
+  bool DeferExecutionPart(tok::TokenKind EndKw,
+                          std::unique_ptr<ExecutableProgramUnitScope> &Scope);
+  void ParseDeferredExecutionParts();
+  void ReenterStatement(unsigned BufferID, SourceLocation Loc);
   bool ParseModule();
   bool ParseBlockData();
 
@@ -466,6 +538,7 @@ private:
   StmtResult ParseTARGETStmt();
   StmtResult ParseVALUEStmt();
   StmtResult ParseVOLATILEStmt();
+  StmtResult ParseTHREADPRIVATEStmt();
 
   // Dynamic association.
   StmtResult ParseALLOCATEStmt();
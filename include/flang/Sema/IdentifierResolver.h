@@ -0,0 +1,92 @@
+//===--- IdentifierResolver.h - Identifier resolution -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the IdentifierResolver class, which is used for
+// resolving the identifiers to the declarations which are visible in
+// the current declaration context.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FLANG_SEMA_IDENTIFIERRESOLVER_H__
+#define FLANG_SEMA_IDENTIFIERRESOLVER_H__
+
+#include "flang/Basic/LLVM.h"
+#include "llvm/Support/Allocator.h"
+
+namespace flang {
+
+class IdentifierInfo;
+class NamedDecl;
+
+/// IdentifierResolver - Keeps a chain of the visible declarations for
+/// every identifier. The chain is stored in the front end token info of
+/// the identifier and is ordered from the innermost declaration context
+/// to the outermost one, so the resolution only has to check its head.
+class IdentifierResolver {
+  /// IdDeclLink - A declaration in the chain of an identifier.
+  struct IdDeclLink {
+    NamedDecl *D;
+    IdDeclLink *Next;
+  };
+
+  llvm::BumpPtrAllocator Allocator;
+
+  /// \brief The links which were removed from the chains and can be reused.
+  IdDeclLink *FreeLinks;
+
+  static IdDeclLink *getChain(const IdentifierInfo *II);
+  static void setChain(const IdentifierInfo *II, IdDeclLink *Chain);
+
+public:
+  /// iterator - Iterates over the declarations of an identifier,
+  /// starting with the innermost one.
+  class iterator {
+    IdDeclLink *Link;
+  public:
+    iterator(IdDeclLink *L = nullptr) : Link(L) {}
+
+    NamedDecl *operator*() const { return Link->D; }
+
+    iterator &operator++() {
+      Link = Link->Next;
+      return *this;
+    }
+
+    bool operator==(const iterator &Other) const { return Link == Other.Link; }
+    bool operator!=(const iterator &Other) const { return Link != Other.Link; }
+  };
+
+  IdentifierResolver();
+
+  /// \brief Returns an iterator over the declarations of the given identifier.
+  static iterator begin(const IdentifierInfo *II) {
+    return iterator(getChain(II));
+  }
+  static iterator end() {
+    return iterator();
+  }
+
+  /// \brief Returns the innermost declaration of the given identifier,
+  /// or null if the identifier isn't declared.
+  static NamedDecl *getInnermostDecl(const IdentifierInfo *II) {
+    auto Chain = getChain(II);
+    return Chain? Chain->D : nullptr;
+  }
+
+  /// \brief Makes the given declaration the innermost declaration
+  /// of its identifier.
+  void AddDecl(NamedDecl *D);
+
+  /// \brief Removes the given declaration from the chain of its identifier.
+  void RemoveDecl(NamedDecl *D);
+};
+
+} // end flang namespace
+
+#endif
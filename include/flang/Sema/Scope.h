@@ -374,6 +374,14 @@ class SpecificationScope {
   SmallVector<StoredCommonSpec, 4> CommonSpecs;
   SmallVector<StoredSaveCommonBlockSpec, 4> SaveCommonBlockSpecs;
 
+  struct StoredThreadPrivateSpec {
+    SourceLocation Loc, IDLoc;
+    const IdentifierInfo *IDInfo;
+    CommonBlockDecl *Block;
+  };
+
+  SmallVector<StoredThreadPrivateSpec, 4> ThreadPrivateSpecs;
+
 public:
 
   void AddDimensionSpec(SourceLocation Loc, SourceLocation IDLoc,
@@ -398,6 +406,14 @@ public:
 
   void ApplyCommonSpecs(Sema &Visitor,
                         CommonBlockSetBuilder &Builder);
+
+  void AddThreadPrivateSpec(SourceLocation Loc, SourceLocation IDLoc,
+                            const IdentifierInfo *IDInfo);
+
+  void AddThreadPrivateSpec(SourceLocation Loc, SourceLocation IDLoc,
+                            CommonBlockDecl *Block);
+
+  void ApplyThreadPrivateSpecs(Sema &Visitor);
 };
 
 /// The scope of a translation unit (a single file)
@@ -417,6 +433,8 @@ public:
   CommonBlockScope CommonBlocks;
   BlockStmtBuilder Body;
   SpecificationScope Specs;
+
+  virtual ~ExecutableProgramUnitScope() {}
 };
 
 /// The scope of a main program
@@ -24,6 +24,7 @@
 #include "flang/Sema/Ownership.h"
 #include "flang/Sema/Scope.h"
 #include "flang/Sema/DeclSpec.h"
+#include "flang/Sema/IdentifierResolver.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/SourceMgr.h"
 #include "flang/Basic/LLVM.h"
@@ -91,6 +92,9 @@ class Sema {
   /// \brief The mapping
   intrinsic::FunctionMapping IntrinsicFunctionMapping;
 
+  /// \brief The declarations which are visible in the current context.
+  IdentifierResolver IdResolver;
+
 public:
   typedef Expr ExprTy;
 
@@ -144,6 +148,13 @@ public:
   void PushDeclContext(DeclContext *DC);
   void PopDeclContext();
 
+  /// \brief Adds the declaration to the current context and makes
+  /// it visible to the identifier resolution.
+  void PushOnScopeChains(NamedDecl *D);
+
+  /// \brief Removes the declaration from the current context.
+  void RemoveFromScopeChains(NamedDecl *D);
+
   bool IsInsideFunctionOrSubroutine() const;
   FunctionDecl *CurrentContextAsFunction() const;
 
@@ -180,6 +191,17 @@ public:
   void ActOnSubProgramArgumentList(ASTContext &C, ArrayRef<VarDecl*> Arguments);
   void ActOnEndSubProgram(ASTContext &C, SourceLocation Loc);
 
+  /// \brief Leaves the current program unit after its specification part,
+  /// without creating its body.
+  void ActOnDeferExecutionPart();
+
+  /// \brief Reenters a program unit which was left after its specification
+  /// part, so that its execution part can be parsed. The program units
+  /// which were declared after it are hidden until it's left again.
+  void ActOnResumeExecutionPart(DeclContext *Unit,
+                                ExecutableProgramUnitScope &Scope);
+  void ActOnEndResumedExecutionPart(DeclContext *Unit, SourceLocation Loc);
+
   FunctionDecl *ActOnStatementFunction(ASTContext &C,
                                        SourceLocation IDLoc,
                                        const IdentifierInfo *IDInfo);
@@ -208,6 +230,12 @@ public:
   bool ApplySaveSpecification(SourceLocation Loc, SourceLocation IDLoc,
                               CommonBlockDecl *Block);
 
+  bool ApplyThreadPrivateSpecification(SourceLocation Loc, SourceLocation IDLoc,
+                                       const IdentifierInfo *IDInfo);
+
+  bool ApplyThreadPrivateSpecification(SourceLocation Loc, SourceLocation IDLoc,
+                                       CommonBlockDecl *Block);
+
   bool ApplyCommonSpecification(SourceLocation Loc, SourceLocation IDLoc,
                                 const IdentifierInfo *IDInfo,
                                 CommonBlockDecl *Block,
@@ -285,6 +313,8 @@ public:
   /// Returns a declaration which matches the identifier in this context
   Decl *LookupIdentifier(const IdentifierInfo *IDInfo);
 
+  /// Returns a declaration which matches the identifier in this context
+  /// or in one of the enclosing contexts.
   Decl *ResolveIdentifier(const IdentifierInfo *IDInfo);
 
   /// \brief Returns a variable declaration if the given identifier resolves
@@ -396,6 +426,15 @@ public:
                                   SourceLocation IDLoc,
                                   const IdentifierInfo *IDInfo);
 
+  // THREADPRIVATE directive
+  StmtResult ActOnTHREADPRIVATE(ASTContext &C, SourceLocation Loc,
+                                SourceLocation IDLoc,
+                                const IdentifierInfo *IDInfo);
+
+  StmtResult ActOnTHREADPRIVATECommonBlock(ASTContext &C, SourceLocation Loc,
+                                           SourceLocation IDLoc,
+                                           const IdentifierInfo *IDInfo);
+
   // EQUIVALENCE statement
   StmtResult ActOnEQUIVALENCE(ASTContext &C, SourceLocation Loc,
                               SourceLocation PartLoc,
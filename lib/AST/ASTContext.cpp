@@ -12,17 +12,26 @@
 //===----------------------------------------------------------------------===//
 
 #include "flang/AST/ASTContext.h"
+#include "flang/AST/Expr.h"
+#include "flang/AST/Stmt.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
 
 
 namespace flang {
 
 ASTContext::ASTContext(llvm::SourceMgr &SM, LangOptions LangOpts)
   : SrcMgr(SM), LastSDM(0), LanguageOptions(LangOpts) {
+  ConcurrentAccess = false;
   TUDecl = TranslationUnitDecl::Create(*this);
   InitBuiltinTypes();
+  // The shared constants are created up front, so that they can be used
+  // by several threads without any synchronization.
+  for(int64_t Value = 0; Value < 2; ++Value)
+    IntegerConstants[Value] = IntegerConstantExpr::Create(*this, SourceRange(),
+                                                          APInt(64, Value, true));
 }
 
 ASTContext::~ASTContext() {
@@ -61,6 +70,44 @@ void ASTContext::InitBuiltinTypes() {
   NoLengthCharacterTy = QualType(getCharacterType(0), 0);
 }
 
+IntegerConstantExpr *ASTContext::getIntegerConstant(int64_t Value) {
+  if(Value != 0 && Value != 1)
+    return IntegerConstantExpr::Create(*this, SourceRange(),
+                                       APInt(64, Value, true));
+  return IntegerConstants[Value];
+}
+
+llvm::BumpPtrAllocator &ASTContext::getThreadAllocator() const {
+  if(auto Alloc = ThreadAllocator.get())
+    return *Alloc;
+  llvm::sys::ScopedLock Lock(ThreadAllocatorsLock);
+  ThreadAllocators.emplace_back(new llvm::BumpPtrAllocator);
+  ThreadAllocator.set(ThreadAllocators.back().get());
+  return *ThreadAllocators.back();
+}
+
+size_t ASTContext::getASTAllocatedMemory() const {
+  size_t Result = BumpAlloc.getTotalMemory();
+  llvm::sys::ScopedLock Lock(ThreadAllocatorsLock);
+  for(const auto &Alloc : ThreadAllocators)
+    Result += Alloc->getTotalMemory();
+  return Result;
+}
+
+void ASTContext::addType(Type *T) const {
+  OptionalScopedLock Lock(TypesLock, ConcurrentAccess);
+  Types.push_back(T);
+}
+
+void ASTContext::PrintStats() const {
+  llvm::errs() << "\n*** AST Context Stats:\n";
+  Expr::PrintStats(llvm::errs());
+  Stmt::PrintStats(llvm::errs());
+  llvm::errs() << "Total memory used by the AST allocator: "
+               << getASTAllocatedMemory() << " bytes\n";
+  BumpAlloc.PrintStats();
+}
+
 const llvm::fltSemantics&  ASTContext::getFPTypeSemantics(QualType Type) {
   switch(Type->getBuiltinTypeKind()) {
   case BuiltinType::Real4:  return llvm::APFloat::IEEEsingle;
@@ -107,25 +154,25 @@ QualType ASTContext::getExtQualType(const Type *BaseType, Qualifiers Quals) cons
   // Check if we've already instantiated this type.
   llvm::FoldingSetNodeID ID;
   ExtQuals::Profile(ID, BaseType, Quals);
-  void *InsertPos = 0;
-  if (ExtQuals *EQ = ExtQualNodes.FindNodeOrInsertPos(ID, InsertPos)) {
+  if (ExtQuals *EQ = ExtQualNodes.find(ID, ConcurrentAccess)) {
     assert(EQ->getQualifiers() == Quals);
     return QualType(EQ, 0);
   }
 
   // If the base type is not canonical, make the appropriate canonical type.
+  // This is done before the new type's shard is locked, as the canonical
+  // type might belong to the same shard.
   QualType Canon;
   if (!BaseType->isCanonicalUnqualified()) {
     SplitQualType CanonSplit = BaseType->getCanonicalTypeInternal().split();
     CanonSplit.second.addConsistentQualifiers(Quals);
     Canon = getExtQualType(CanonSplit.first, CanonSplit.second);
-
-    // Re-find the insert position.
-    (void) ExtQualNodes.FindNodeOrInsertPos(ID, InsertPos);
   }
 
-  ExtQuals *EQ = new (*this, TypeAlignment) ExtQuals(BaseType, Canon, Quals);
-  ExtQualNodes.InsertNode(EQ, InsertPos);
+  // Another thread might have created the type in the meantime.
+  ExtQuals *EQ = ExtQualNodes.getOrInsert(ID, ConcurrentAccess, [&] {
+    return new (*this, TypeAlignment) ExtQuals(BaseType, Canon, Quals);
+  });
   return QualType(EQ, 0);
 }
 
@@ -171,30 +218,24 @@ BuiltinType *ASTContext::getBuiltinType(BuiltinType::TypeSpec TS,
                        IsDoublePrecisionKindSpecified,
                        IsByteKindSpecified);
 
-  void *InsertPos = 0;
-  if (auto BT = BuiltinTypes.FindNodeOrInsertPos(ID, InsertPos))
+  return BuiltinTypes.getOrInsert(ID, ConcurrentAccess, [&] {
+    auto BT = new (*this, TypeAlignment) BuiltinType(TS, Kind, IsKindExplicitlySpecified,
+                                                     IsDoublePrecisionKindSpecified,
+                                                     IsByteKindSpecified);
+    addType(BT);
     return BT;
-
-  auto BT = new (*this, TypeAlignment) BuiltinType(TS, Kind, IsKindExplicitlySpecified,
-                                                   IsDoublePrecisionKindSpecified,
-                                                   IsByteKindSpecified);
-  Types.push_back(BT);
-  BuiltinTypes.InsertNode(BT, InsertPos);
-  return BT;
+  });
 }
 
 CharacterType *ASTContext::getCharacterType(uint64_t Length) const {
   llvm::FoldingSetNodeID ID;
   CharacterType::Profile(ID, Length);
 
-  void *InsertPos = 0;
-  if (auto CT = CharTypes.FindNodeOrInsertPos(ID, InsertPos))
+  return CharTypes.getOrInsert(ID, ConcurrentAccess, [&] {
+    auto CT = new (*this, TypeAlignment) CharacterType(Length);
+    addType(CT);
     return CT;
-
-  auto CT = new (*this, TypeAlignment) CharacterType(Length);
-  Types.push_back(CT);
-  CharTypes.InsertNode(CT, InsertPos);
-  return CT;
+  });
 }
 
 /// getPointerType - Return the uniqued reference to the type for a pointer to
@@ -205,14 +246,11 @@ PointerType *ASTContext::getPointerType(const Type *Ty, unsigned NumDims) {
   llvm::FoldingSetNodeID ID;
   PointerType::Profile(ID, Ty, NumDims);
 
-  void *InsertPos = 0;
-  if (PointerType *PT = PointerTypes.FindNodeOrInsertPos(ID, InsertPos))
-    return PT;
-
-  PointerType *New = new (*this, TypeAlignment) PointerType(Ty, NumDims);
-  Types.push_back(New);
-  PointerTypes.InsertNode(New, InsertPos);
-  return New;
+  return PointerTypes.getOrInsert(ID, ConcurrentAccess, [&] {
+    PointerType *New = new (*this, TypeAlignment) PointerType(Ty, NumDims);
+    addType(New);
+    return New;
+  });
 }
 
 /// getArrayType - Return the unique reference to the type for an array of the
@@ -221,7 +259,7 @@ QualType ASTContext::getArrayType(QualType EltTy,
                                   ArrayRef<ArraySpec*> Dims) {
   ArrayType *New = new (*this, TypeAlignment) ArrayType(*this, Type::Array, EltTy,
                                                         QualType(), Dims);
-  Types.push_back(New);
+  addType(New);
   return QualType(New, 0);
 }
 
@@ -229,13 +267,11 @@ QualType ASTContext::getFunctionType(QualType ResultType, const FunctionDecl *Pr
   llvm::FoldingSetNodeID ID;
   FunctionType::Profile(ID, ResultType, Prototype);
 
-  void *InsertPos = 0;
-  FunctionType *Result = FunctionTypes.FindNodeOrInsertPos(ID, InsertPos);
-  if(!Result) {
-    Result = FunctionType::Create(*this, ResultType, Prototype);
-    Types.push_back(Result);
-    FunctionTypes.InsertNode(Result, InsertPos);
-  }
+  FunctionType *Result = FunctionTypes.getOrInsert(ID, ConcurrentAccess, [&] {
+    auto New = FunctionType::Create(*this, ResultType, Prototype);
+    addType(New);
+    return New;
+  });
   return QualType(Result, 0);
 }
 
@@ -255,6 +291,7 @@ QualType ASTContext::getTypeDeclTypeSlow(const TypeDecl *Decl) {
 }
 
 QualType ASTContext::getRecordType(const RecordDecl *Record) {
+  OptionalScopedLock Lock(RecordTypesLock, ConcurrentAccess);
   if (Record->TypeForDecl) return QualType(Record->TypeForDecl, 0);
 
   SmallVector<FieldDecl*, 8> Fields;
@@ -267,7 +304,7 @@ QualType ASTContext::getRecordType(const RecordDecl *Record) {
   }
   RecordType *newType = new (*this, TypeAlignment) RecordType(*this, Record, Fields);
   Record->TypeForDecl = newType;
-  Types.push_back(newType);
+  addType(newType);
   return QualType(newType, 0);
 }
 
@@ -13,10 +13,56 @@
 #include "flang/AST/ASTContext.h"
 #include "flang/AST/Decl.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace flang {
 
+//===----------------------------------------------------------------------===//
+// Expression statistics
+//===----------------------------------------------------------------------===//
+
+static struct ExprClassNameTable {
+  const char *Name;
+  unsigned Counter;
+  unsigned Size;
+} ExprClassInfo[] = {
+  { "NoExpr", 0, 0 },
+#define EXPR(CLASS, PARENT) { #CLASS, 0, sizeof(CLASS) },
+#define ABSTRACT_EXPR(EXPR)
+#include "flang/AST/ExprNodes.inc"
+};
+
+static_assert(llvm::array_lengthof(ExprClassInfo) <= 256,
+              "Expr::ExprID is too small to store the expression class");
+
+bool Expr::StatisticsEnabled = false;
+
+void Expr::EnableStatistics() {
+  StatisticsEnabled = true;
+}
+
+void Expr::addExprClass(ExprClass C) {
+  ++ExprClassInfo[C].Counter;
+}
+
+void Expr::PrintStats(llvm::raw_ostream &OS) {
+  unsigned Count = 0, Bytes = 0;
+  for(const auto &Info : ExprClassInfo) {
+    Count += Info.Counter;
+    Bytes += Info.Counter * Info.Size;
+  }
+  OS << "  " << Count << " exprs total.\n";
+  for(const auto &Info : ExprClassInfo) {
+    if(!Info.Counter) continue;
+    OS << "    " << Info.Counter << " " << Info.Name << ", "
+       << Info.Size << " each (" << Info.Counter * Info.Size << " bytes)\n";
+  }
+  OS << "Total bytes = " << Bytes
+     << " (not counting the trailing arguments)\n";
+}
+
 void APNumericStorage::setIntValue(ASTContext &C, const APInt &Val) {
   if (hasAllocation())
     C.Deallocate(pVal, sizeof(uint64_t) * llvm::APInt::getNumWords(BitWidth));
@@ -60,6 +106,10 @@ IntegerConstantExpr *IntegerConstantExpr::Create(ASTContext &C, SourceRange Rang
   return new (C) IntegerConstantExpr(C, Range, Value);
 }
 
+IntegerConstantExpr *IntegerConstantExpr::Create(ASTContext &C, int64_t Value) {
+  return C.getIntegerConstant(Value);
+}
+
 RealConstantExpr::RealConstantExpr(ASTContext &C, SourceRange Range, llvm::StringRef Data,
                                    QualType Type)
   : ConstantExpr(RealConstantExprClass, Type, Range.Start, Range.End) {
@@ -183,19 +233,6 @@ SourceLocation RepeatedConstantExpr::getLocEnd() const {
   return E->getLocEnd();
 }
 
-MultiArgumentExpr::MultiArgumentExpr(ASTContext &C, ArrayRef<Expr*> Args) {
-  NumArguments = Args.size();
-  if(NumArguments == 0)
-    Arguments = nullptr;
-  else if(NumArguments == 1)
-    Argument = Args[0];
-  else {
-    Arguments = new (C) Expr *[NumArguments];
-    for (unsigned I = 0; I != NumArguments; ++I)
-      Arguments[I] = Args[I];
-  }
-}
-
 SourceLocation DesignatorExpr::getLocStart() const {
   return Target->getLocStart();
 }
@@ -235,13 +272,15 @@ ArrayElementExpr::ArrayElementExpr(ASTContext &C, SourceLocation Loc, Expr *E,
   : DesignatorExpr(ArrayElementExprClass,
                    E->getType()->asArrayType()->getElementType(),
                    Loc, E),
-    MultiArgumentExpr(C, Subs) {
+    MultiArgumentExpr(Subs) {
 }
 
 ArrayElementExpr *ArrayElementExpr::Create(ASTContext &C, SourceLocation Loc,
                                            Expr *Target,
                                            llvm::ArrayRef<Expr *> Subscripts) {
-  return new(C) ArrayElementExpr(C, Loc, Target, Subscripts);
+  void *Mem = C.AllocateWithTrailing<ArrayElementExpr, Expr*>(
+                getNumTrailingArguments(Subscripts.size()));
+  return new(Mem) ArrayElementExpr(C, Loc, Target, Subscripts);
 }
 
 SourceLocation ArrayElementExpr::getLocEnd() const {
@@ -253,13 +292,15 @@ ArraySectionExpr::ArraySectionExpr(ASTContext &C, SourceLocation Loc,
                                    ArrayRef<Expr*> Subscripts,
                                    QualType T)
   : DesignatorExpr(ArraySectionExprClass, T, Loc, E),
-    MultiArgumentExpr(C, Subscripts) {
+    MultiArgumentExpr(Subscripts) {
 }
 
 ArraySectionExpr *ArraySectionExpr::Create(ASTContext &C, SourceLocation Loc,
                                            Expr *Target, ArrayRef<Expr*> Subscripts,
                                            QualType T) {
-  return new(C) ArraySectionExpr(C, Loc, Target, Subscripts, T);
+  void *Mem = C.AllocateWithTrailing<ArraySectionExpr, Expr*>(
+                getNumTrailingArguments(Subscripts.size()));
+  return new(Mem) ArraySectionExpr(C, Loc, Target, Subscripts, T);
 }
 
 SourceLocation ArraySectionExpr::getLocEnd() const {
@@ -396,13 +437,15 @@ SourceLocation ImplicitCastExpr::getLocEnd() const {
 
 CallExpr::CallExpr(ASTContext &C, SourceLocation Loc,
                    FunctionDecl *Func, ArrayRef<Expr*> Args)
-  : Expr(CallExprClass, Func->getType(), Loc), MultiArgumentExpr(C, Args),
+  : Expr(CallExprClass, Func->getType(), Loc), MultiArgumentExpr(Args),
     Function(Func) {
 }
 
 CallExpr *CallExpr::Create(ASTContext &C, SourceLocation Loc,
                            FunctionDecl *Func, ArrayRef<Expr*> Args) {
-  return new(C) CallExpr(C, Loc, Func, Args);
+  void *Mem = C.AllocateWithTrailing<CallExpr, Expr*>(
+                getNumTrailingArguments(Args.size()));
+  return new(Mem) CallExpr(C, Loc, Func, Args);
 }
 
 SourceLocation CallExpr::getLocEnd() const {
@@ -416,7 +459,7 @@ IntrinsicCallExpr(ASTContext &C, SourceLocation Loc,
                           ArrayRef<Expr*> Args,
                           QualType ReturnType)
   : Expr(IntrinsicCallExprClass, ReturnType, Loc),
-    MultiArgumentExpr(C, Args), Function(Func) {
+    MultiArgumentExpr(Args), Function(Func) {
 }
 
 IntrinsicCallExpr *IntrinsicCallExpr::
@@ -424,7 +467,9 @@ Create(ASTContext &C, SourceLocation Loc,
        intrinsic::FunctionKind Func,
        ArrayRef<Expr*> Arguments,
        QualType ReturnType) {
-  return new(C) IntrinsicCallExpr(C, Loc, Func, Arguments,
+  void *Mem = C.AllocateWithTrailing<IntrinsicCallExpr, Expr*>(
+                getNumTrailingArguments(Arguments.size()));
+  return new(Mem) IntrinsicCallExpr(C, Loc, Func, Arguments,
                                           ReturnType);
 }
 
@@ -436,8 +481,8 @@ ImpliedDoExpr::ImpliedDoExpr(ASTContext &C, SourceLocation Loc,
                              VarDecl *Var, ArrayRef<Expr*> Body,
                              Expr *InitialParam, Expr *TerminalParam,
                              Expr *IncrementationParam)
-  : Expr(ImpliedDoExprClass, QualType(), Loc), DoVar(Var),
-    DoList(C, Body), Init(InitialParam), Terminate(TerminalParam),
+  : Expr(ImpliedDoExprClass, QualType(), Loc), MultiArgumentExpr(Body),
+    DoVar(Var), Init(InitialParam), Terminate(TerminalParam),
     Increment(IncrementationParam) {
 }
 
@@ -445,7 +490,9 @@ ImpliedDoExpr *ImpliedDoExpr::Create(ASTContext &C, SourceLocation Loc,
                                      VarDecl *DoVar, ArrayRef<Expr*> Body,
                                      Expr *InitialParam, Expr *TerminalParam,
                                      Expr *IncrementationParam) {
-  return new(C) ImpliedDoExpr(C, Loc, DoVar, Body, InitialParam,
+  void *Mem = C.AllocateWithTrailing<ImpliedDoExpr, Expr*>(
+                getNumTrailingArguments(Body.size()));
+  return new(Mem) ImpliedDoExpr(C, Loc, DoVar, Body, InitialParam,
                               TerminalParam, IncrementationParam);
 }
 
@@ -456,12 +503,14 @@ SourceLocation ImpliedDoExpr::getLocEnd() const {
 ArrayConstructorExpr::ArrayConstructorExpr(ASTContext &C, SourceLocation Loc,
                                            ArrayRef<Expr*> Items, QualType Ty)
   : Expr(ArrayConstructorExprClass, Ty, Loc),
-    MultiArgumentExpr(C, Items) {
+    MultiArgumentExpr(Items) {
 }
 
 ArrayConstructorExpr *ArrayConstructorExpr::Create(ASTContext &C, SourceLocation Loc,
                                                    ArrayRef<Expr*> Items, QualType Ty) {
-  return new(C) ArrayConstructorExpr(C, Loc, Items, Ty);
+  void *Mem = C.AllocateWithTrailing<ArrayConstructorExpr, Expr*>(
+                getNumTrailingArguments(Items.size()));
+  return new(Mem) ArrayConstructorExpr(C, Loc, Items, Ty);
 }
 
 SourceLocation ArrayConstructorExpr::getLocEnd() const {
@@ -474,12 +523,14 @@ TypeConstructorExpr::TypeConstructorExpr(ASTContext &C, SourceLocation Loc,
                                          const RecordDecl *record,
                                          ArrayRef<Expr*> Arguments, QualType T)
   : Expr(TypeConstructorExprClass, T, Loc),
-    MultiArgumentExpr(C, Arguments), Record(record) { }
+    MultiArgumentExpr(Arguments), Record(record) { }
 
 TypeConstructorExpr *TypeConstructorExpr::Create(ASTContext &C, SourceLocation Loc,
                                                  const RecordDecl *Record,
                                                  ArrayRef<Expr*> Arguments) {
-  return new(C) TypeConstructorExpr(C, Loc, Record, Arguments, C.getRecordType(Record));
+  void *Mem = C.AllocateWithTrailing<TypeConstructorExpr, Expr*>(
+                getNumTrailingArguments(Arguments.size()));
+  return new(Mem) TypeConstructorExpr(C, Loc, Record, Arguments, C.getRecordType(Record));
 }
 
 SourceLocation TypeConstructorExpr::getLocEnd() const {
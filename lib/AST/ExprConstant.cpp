@@ -341,20 +341,23 @@ uint64_t EvaluatedArraySpec::EvaluateOffset(int64_t Index) const {
   return uint64_t(I);
 }
 
-bool ArraySpec::Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx) const {
+bool ArraySpec::Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx,
+                         const ExprEvalScope *Scope) const {
   return false;
 }
 
-bool ExplicitShapeSpec::Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx) const {
+bool ExplicitShapeSpec::Evaluate(EvaluatedArraySpec &Spec, const ASTContext &Ctx,
+                                 const ExprEvalScope *Scope) const {
   if(getLowerBound()) {
-    if(!getLowerBound()->EvaluateAsInt(Spec.LowerBound, Ctx))
+    if(!getLowerBound()->EvaluateAsInt(Spec.LowerBound, Ctx, Scope))
       return false;
   } else Spec.LowerBound = 1;
-  if(!getUpperBound()->EvaluateAsInt(Spec.UpperBound, Ctx))
+  if(!getUpperBound()->EvaluateAsInt(Spec.UpperBound, Ctx, Scope))
     return false;
+  // The array has no elements when the upper bound is less than
+  // the lower bound.
   auto Sz = Spec.UpperBound - Spec.LowerBound + 1;
-  assert(Sz > 0);
-  Spec.Size = uint64_t(Sz);
+  Spec.Size = Sz > 0? uint64_t(Sz) : 0;
   return true;
 }
 
@@ -16,7 +16,9 @@
 #include "flang/AST/StorageSet.h"
 #include "flang/AST/ASTContext.h"
 #include "flang/Basic/IdentifierTable.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace flang {
 
@@ -26,6 +28,47 @@ namespace flang {
 
 Stmt::~Stmt() {}
 
+//===----------------------------------------------------------------------===//
+// Statement statistics
+//===----------------------------------------------------------------------===//
+
+static struct StmtClassNameTable {
+  const char *Name;
+  unsigned Counter;
+  unsigned Size;
+} StmtClassInfo[] = {
+  { "NoStmt", 0, 0 },
+#define STMT(CLASS, PARENT) { #CLASS, 0, sizeof(CLASS) },
+#define ABSTRACT_STMT(STMT)
+#include "flang/AST/StmtNodes.inc"
+};
+
+bool Stmt::StatisticsEnabled = false;
+
+void Stmt::EnableStatistics() {
+  StatisticsEnabled = true;
+}
+
+void Stmt::addStmtClass(StmtClass C) {
+  ++StmtClassInfo[C].Counter;
+}
+
+void Stmt::PrintStats(llvm::raw_ostream &OS) {
+  unsigned Count = 0, Bytes = 0;
+  for(const auto &Info : StmtClassInfo) {
+    Count += Info.Counter;
+    Bytes += Info.Counter * Info.Size;
+  }
+  OS << "  " << Count << " stmts total.\n";
+  for(const auto &Info : StmtClassInfo) {
+    if(!Info.Counter) continue;
+    OS << "    " << Info.Counter << " " << Info.Name << ", "
+       << Info.Size << " each (" << Info.Counter * Info.Size << " bytes)\n";
+  }
+  OS << "Total bytes = " << Bytes
+     << " (not counting the trailing arguments)\n";
+}
+
 //===----------------------------------------------------------------------===//
 // Statement Part Statement
 //===----------------------------------------------------------------------===//
@@ -277,13 +320,15 @@ SaveStmt *SaveStmt::Create(ASTContext &C, SourceLocation Loc,
 
 EquivalenceStmt::EquivalenceStmt(ASTContext &C, SourceLocation Loc,
                                  ArrayRef<Expr*> Objects, Expr *StmtLabel)
-  : Stmt(EquivalenceStmtClass, Loc, StmtLabel), MultiArgumentExpr(C, Objects) {
+  : Stmt(EquivalenceStmtClass, Loc, StmtLabel), MultiArgumentExpr(Objects) {
 }
 
 EquivalenceStmt *EquivalenceStmt::Create(ASTContext &C, SourceLocation Loc,
                                          ArrayRef<Expr*> Objects,
                                          Expr *StmtLabel) {
-  return new(C) EquivalenceStmt(C, Loc, Objects, StmtLabel);
+  void *Mem = C.AllocateWithTrailing<EquivalenceStmt, Expr*>(
+                getNumTrailingArguments(Objects.size()));
+  return new(Mem) EquivalenceStmt(C, Loc, Objects, StmtLabel);
 }
 
 EquivalenceSet::EquivalenceSet(ASTContext &C, ArrayRef<Object> objects)
@@ -587,12 +632,14 @@ void SelectCaseStmt::setDefaultCase(DefaultCaseStmt *S) {
 CaseStmt::CaseStmt(ASTContext &C, SourceLocation Loc,
                    ArrayRef<Expr *> Values, Expr *StmtLabel, ConstructName Name)
   : SelectionCase(CaseStmtClass, Loc, StmtLabel, Name),
-    MultiArgumentExpr(C, Values), Next(nullptr) {}
+    MultiArgumentExpr(Values), Next(nullptr) {}
 
 CaseStmt *CaseStmt::Create(ASTContext &C, SourceLocation Loc,
                            ArrayRef<Expr *> Values, Expr *StmtLabel,
                            ConstructName Name) {
-  return new(C) CaseStmt(C, Loc, Values, StmtLabel, Name);
+  void *Mem = C.AllocateWithTrailing<CaseStmt, Expr*>(
+                getNumTrailingArguments(Values.size()));
+  return new(Mem) CaseStmt(C, Loc, Values, StmtLabel, Name);
 }
 
 void CaseStmt::setNextCase(CaseStmt *S) {
@@ -677,14 +724,16 @@ ReturnStmt *ReturnStmt::Create(ASTContext &C, SourceLocation Loc, Expr * E,
 
 CallStmt::CallStmt(ASTContext &C, SourceLocation Loc,
                    FunctionDecl *Func, ArrayRef<Expr*> Args, Expr *StmtLabel)
-  : Stmt(CallStmtClass, Loc, StmtLabel), MultiArgumentExpr(C, Args),
+  : Stmt(CallStmtClass, Loc, StmtLabel), MultiArgumentExpr(Args),
     Function(Func) {
 }
 
 CallStmt *CallStmt::Create(ASTContext &C, SourceLocation Loc,
                            FunctionDecl *Func, ArrayRef<Expr*> Args,
                            Expr *StmtLabel) {
-  return new(C) CallStmt(C, Loc, Func, Args, StmtLabel);
+  void *Mem = C.AllocateWithTrailing<CallStmt, Expr*>(
+                getNumTrailingArguments(Args.size()));
+  return new(Mem) CallStmt(C, Loc, Func, Args, StmtLabel);
 }
 
 //===----------------------------------------------------------------------===//
@@ -708,12 +757,14 @@ AssignmentStmt *AssignmentStmt::Create(ASTContext &C, SourceLocation Loc, Expr *
 PrintStmt::PrintStmt(ASTContext &C, SourceLocation L, FormatSpec *fs,
                      ArrayRef<Expr*> OutList, Expr *StmtLabel)
   : Stmt(PrintStmtClass, L, StmtLabel),
-    MultiArgumentExpr(C, OutList), FS(fs) {}
+    MultiArgumentExpr(OutList), FS(fs) {}
 
 PrintStmt *PrintStmt::Create(ASTContext &C, SourceLocation L, FormatSpec *fs,
                              ArrayRef<Expr*> OutList,
                              Expr *StmtLabel) {
-  return new (C) PrintStmt(C, L, fs, OutList, StmtLabel);
+  void *Mem = C.AllocateWithTrailing<PrintStmt, Expr*>(
+                getNumTrailingArguments(OutList.size()));
+  return new(Mem) PrintStmt(C, L, fs, OutList, StmtLabel);
 }
 
 //===----------------------------------------------------------------------===//
@@ -723,12 +774,14 @@ PrintStmt *PrintStmt::Create(ASTContext &C, SourceLocation L, FormatSpec *fs,
 WriteStmt::WriteStmt(ASTContext &C, SourceLocation Loc, UnitSpec *us,
                      FormatSpec *fs, ArrayRef<Expr*> OutList, Expr *StmtLabel)
   : Stmt(WriteStmtClass, Loc, StmtLabel),
-    MultiArgumentExpr(C, OutList), US(us), FS(fs) {
+    MultiArgumentExpr(OutList), US(us), FS(fs) {
 }
 
 WriteStmt *WriteStmt::Create(ASTContext &C, SourceLocation Loc, UnitSpec *US,
                              FormatSpec *FS, ArrayRef<Expr*> OutList, Expr *StmtLabel) {
-  return new(C) WriteStmt(C, Loc, US, FS, OutList, StmtLabel);
+  void *Mem = C.AllocateWithTrailing<WriteStmt, Expr*>(
+                getNumTrailingArguments(OutList.size()));
+  return new(Mem) WriteStmt(C, Loc, US, FS, OutList, StmtLabel);
 }
 
 } //namespace flang
@@ -16,6 +16,7 @@
 #include "flang/AST/Type.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 
@@ -38,6 +39,7 @@ void DiagnosticsEngine::Reset() {
   NumWarnings = 0;
   NumErrors = 0;
   NumErrorsSuppressed = 0;
+  NumWarningsSuppressed = 0;
   TrapNumErrorsOccurred = 0;
   TrapNumUnrecoverableErrorsOccurred = 0;
 
@@ -49,6 +51,7 @@ void DiagnosticsEngine::Reset() {
   DiagStates.clear();
   DiagStatePoints.clear();
   DiagStateOnPushStack.clear();
+  CachedLevels.clear();
 
   // Create a DiagState and DiagStatePoint representing diagnostic changes
   // through command-line.
@@ -56,6 +59,21 @@ void DiagnosticsEngine::Reset() {
   DiagStatePoints.push_back(DiagStatePoint(&DiagStates.back(), SourceLocation()));
 }
 
+bool DiagnosticsEngine::isIgnoredSlow(unsigned DiagID) const {
+  // Custom diagnostics can't be mapped, so they are never ignored.
+  if (DiagID >= diag::DIAG_UPPER_LIMIT)
+    return false;
+  if (CachedLevels.empty())
+    CachedLevels.resize(diag::DIAG_UPPER_LIMIT);
+
+  // The diagnostic state doesn't depend on the location, so the level is
+  // the same for all the reports of this diagnostic.
+  DiagnosticIDs::Level Level =
+    Diags->getDiagnosticLevel(DiagID, SourceLocation(), *this);
+  CachedLevels[DiagID] = Level + 1;
+  return Level == DiagnosticIDs::Ignored;
+}
+
 void DiagnosticsEngine::ReportDelayed() {
   Report(DelayedDiagID) << DelayedDiagArg1 << DelayedDiagArg2;
   DelayedDiagID = 0;
@@ -96,6 +114,7 @@ void DiagnosticsEngine::setDiagnosticMapping(diag::kind Diag, diag::Mapping Map,
          "Cannot map errors into warnings!");
   assert(!DiagStatePoints.empty());
   assert((L.isValid() || SrcMgr) && "No SourceMgr for valid location");
+  CachedLevels.clear();
 
   SourceLocation Loc = L;
   SourceLocation LastStateChangePos = DiagStatePoints.back().Loc;
@@ -154,6 +173,27 @@ void DiagnosticsEngine::setDiagnosticMapping(diag::kind Diag, diag::Mapping Map,
                                                Loc));
 }
 
+bool DiagnosticsEngine::setDiagnosticGroupMapping(StringRef Group,
+                                                  diag::Mapping Map,
+                                                  SourceLocation Loc) {
+  // Get the diagnostics in this group.
+  SmallVector<diag::kind, 8> GroupDiags;
+  if (Diags->getDiagnosticsInGroup(Group, GroupDiags))
+    return true;
+
+  // Set the mapping.
+  for (unsigned i = 0, e = GroupDiags.size(); i != e; ++i)
+    setDiagnosticMapping(GroupDiags[i], Map, Loc);
+
+  return false;
+}
+
+void DiagnosticsEngine::copyMappings(const DiagnosticsEngine &Other) {
+  CachedLevels.clear();
+  for (const auto &I : *Other.GetCurDiagState())
+    GetCurDiagState()->setMappingInfo(I.first, I.second);
+}
+
 bool DiagnosticsEngine::EmitCurrentDiagnostic(bool Force) {
   assert(getClient() && "DiagnosticClient not set!");
 
@@ -194,7 +234,8 @@ bool DiagnosticsEngine::EmitCurrentDiagnostic(bool Force) {
 /// \return The return value is always true, as an idiomatic convenience to
 /// clients.
 bool DiagnosticsEngine::ReportError(SourceLocation L, const llvm::Twine &Msg) {
-  Client->HandleDiagnostic(Error, L, Msg);
+  if (!SuppressAllDiagnostics)
+    Client->HandleDiagnostic(Error, L, Msg);
   return true;
 }
 
@@ -204,7 +245,8 @@ bool DiagnosticsEngine::ReportError(SourceLocation L, const llvm::Twine &Msg) {
 /// \return The return value is always true, as an idiomatic convenience to
 /// clients.
 bool DiagnosticsEngine::ReportWarning(SourceLocation L, const llvm::Twine &Msg) {
-  Client->HandleDiagnostic(Warning, L, Msg);
+  if (!SuppressAllDiagnostics)
+    Client->HandleDiagnostic(Warning, L, Msg);
   return true;
 }
 
@@ -214,7 +256,26 @@ bool DiagnosticsEngine::ReportWarning(SourceLocation L, const llvm::Twine &Msg)
 /// \return The return value is always true, as an idiomatic convenience to
 /// clients.
 bool DiagnosticsEngine::ReportNote(SourceLocation L, const llvm::Twine &Msg) {
-  Client->HandleDiagnostic(Note, L, Msg);
+  if (!SuppressAllDiagnostics)
+    Client->HandleDiagnostic(Note, L, Msg);
+  return true;
+}
+
+bool DiagnosticsEngine::ReportFormatted(Level DiagLevel, SourceLocation L,
+                                        const llvm::Twine &Msg,
+                                        llvm::ArrayRef<SourceRange> Ranges) {
+  if (SuppressAllDiagnostics || DiagLevel == Ignored)
+    return false;
+  // A note follows the diagnostic which it is attached to.
+  if (DiagLevel == Note) {
+    if (LastDiagLevel == DiagnosticIDs::Ignored)
+      return false;
+  } else {
+    LastDiagLevel = (DiagnosticIDs::Level)DiagLevel;
+    if (!Diags->CountDiag(*this, LastDiagLevel))
+      return false;
+  }
+  Client->HandleDiagnostic(DiagLevel, L, Msg, Ranges);
   return true;
 }
 
@@ -234,6 +295,17 @@ void DiagnosticClient::HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
     ++NumErrors;
 }
 
+void DiagnosticClient::HandleSuppressedDiagnostic(
+                         DiagnosticsEngine::Level DiagLevel) {
+  if (!IncludeInDiagnosticCounts())
+    return;
+
+  if (DiagLevel == DiagnosticsEngine::Warning)
+    ++NumWarnings;
+  else if (DiagLevel >= DiagnosticsEngine::Error)
+    ++NumErrors;
+}
+
 static inline bool isDigit(char c) {
   return c >= '0' && c <= '9';
 }
@@ -570,8 +570,8 @@ StringRef DiagnosticIDs::getNearestWarningOption(StringRef Group) {
 bool DiagnosticIDs::ProcessDiag(DiagnosticsEngine &Diag) const {
   Diagnostic Info(&Diag);
 
-  //if (Diag.SuppressAllDiagnostics)
-  //  return false;
+  if (Diag.SuppressAllDiagnostics)
+    return false;
 
   assert(Diag.getClient() && "DiagnosticClient not set!");
 
@@ -588,7 +588,7 @@ bool DiagnosticIDs::ProcessDiag(DiagnosticsEngine &Diag) const {
     //if (Diag.LastDiagLevel == DiagnosticIDs::Fatal)
     //  Diag.FatalErrorOccurred = true;
 
-    //Diag.LastDiagLevel = DiagLevel;
+    Diag.LastDiagLevel = DiagLevel;
   }
 
   // Update counts for DiagnosticErrorTrap even if a fatal error occurred.
@@ -610,8 +610,6 @@ bool DiagnosticIDs::ProcessDiag(DiagnosticsEngine &Diag) const {
     return false;
   }
 
-  Diag.LastDiagLevel = DiagLevel;
-
   // If the client doesn't care about this message, don't issue it.  If this is
   // a note and the last real diagnostic was ignored, ignore it too.
   if (DiagLevel == DiagnosticIDs::Ignored ||
@@ -626,23 +624,49 @@ bool DiagnosticIDs::ProcessDiag(DiagnosticsEngine &Diag) const {
     // Warnings which have been upgraded to errors do not prevent compilation.
     if (isDefaultMappingAsError(DiagID))
       Diag.UncompilableErrorOccurred = true;
+  }
+
+  if (!CountDiag(Diag, DiagLevel))
+    return false;
 
+  // Finally, report it.
+  EmitDiag(Diag, DiagLevel);
+  return true;
+}
+
+bool DiagnosticIDs::CountDiag(DiagnosticsEngine &Diag, Level DiagLevel) const {
+  if (DiagLevel >= DiagnosticIDs::Error) {
     Diag.ErrorOccurred = true;
     if (Diag.Client->IncludeInDiagnosticCounts()) {
       ++Diag.NumErrors;
     }
 
-    // If we've emitted a lot of errors, emit a fatal error instead of it to
-    // stop a flood of bogus errors.
-    /*if (Diag.ErrorLimit && Diag.NumErrors > Diag.ErrorLimit &&
+    // Once the error limit is reached, the errors are only counted.
+    if (Diag.ErrorLimit && Diag.NumErrors > Diag.ErrorLimit &&
         DiagLevel == DiagnosticIDs::Error) {
-      Diag.SetDelayedDiagnostic(diag::fatal_too_many_errors);
+      if (!Diag.NumErrorsSuppressed++)
+        Diag.ReportNote(SourceLocation(),
+                        getDescription(diag::note_error_limit_reached));
+      Diag.LastDiagLevel = DiagnosticIDs::Ignored;
+      Diag.Client->HandleSuppressedDiagnostic(DiagnosticsEngine::Error);
       return false;
-    }*/
+    }
   }
 
-  // Finally, report it.
-  EmitDiag(Diag, DiagLevel);
+  if (DiagLevel == DiagnosticIDs::Warning) {
+    if (Diag.Client->IncludeInDiagnosticCounts())
+      ++Diag.NumWarnings;
+
+    // Once the warning limit is reached, the warnings are only counted.
+    if (Diag.WarningLimit && Diag.NumWarnings > Diag.WarningLimit) {
+      if (!Diag.NumWarningsSuppressed++)
+        Diag.ReportNote(SourceLocation(),
+                        getDescription(diag::note_warning_limit_reached));
+      Diag.LastDiagLevel = DiagnosticIDs::Ignored;
+      Diag.Client->HandleSuppressedDiagnostic(DiagnosticsEngine::Warning);
+      return false;
+    }
+  }
   return true;
 }
 
@@ -16,7 +16,9 @@
 #include "flang/Basic/LangOptions.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/StringRef.h"
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 using namespace flang;
 
 //===----------------------------------------------------------------------===//
@@ -39,60 +41,36 @@ IdentifierTable::IdentifierTable(const LangOptions &LangOpts,
     FormatSpecHashTable(32),   // Start with space for 32 format specs.
     ExternalLookup(externalLookup) {
 
-  // Populate the identifier table with info about keywords for the current
-  // language.
-  AddPredefineds(LangOpts);
+  // The keywords are recognized by the generated matchers, and their
+  // identifier infos are created when they are first seen.
+  EnabledKeywords = tok::KEYALL;
+  if (LangOpts.Fortran77) EnabledKeywords |= tok::KEYF77;
+  else EnabledKeywords |= tok::KEYNOTF77;
+  if (LangOpts.Fortran90) EnabledKeywords |= tok::KEYF90;
+  if (LangOpts.Fortran95) EnabledKeywords |= tok::KEYF95;
+  if (LangOpts.Fortran2003) EnabledKeywords |= tok::KEYF2003;
+  if (LangOpts.Fortran2008) EnabledKeywords |= tok::KEYF2008;
+  std::fill(std::begin(PredefinedInfos), std::end(PredefinedInfos), nullptr);
 }
 
-//===----------------------------------------------------------------------===//
-// Language Keyword Implementation
-//===----------------------------------------------------------------------===//
-
-// Constants for TokenKinds.def
-namespace {
-  enum {
-    KEYALL    = 0x01,
-    KEYF77    = 0x02,
-    KEYF90    = 0x04,
-    KEYF95    = 0x08,
-    KEYF2003  = 0x10,
-    KEYF2008  = 0x20,
-    KEYNOTF77 = 0x40
-  };
-}
-
-/// AddPredefined - This method is used to associate a token ID with specific
-/// identifiers because they are language keywords or built-ins. This causes the
-/// lexer to automatically map matching identifiers to specialized token codes.
-static void AddPredefined(llvm::StringRef ID, tok::TokenKind TokenCode,
-                          unsigned Flags, const LangOptions &LangOpts,
-                          IdentifierTable &Table, bool isFormatSpec) {
-  if ((Flags & KEYALL) ||
-      (!LangOpts.Fortran77 && (Flags & KEYNOTF77)) ||
-      (LangOpts.Fortran77 && (Flags & KEYF77)) ||
-      (LangOpts.Fortran90 && (Flags & KEYF90)) ||
-      (LangOpts.Fortran95 && (Flags & KEYF95)) ||
-      (LangOpts.Fortran2003 && (Flags & KEYF2003)) ||
-      (LangOpts.Fortran2008 && (Flags & KEYF2008))) {
-    if (!isFormatSpec)
-      Table.getKeyword(ID, TokenCode);
-    else
-      Table.getFormatSpec(ID, TokenCode);
-  }
+IdentifierInfo *IdentifierTable::lookupKeyword(llvm::StringRef Name) {
+  unsigned Flags;
+  auto Kind = tok::getKeywordKind(Name, Flags);
+  if (Kind == tok::unknown || !(Flags & EnabledKeywords))
+    return nullptr;
+  if (!PredefinedInfos[Kind])
+    PredefinedInfos[Kind] = &getKeyword(Name, Kind);
+  return PredefinedInfos[Kind];
 }
 
-/// AddPredefineds - Add all predefined identifiers to the symbol tables.
-void IdentifierTable::AddPredefineds(const LangOptions &LangOpts) {
-  // Add keywords and tokens for the current language.
-#define KEYWORD(NAME, FLAGS) \
-  AddPredefined(llvm::StringRef(#NAME), tok::kw_ ## NAME,       \
-                FLAGS, LangOpts, *this, false);
-#define FORMAT_SPEC(NAME, FLAGS) \
-  AddPredefined(llvm::StringRef(#NAME), tok::fs_ ## NAME,       \
-                FLAGS, LangOpts, *this, true);
-#undef OPERATOR
-#define OPERATOR(NAME, FLAGS)
-#include "flang/Basic/TokenKinds.def"
+IdentifierInfo *IdentifierTable::lookupFormatSpec(llvm::StringRef Name) {
+  unsigned Flags;
+  auto Kind = tok::getFormatSpecKind(Name, Flags);
+  if (Kind == tok::unknown || !(Flags & EnabledKeywords))
+    return nullptr;
+  if (!PredefinedInfos[Kind])
+    PredefinedInfos[Kind] = &getFormatSpec(Name, Kind);
+  return PredefinedInfos[Kind];
 }
 
 //===----------------------------------------------------------------------===//
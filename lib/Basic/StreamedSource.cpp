@@ -0,0 +1,183 @@
+//===--- StreamedSource.cpp - Sources which are read in chunks ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "flang/Basic/StreamedSource.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include <algorithm>
+#include <cerrno>
+
+#ifdef LLVM_ON_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace flang {
+
+/// The largest amount of text which is read at once.
+static const size_t ReadSize = 1024 * 1024;
+
+StreamedSource::StreamedSource(llvm::SourceMgr &SM, bool IsFixedForm,
+                               size_t Size)
+  : SrcMgr(SM), FD(-1), FixedForm(IsFixedForm),
+    ChunkSize(std::max(Size, size_t(1))), ReachedEnd(false), Lines(0) {}
+
+StreamedSource::~StreamedSource() {
+  if(FD > 0)
+    ::close(FD);
+}
+
+std::error_code StreamedSource::Open(StringRef Filename) {
+  if(Filename == "-") {
+    Name = "<stdin>";
+    FD = 0;
+    return std::error_code();
+  }
+  Name = Filename;
+  return llvm::sys::fs::openFileForRead(Filename, FD);
+}
+
+void StreamedSource::ReadMore(size_t Size) {
+  size_t Offset = Pending.size();
+  Pending.resize(Offset + Size);
+  while(true) {
+    auto Read = ::read(FD, Pending.data() + Offset, Size);
+    if(Read < 0 && errno == EINTR)
+      continue;
+    if(Read <= 0) {
+      // The lexer reports the errors in a truncated source.
+      ReachedEnd = true;
+      Read = 0;
+    }
+    Pending.resize(Offset + Read);
+    return;
+  }
+}
+
+static bool IsCommentOrBlank(StringRef Line, bool FixedForm) {
+  if(FixedForm && !Line.empty() &&
+     (Line[0] == 'C' || Line[0] == 'c' || Line[0] == '*'))
+    return true;
+  size_t Start = Line.find_first_not_of(" \t\r");
+  if(Start == StringRef::npos)
+    return true;
+  return Line[Start] == '!' && (!FixedForm || Start != 5);
+}
+
+/// EndsWithContinuation - Returns true if the free form line is continued
+/// on the next line.
+static bool EndsWithContinuation(StringRef Line) {
+  char Quote = '\0';
+  for(size_t I = 0; I < Line.size(); ++I) {
+    char C = Line[I];
+    if(Quote) {
+      if(C == Quote) Quote = '\0';
+    } else if(C == '\'' || C == '"')
+      Quote = C;
+    else if(C == '!') {
+      Line = Line.substr(0, I);
+      break;
+    }
+  }
+  return Line.rtrim(" \t\r").endswith("&");
+}
+
+size_t StreamedSource::FindChunkEnd() const {
+  StringRef Text(Pending.data(), Pending.size());
+  // Only the complete lines are considered.
+  size_t End = Text.rfind('\n');
+  if(End == StringRef::npos)
+    return 0;
+
+  while(End != 0) {
+    size_t LineStart = Text.rfind('\n', End - 1);
+    if(LineStart == StringRef::npos)
+      return 0;
+    ++LineStart;
+    StringRef Line = Text.slice(LineStart, End);
+    End = LineStart - 1;
+    if(IsCommentOrBlank(Line, FixedForm))
+      continue;
+
+    if(FixedForm) {
+      bool IsContinuation = Line.size() > 5 && Line[5] != ' ' &&
+                            Line[5] != '0' && Line[0] != '\t';
+      if(Line.size() > 1 && Line[0] == '\t' && Line[1] >= '1' &&
+         Line[1] <= '9')
+        IsContinuation = true;
+      if(!IsContinuation)
+        return LineStart;
+      continue;
+    }
+
+    // A free form line begins a statement when the previous
+    // line with code isn't continued.
+    size_t PrevEnd = End;
+    while(true) {
+      size_t PrevStart = PrevEnd == 0? StringRef::npos :
+                                       Text.rfind('\n', PrevEnd - 1);
+      PrevStart = PrevStart == StringRef::npos? 0 : PrevStart + 1;
+      StringRef PrevLine = Text.slice(PrevStart, PrevEnd);
+      if(!IsCommentOrBlank(PrevLine, false)) {
+        if(!EndsWithContinuation(PrevLine))
+          return LineStart;
+        break;
+      }
+      if(PrevStart == 0)
+        return LineStart;
+      PrevEnd = PrevStart - 1;
+    }
+  }
+  return 0;
+}
+
+unsigned StreamedSource::ReadNextChunk() {
+  if(ReachedEnd && Pending.empty() && !Chunks.empty())
+    return 0;
+
+  // Read at least a chunk, and then up to the start of a statement.
+  // A statement which is longer than a chunk makes the chunk bigger.
+  size_t Size = ChunkSize;
+  size_t End;
+  while(true) {
+    while(!ReachedEnd && Pending.size() < Size)
+      ReadMore(std::min(ReadSize, Size - Pending.size()));
+    if(ReachedEnd) {
+      End = Pending.size();
+      break;
+    }
+    End = FindChunkEnd();
+    if(End != 0)
+      break;
+    Size += ChunkSize;
+  }
+
+  StringRef Text(Pending.data(), End);
+  unsigned ID = SrcMgr.AddNewSourceBuffer(
+                  llvm::MemoryBuffer::getMemBufferCopy(Text, Name),
+                  llvm::SMLoc());
+  Chunks.push_back(std::make_pair(ID, Lines));
+  Lines += Text.count('\n');
+  Pending.erase(Pending.begin(), Pending.begin() + End);
+  return ID;
+}
+
+unsigned StreamedSource::getLineOffset(SourceLocation Loc) const {
+  unsigned ID = SrcMgr.FindBufferContainingLoc(Loc);
+  auto I = std::lower_bound(Chunks.begin(), Chunks.end(),
+                            std::make_pair(ID, 0u));
+  if(I == Chunks.end() || I->first != ID)
+    return 0;
+  return I->second;
+}
+
+} // end namespace flang
@@ -13,6 +13,8 @@
 
 #include "flang/Basic/TokenKinds.h"
 #include <cassert>
+#include <cctype>
+#include <cstring>
 
 namespace flang {
 
@@ -72,4 +74,32 @@ const char *tok::getTokenSimpleSpelling(enum TokenKind Kind) {
   return 0;
 }
 
+#include "flang/Basic/KeywordMatcher.inc"
+
+/// CopyUpperCase - Copies the upper case spelling of a name which isn't
+/// longer than MaxLength to the buffer. Returns false if the name is
+/// too long.
+static bool CopyUpperCase(llvm::StringRef Name, char *Buffer,
+                          unsigned MaxLength) {
+  if(Name.size() > MaxLength)
+    return false;
+  for(size_t I = 0, E = Name.size(); I != E; ++I)
+    Buffer[I] = ::toupper(Name[I]);
+  return true;
+}
+
+tok::TokenKind tok::getKeywordKind(llvm::StringRef Name, unsigned &Flags) {
+  char Buffer[MatchKeywordMaxLength];
+  if(!CopyUpperCase(Name, Buffer, MatchKeywordMaxLength))
+    return tok::unknown;
+  return MatchKeyword(llvm::StringRef(Buffer, Name.size()), Flags);
+}
+
+tok::TokenKind tok::getFormatSpecKind(llvm::StringRef Name, unsigned &Flags) {
+  char Buffer[MatchFormatSpecMaxLength];
+  if(!CopyUpperCase(Name, Buffer, MatchFormatSpecMaxLength))
+    return tok::unknown;
+  return MatchFormatSpec(llvm::StringRef(Buffer, Name.size()), Flags);
+}
+
 } //namespace flang
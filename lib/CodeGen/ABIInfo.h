@@ -112,6 +112,10 @@ class ABIInfo {
 public:
   virtual ~ABIInfo() {}
   virtual void computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const = 0;
+
+  /// computeArgTypeInfo - Adjusts the way in which an argument
+  /// that is passed by value is passed.
+  virtual void computeArgTypeInfo(QualType T, ABIArgInfo &Info) const {}
 };
 
 }  // end namespace flang
@@ -91,10 +91,19 @@ void CodeGenFunction::GetArrayDimensionsInfo(QualType T, SmallVectorImpl<ArrayDi
     llvm::Value *UB = nullptr;
     auto LowerBound = Dimensions[I]->getLowerBoundOrNull();
     auto UpperBound = Dimensions[I]->getUpperBoundOrNull();
-    if(LowerBound)
-      LB = EmitSizeIntExpr(LowerBound);
-    if(UpperBound)
-      UB = EmitSizeIntExpr(UpperBound);
+    EvaluatedArraySpec Spec;
+    if(ConstantArguments &&
+       Dimensions[I]->Evaluate(Spec, getContext(), ConstantArguments)) {
+      // The bounds use the arguments which are constant in this clone.
+      if(LowerBound)
+        LB = llvm::ConstantInt::get(CGM.SizeTy, Spec.LowerBound);
+      UB = llvm::ConstantInt::get(CGM.SizeTy, Spec.UpperBound);
+    } else {
+      if(LowerBound)
+        LB = EmitSizeIntExpr(LowerBound);
+      if(UpperBound)
+        UB = EmitSizeIntExpr(UpperBound);
+    }
     Dims.push_back(ArrayDimensionValueTy(LB, UB, I == 0? nullptr : Stride));
     if(I != Dimensions.size() - 1)
       Stride = Builder.CreateMul(Stride, EmitDimSize(Dims.back()));
@@ -136,7 +145,87 @@ llvm::Value *CodeGenFunction::EmitArrayOffset(ArrayRef<llvm::Value*> Subscripts,
 
 llvm::Value *CodeGenFunction::EmitArrayElementPtr(ArrayRef<llvm::Value*> Subscripts,
                                                   const ArrayValueRef &Value) {
-  return Builder.CreateGEP(Value.Ptr, EmitArrayOffset(Subscripts, Value));
+  return EmitArrayValueElementPtr(EmitArrayOffset(Subscripts, Value), Value);
+}
+
+llvm::Value *CodeGenFunction::EmitArrayValueElementPtr(llvm::Value *Offset,
+                                                       const ArrayValueRef &Value) {
+  if(!Value.hasComponents())
+    return Builder.CreateGEP(Value.Ptr, Offset);
+  // The selected components of a derived type element.
+  SmallVector<llvm::Value*, 4> Indices;
+  Indices.push_back(Offset);
+  for(auto I : Value.Components)
+    Indices.push_back(Builder.getInt32(I));
+  return Builder.CreateGEP(Value.Ptr, Indices);
+}
+
+void CodeGenFunction::EmitArraySubscriptCheck(llvm::Value *Subscript,
+                                              const ArrayDimensionValueTy &Dim,
+                                              int I) {
+  // S < LB || S > UB
+  auto LB = Dim.hasLowerBound()? Dim.LowerBound :
+                                 llvm::ConstantInt::get(CGM.SizeTy,1);
+  auto UB = Dim.hasUpperBound()? Dim.UpperBound :
+                                 llvm::ConstantInt::get(CGM.SizeTy,0);
+  auto Cond = Builder.CreateICmpSLT(Subscript, LB);
+  // The last dimension of an assumed size array has no upper bound.
+  if(Dim.hasUpperBound())
+    Cond = Builder.CreateOr(Cond, Builder.CreateICmpSGT(Subscript, UB));
+
+  auto ErrorBlock = createBasicBlock("subscript-out-of-bounds");
+  auto EndBlock = createBasicBlock("subscript-in-bounds");
+  Builder.CreateCondBr(Cond, ErrorBlock, EndBlock);
+  EmitBlock(ErrorBlock);
+  auto Func = CGM.GetRuntimeFunction4("subscript_out_of_bounds",
+                                      CGM.SizeTy, CGM.SizeTy,
+                                      CGM.SizeTy, CGM.SizeTy);
+  Func.getFunction()->setDoesNotReturn();
+  RValueTy Args[] = { llvm::ConstantInt::get(CGM.SizeTy, I + 1),
+                      Subscript, LB, UB };
+  EmitCall(Func, Args);
+  Builder.CreateUnreachable();
+  EmitBlock(EndBlock);
+}
+
+void CodeGenFunction::EmitArraySectionCheck(const ArrayDimensionValueTy &Dim,
+                                            llvm::Value *LB, llvm::Value *UB,
+                                            llvm::Value *Stride, int I) {
+  auto First = LB? LB : (Dim.hasLowerBound()? Dim.LowerBound :
+                                              llvm::ConstantInt::get(CGM.SizeTy,1));
+  auto Last = UB? UB : Dim.UpperBound;
+  if(!Last) {
+    if(LB)
+      EmitArraySubscriptCheck(First, Dim, I);
+    return;
+  }
+
+  // An empty section isn't checked, i.e. a section with a trip count
+  // (Last - First + Stride) / Stride which isn't positive.
+  llvm::Value *NonEmpty;
+  if(Stride) {
+    auto Count = Builder.CreateSDiv(Builder.CreateAdd(Builder.CreateSub(Last, First),
+                                                      Stride), Stride);
+    NonEmpty = Builder.CreateICmpSGT(Count, llvm::ConstantInt::get(CGM.SizeTy, 0));
+  } else
+    NonEmpty = Builder.CreateICmpSLE(First, Last);
+
+  auto CheckBlock = createBasicBlock("section-check");
+  auto EndBlock = createBasicBlock("section-check-end");
+  Builder.CreateCondBr(NonEmpty, CheckBlock, EndBlock);
+  EmitBlock(CheckBlock);
+  if(LB)
+    EmitArraySubscriptCheck(First, Dim, I);
+  if(UB) {
+    // The last element of a strided section can be before the upper bound:
+    // => First + ((Last - First) / Stride) * Stride
+    if(Stride)
+      Last = Builder.CreateAdd(First,
+               Builder.CreateMul(Builder.CreateSDiv(Builder.CreateSub(Last, First),
+                                                    Stride), Stride));
+    EmitArraySubscriptCheck(Last, Dim, I);
+  }
+  EmitBlock(EndBlock);
 }
 
 llvm::Value *CodeGenFunction::EmitSectionSize(const ArrayValueRef &Value, int I) {
@@ -221,7 +310,7 @@ void CodeGenFunction::EmitArrayElementSection(const ArrayDimensionValueTy &Dim,
 ArrayValueExprEmitter::ArrayValueExprEmitter(CodeGenFunction &cgf, bool getPointer)
   : CGF(cgf), Builder(cgf.getBuilder()),
     VMContext(cgf.getLLVMContext()), GetPointer(getPointer), Ptr(nullptr),
-    Offset(nullptr) { }
+    Offset(nullptr), SoAComponent(-1) { }
 
 void ArrayValueExprEmitter::EmitExpr(const Expr *E) {
   Visit(E);
@@ -241,7 +330,12 @@ void ArrayValueExprEmitter::VisitVarExpr(const VarExpr *E) {
   if(GetPointer) {
     if(VD->isArgument())
       Ptr = CGF.GetVarPtr(VD);
-    else
+    else if(SoAComponent != -1) {
+      auto Arr = Builder.CreateStructGEP(nullptr, CGF.GetVarPtr(VD),
+                                         SoAComponent);
+      Ptr = Builder.CreateConstInBoundsGEP2_32(
+          Arr->getType()->getArrayElementType(), Arr, 0, 0);
+    } else
       Ptr = Builder.CreateConstInBoundsGEP2_32(
           CGF.GetVarPtr(VD)->getType()->getArrayElementType(),
           CGF.GetVarPtr(VD), 0, 0);
@@ -272,29 +366,66 @@ void ArrayValueExprEmitter::IncrementOffset(llvm::Value *OffsetDelta) {
 
 void ArrayValueExprEmitter::VisitArraySectionExpr(const ArraySectionExpr *E) {
   ArrayValueExprEmitter TargetEmitter(CGF, GetPointer);
+  TargetEmitter.SoAComponent = SoAComponent;
   TargetEmitter.EmitExpr(E->getTarget());
   Offset = TargetEmitter.Offset;
   Ptr = TargetEmitter.Ptr;
+  Components.append(TargetEmitter.Components.begin(),
+                    TargetEmitter.Components.end());
 
   auto Subscripts = E->getSubscripts();
   auto TargetDims = TargetEmitter.getDimensions();
+  bool BoundsCheck = CGF.getModule().getCodeGenOpts().BoundsCheck;
   for(size_t I = 0; I < Subscripts.size(); ++I) {
     if(auto Range = dyn_cast<RangeExpr>(Subscripts[I])) {
+      auto LB = CGF.EmitSizeIntExprOrNull(Range->getFirstExpr());
+      auto UB = CGF.EmitSizeIntExprOrNull(Range->getSecondExpr());
+      if(BoundsCheck)
+        CGF.EmitArraySectionCheck(TargetDims[I], LB, UB, nullptr, I);
       Dims.push_back(CGF.EmitArrayRangeSection(TargetDims[I], Ptr, Offset,
-                       CGF.EmitSizeIntExprOrNull(Range->getFirstExpr()),
-                       CGF.EmitSizeIntExprOrNull(Range->getSecondExpr())));
+                                               LB, UB));
     } else if(auto StridedRange = dyn_cast<StridedRangeExpr>(Subscripts[I])) {
+      auto LB = CGF.EmitSizeIntExprOrNull(StridedRange->getFirstExpr());
+      auto UB = CGF.EmitSizeIntExprOrNull(StridedRange->getSecondExpr());
+      auto Stride = CGF.EmitSizeIntExprOrNull(StridedRange->getStride());
+      if(BoundsCheck)
+        CGF.EmitArraySectionCheck(TargetDims[I], LB, UB, Stride, I);
       Dims.push_back(CGF.EmitArrayRangeSection(TargetDims[I], Ptr, Offset,
-                       CGF.EmitSizeIntExprOrNull(StridedRange->getFirstExpr()),
-                       CGF.EmitSizeIntExprOrNull(StridedRange->getSecondExpr()),
-                       CGF.EmitSizeIntExprOrNull(StridedRange->getStride())));
-    } else
-      CGF.EmitArrayElementSection(TargetDims[I], Ptr, Offset,
-                                  CGF.EmitSizeIntExpr(Subscripts[I]));
+                                               LB, UB, Stride));
+    } else {
+      auto Index = CGF.EmitSizeIntExpr(Subscripts[I]);
+      if(BoundsCheck)
+        CGF.EmitArraySubscriptCheck(Index, TargetDims[I], I);
+      CGF.EmitArrayElementSection(TargetDims[I], Ptr, Offset, Index);
+    }
     // FIXME: vector sections.
   }
 }
 
+void ArrayValueExprEmitter::VisitMemberExpr(const MemberExpr *E) {
+  if(!E->getTarget()->getType()->isArrayType()) {
+    // An array component of a single structure.
+    CGF.GetArrayDimensionsInfo(E->getType(), Dims);
+    if(GetPointer) {
+      auto Arr = CGF.EmitAggregateExpr(E).getAggregateAddr();
+      Ptr = Builder.CreateConstInBoundsGEP2_32(
+          Arr->getType()->getArrayElementType(), Arr, 0, 0);
+    }
+    return;
+  }
+
+  // The component of an array with the struct of arrays layout is
+  // selected before the sections, which then step over the elements
+  // of the component's array.
+  if(SoAComponent == -1 && CGF.IsSoAArrayExpr(E->getTarget())) {
+    setSoAComponent(E->getField());
+    EmitExpr(E->getTarget());
+    return;
+  }
+  EmitExpr(E->getTarget());
+  Components.push_back(E->getField()->getIndex());
+}
+
 StandaloneArrayValueSectionGatherer::StandaloneArrayValueSectionGatherer(CodeGenFunction &cgf,
                                                                          ArrayOperation &Op)
   : CGF(cgf), Gathered(false), Operation(Op) {
@@ -343,6 +474,10 @@ void StandaloneArrayValueSectionGatherer::VisitArraySectionExpr(const ArraySecti
   GatherSections(E);
 }
 
+void StandaloneArrayValueSectionGatherer::VisitMemberExpr(const MemberExpr *E) {
+  GatherSections(E);
+}
+
 //
 // Scalar values and array sections emmitter for an array operations.
 //
@@ -351,7 +486,9 @@ ArrayValueRef ArrayOperation::getArrayValue(const Expr *E) {
   auto Arr = Arrays[E];
   auto DimCount = E->getType()->asArrayType()->getDimensionCount();
   return ArrayValueRef(llvm::makeArrayRef(Dims.begin() + Arr.DataOffset, DimCount),
-                        Arr.Ptr, Arr.Offset);
+                        Arr.Ptr, Arr.Offset,
+                        llvm::makeArrayRef(Components.begin() + Arr.ComponentOffset,
+                                           Arr.ComponentCount));
 }
 
 void ArrayOperation::EmitArraySections(CodeGenFunction &CGF, const Expr *E) {
@@ -363,12 +500,16 @@ void ArrayOperation::EmitArraySections(CodeGenFunction &CGF, const Expr *E) {
 
   StoredArrayValue ArrayValue;
   ArrayValue.DataOffset = Dims.size();
+  ArrayValue.ComponentOffset = Components.size();
+  ArrayValue.ComponentCount = EV.getComponents().size();
   ArrayValue.Ptr = EV.getResult().Ptr;
   ArrayValue.Offset = EV.getResult().Offset;
   Arrays[E] = ArrayValue;
 
   for(auto D : EV.getDimensions())
     Dims.push_back(D);
+  for(auto I : EV.getComponents())
+    Components.push_back(I);
 }
 
 RValueTy ArrayOperation::getScalarValue(const Expr *E) {
@@ -398,6 +539,7 @@ public:
   void VisitBinaryExpr(const BinaryExpr *E);
   void VisitArrayConstructorExpr(const ArrayConstructorExpr *E);
   void VisitArraySectionExpr(const ArraySectionExpr *E);
+  void VisitMemberExpr(const MemberExpr *E);
   void VisitIntrinsicCallExpr(const IntrinsicCallExpr *E);
 
   const Expr *getLastEmmittedArray() const {
@@ -440,6 +582,11 @@ void ScalarEmitterAndSectionGatherer::VisitArraySectionExpr(const ArraySectionEx
   LastArrayEmmitted = E;
 }
 
+void ScalarEmitterAndSectionGatherer::VisitMemberExpr(const MemberExpr *E) {
+  ArrayOp.EmitArraySections(CGF, E);
+  LastArrayEmmitted = E;
+}
+
 void ScalarEmitterAndSectionGatherer::VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
   for(auto I : E->getArguments())
     Emit(I);
@@ -526,7 +673,7 @@ llvm::Value *ArrayLoopEmitter::EmitElementOneDimensionalIndex(const ArrayValueRe
 }
 
 llvm::Value *ArrayLoopEmitter::EmitElementPointer(const ArrayValueRef &Array) {
-  return Builder.CreateGEP(Array.Ptr, EmitElementOffset(Array));
+  return CGF.EmitArrayValueElementPtr(EmitElementOffset(Array), Array);
 }
 
 //
@@ -569,6 +716,10 @@ RValueTy ArrayOperationEmitter::VisitArraySectionExpr(const ArraySectionExpr *E)
   return CGF.EmitLoad(Looper.EmitElementPointer(Operation.getArrayValue(E)), ElementType(E));
 }
 
+RValueTy ArrayOperationEmitter::VisitMemberExpr(const MemberExpr *E) {
+  return CGF.EmitLoad(Looper.EmitElementPointer(Operation.getArrayValue(E)), ElementType(E));
+}
+
 RValueTy ArrayOperationEmitter::VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
   using namespace intrinsic;
   auto Func = getGenericFunctionKind(E->getIntrinsicFunction());
@@ -653,40 +804,78 @@ static llvm::Value *EmitArrayConditional(CodeGenFunction &CGF, ArrayOperation &O
 //
 
 llvm::Value *CodeGenFunction::EmitArrayElementPtr(const Expr *Target,
-                                                  const ArrayRef<Expr*> Subscripts) {
+                                                  const ArrayRef<Expr*> Subscripts,
+                                                  const FieldDecl *SoAComponent) {
   ArrayValueExprEmitter EV(*this);
+  if(SoAComponent)
+    EV.setSoAComponent(SoAComponent);
   EV.EmitExpr(Target);
   llvm::SmallVector<llvm::Value*, 8> Subs(Subscripts.size());
   for(size_t I = 0; I < Subs.size(); ++I)
     Subs[I] = EmitSizeIntExpr(Subscripts[I]);
+  if(CGM.getCodeGenOpts().BoundsCheck) {
+    auto Dims = EV.getDimensions();
+    for(size_t I = 0; I < Subs.size(); ++I) {
+      if(!CheckedSubscripts.count(Subscripts[I]))
+        EmitArraySubscriptCheck(Subs[I], Dims[I], I);
+    }
+  }
   return EmitArrayElementPtr(Subs, EV.getResult());
 }
 
-llvm::Value *CodeGenFunction::EmitArrayArgumentPointerValueABI(const Expr *E) {
-  if(auto Temp = dyn_cast<ImplicitTempArrayExpr>(E)) {
-    E = Temp->getExpression();
-    ArrayOperation OP;
-    StandaloneArrayValueSectionGatherer EV(*this, OP);
-    EV.EmitExpr(E);
-    auto Value = EV.getResult();
-    auto DestPtr = CreateTempHeapArrayAlloca(E->getType(), Value);
-    auto Dest = ArrayValueRef(Value.Dimensions, DestPtr);
-    OP.EmitAllScalarValuesAndArraySections(*this, E);
-    ArrayLoopEmitter Looper(*this);
-    Looper.EmitArrayIterationBegin(Value);
-    CodeGen::EmitArrayAssignment(*this, OP, Looper, Dest, E);
-    Looper.EmitArrayIterationEnd();
-    return DestPtr;
-  }
+/// \brief Evaluates the given array expression into a temporary array.
+static llvm::Value *EmitTempArray(CodeGenFunction &CGF, const Expr *E) {
+  ArrayOperation OP;
+  StandaloneArrayValueSectionGatherer EV(CGF, OP);
+  EV.EmitExpr(E);
+  auto Value = EV.getResult();
+  auto DestPtr = CGF.CreateTempHeapArrayAlloca(E->getType(), Value);
+  auto Dest = ArrayValueRef(Value.Dimensions, DestPtr);
+  OP.EmitAllScalarValuesAndArraySections(CGF, E);
+  ArrayLoopEmitter Looper(CGF);
+  Looper.EmitArrayIterationBegin(Value);
+  CodeGen::EmitArrayAssignment(CGF, OP, Looper, Dest, E);
+  Looper.EmitArrayIterationEnd();
+  return DestPtr;
+}
+
+llvm::Value *CodeGenFunction::EmitArrayArgumentPointerValueABI(const Expr *E,
+                                                               CallArgList *Args) {
+  if(auto Temp = dyn_cast<ImplicitTempArrayExpr>(E))
+    return EmitTempArray(*this, Temp->getExpression());
   else if(auto Pack = dyn_cast<ImplicitArrayPackExpr>(E)) {
     // FIXME strided array - allocate memory and pack / unpack
   }
 
   ArrayValueExprEmitter EV(*this);
   EV.EmitExpr(E);
+  // The component of an array of structures isn't contiguous, so it's
+  // passed in a temporary which is copied back after the call.
+  if(!EV.getComponents().empty()) {
+    auto Temp = EmitTempArray(*this, E);
+    if(Args)
+      Args->addWriteback(E, Temp);
+    return Temp;
+  }
   return EV.getPointer();
 }
 
+void CodeGenFunction::EmitArrayCopyBack(const Expr *E, llvm::Value *TempPtr) {
+  ArrayOperation OP;
+  StandaloneArrayValueSectionGatherer EV(*this, OP);
+  EV.EmitExpr(E);
+  auto Value = EV.getResult();
+  auto Src = ArrayValueRef(Value.Dimensions, TempPtr);
+  OP.EmitAllScalarValuesAndArraySections(*this, E);
+  ArrayLoopEmitter Looper(*this);
+  Looper.EmitArrayIterationBegin(Value);
+  ArrayOperationEmitter Emitter(*this, OP, Looper);
+  auto ElementType = E->getType().getSelfOrArrayElementType();
+  EmitStore(EmitLoad(Looper.EmitElementPointer(Src), ElementType),
+            Emitter.EmitLValue(E), ElementType);
+  Looper.EmitArrayIterationEnd();
+}
+
 llvm::Constant *CodeGenFunction::EmitConstantArrayExpr(const ArrayConstructorExpr *E) {
   auto Items = E->getItems();
   auto VMATy = getTypes().ConvertArrayTypeForMem(E->getType()->asArrayType());
@@ -742,8 +931,11 @@ ArrayVectorValueTy CodeGenFunction::EmitTempArrayConstructor(const ArrayConstruc
         // FIXME: multi dimensional and strided items
         for(uint64_t J = 0; J < SubSize; ++J,++I) {
           auto Dest = Builder.CreateConstInBoundsGEP1_64(Ptr, I);
-          EmitStore(EmitLoad(Builder.CreateConstInBoundsGEP1_64(EV.getPointer(), J), ETy),
-                    LValueTy(Dest), ETy);
+          auto Src = EV.getComponents().empty()?
+                       Builder.CreateConstInBoundsGEP1_64(EV.getPointer(), J) :
+                       EmitArrayValueElementPtr(llvm::ConstantInt::get(CGM.SizeTy, J),
+                                                EV.getResult());
+          EmitStore(EmitLoad(Src, ETy), LValueTy(Dest), ETy);
         }
       } else {
         auto Dest = Builder.CreateConstInBoundsGEP1_64(Ptr, I);
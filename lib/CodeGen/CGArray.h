@@ -30,6 +30,11 @@ class ArrayValueExprEmitter
   llvm::Value *Ptr;
   bool GetPointer;
   SmallVector<ArrayDimensionValueTy, 8> Dims;
+  SmallVector<unsigned, 4> Components;
+
+  /// SoAComponent - the index of the component which is selected from
+  /// an array with the struct of arrays layout, or -1.
+  int SoAComponent;
 
   void EmitSections();
   void IncrementOffset(llvm::Value *OffsetDelta);
@@ -41,6 +46,14 @@ public:
   void VisitVarExpr(const VarExpr *E);
   void VisitArrayConstructorExpr(const ArrayConstructorExpr *E);
   void VisitArraySectionExpr(const ArraySectionExpr *E);
+  void VisitMemberExpr(const MemberExpr *E);
+
+  /// \brief Selects the given component from an array with the struct
+  /// of arrays layout. The sections of the array are then applied to
+  /// the array of the component.
+  void setSoAComponent(const FieldDecl *Field) {
+    SoAComponent = Field->getIndex();
+  }
 
   ArrayRef<ArrayDimensionValueTy> getDimensions() const {
     return Dims;
@@ -48,8 +61,11 @@ public:
   llvm::Value *getPointer() const {
     return Ptr;
   }
+  ArrayRef<unsigned> getComponents() const {
+    return Components;
+  }
   ArrayValueRef getResult() const {
-    return ArrayValueRef(Dims, Ptr, Offset);
+    return ArrayValueRef(Dims, Ptr, Offset, Components);
   }
 };
 
@@ -58,6 +74,8 @@ public:
 class ArrayOperation {
   struct StoredArrayValue {
     size_t DataOffset;
+    size_t ComponentOffset;
+    size_t ComponentCount;
     llvm::Value *Ptr;
     llvm::Value *Offset;
   };
@@ -65,6 +83,7 @@ class ArrayOperation {
   llvm::SmallDenseMap<const Expr*, RValueTy, 8> Scalars;
 
   SmallVector<ArrayDimensionValueTy, 32> Dims;
+  SmallVector<unsigned, 8> Components;
 
 protected:
 
@@ -118,6 +137,7 @@ public:
   void VisitImplicitCastExpr(const ImplicitCastExpr *E);
   void VisitIntrinsicCallExpr(const IntrinsicCallExpr *E);
   void VisitArraySectionExpr(const ArraySectionExpr *E);
+  void VisitMemberExpr(const MemberExpr *E);
 
   ArrayValueRef getResult() const {
     return ArrayValueRef(Dims, nullptr);
@@ -193,6 +213,7 @@ public:
   RValueTy VisitBinaryExpr(const BinaryExpr *E);
   RValueTy VisitArrayConstructorExpr(const ArrayConstructorExpr *E);
   RValueTy VisitArraySectionExpr(const ArraySectionExpr *E);
+  RValueTy VisitMemberExpr(const MemberExpr *E);
   RValueTy VisitIntrinsicCallExpr(const IntrinsicCallExpr *E);
 
   static QualType ElementType(const Expr *E) {
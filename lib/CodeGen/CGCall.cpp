@@ -45,7 +45,7 @@ llvm::Type *CodeGenTypes::ConvertReturnType(QualType T,
   }
 
   ReturnInfo.Type = T;
-  if(T->isComplexType()) {
+  if(T->isComplexType() || T->isRecordType()) {
     CGM.getTargetCodeGenInfo().getABIInfo().computeReturnTypeInfo(T, ReturnInfo.ABIInfo);
     if(ReturnInfo.ABIInfo.hasAggregateReturnType())
       return ReturnInfo.ABIInfo.getAggregateReturnType();
@@ -148,6 +148,9 @@ RValueTy CodeGenFunction::EmitCall(const FunctionDecl *Function,
   if(Function->isStatementFunction())
     // statement functions are inlined.
     return EmitStatementFunctionCall(Function, Arguments);
+  else if(CGM.isInlinableFunction(Function) &&
+          Arguments.size() == Function->getArguments().size())
+    return EmitInlinedCall(Function, Arguments);
   else if(Function->isExternalArgument()) {
     // function pointer
     Callee = GetVarPtr(GetExternalFunctionArgument(Function));
@@ -156,6 +159,9 @@ RValueTy CodeGenFunction::EmitCall(const FunctionDecl *Function,
     auto CGFunc = CGM.GetFunction(Function);
     Callee = CGFunc.getFunction();
     FuncInfo = CGFunc.getInfo();
+    if(auto Clone = CGM.GetFunctionClone(Function, Arguments,
+                                         ConstantArguments))
+      Callee = Clone;
   }
   return EmitCall(Callee, FuncInfo,
                   ArgList, Arguments, ReturnsNothing);
@@ -190,6 +196,8 @@ RValueTy CodeGenFunction::EmitCall(llvm::Value *Callee,
   auto  Result = Builder.CreateCall(Callee,
                                     ArgList.createValues());
   Result->setCallingConv(FuncInfo->getCallingConv());
+  for(auto Writeback : ArgList.getWritebacks())
+    EmitArrayCopyBack(Writeback.Target, Writeback.Temp);
 
   if(ReturnsNothing ||
      RetABIKind == ABIRetInfo::Nothing)
@@ -205,9 +213,16 @@ RValueTy CodeGenFunction::EmitCall(llvm::Value *Callee,
       }
       return ExtractComplexValue(Result);
     } else if(RetType->isRecordType()) {
-      auto ResultTemp = CreateTempAlloca(ConvertTypeForMem(RetType), "agg-return");
-      Builder.CreateStore(Result, ResultTemp);
-      return RValueTy::getAggregate(ResultTemp);
+      // The record is stored straight to the destination when the
+      // caller has provided one.
+      auto Dest = ArgList.getReturnValueArg();
+      if(!Dest.isAggregate())
+        Dest = RValueTy::getAggregate(CreateTempAlloca(ConvertTypeForMem(RetType),
+                                                       "agg-return"));
+      EmitAggregateReturnValueStore(FuncInfo->getReturnInfo(), Result,
+                                    Dest.getAggregateAddr(),
+                                    Dest.isVolatileQualifier());
+      return Dest;
     }
   }
   else if(RetABIKind == ABIRetInfo::AggregateValueAsArg) {
@@ -268,7 +283,14 @@ void CodeGenFunction::EmitCallArg(CallArgList &Args,
   }
   switch(ArgInfo.ABIInfo.getKind()) {
   case ABIArgInfo::Value:
-    Args.add(EmitScalarExpr(E));
+    if(E->getType()->isComplexType())
+      EmitCallArg(Args, EmitComplexExpr(E), ArgInfo);
+    else
+      Args.add(EmitScalarExpr(E));
+    break;
+
+  case ABIArgInfo::ComplexValueAsVector:
+    EmitCallArg(Args, EmitComplexExpr(E), ArgInfo);
     break;
 
   case ABIArgInfo::Reference:
@@ -289,7 +311,7 @@ void CodeGenFunction::EmitArrayCallArg(CallArgList &Args,
                                        const Expr *E, CGFunctionInfo::ArgInfo ArgInfo) {
   switch(ArgInfo.ABIInfo.getKind()) {
   case ABIArgInfo::Reference:
-    Args.add(EmitArrayArgumentPointerValueABI(E));
+    Args.add(EmitArrayArgumentPointerValueABI(E, &Args));
     break;
 
   default:
@@ -19,8 +19,17 @@ namespace flang   {
 namespace CodeGen {
 
 class CallArgList {
+public:
+  /// Writeback - A temporary array which is passed instead of a
+  /// non-contiguous array argument, and is copied back after the call.
+  struct Writeback {
+    const Expr *Target;
+    llvm::Value *Temp;
+  };
+private:
   SmallVector<llvm::Value*, 16> Values;
   SmallVector<llvm::Value*, 4>  AdditionalValues;
+  SmallVector<Writeback, 2> Writebacks;
   RValueTy ReturnValue;
 public:
 
@@ -40,6 +49,15 @@ public:
     AdditionalValues.push_back(Arg);
   }
 
+  void addWriteback(const Expr *Target, llvm::Value *Temp) {
+    Writeback W = { Target, Temp };
+    Writebacks.push_back(W);
+  }
+
+  ArrayRef<Writeback> getWritebacks() const {
+    return Writebacks;
+  }
+
   void addReturnValueArg(RValueTy Value) {
     ReturnValue = Value;
   }
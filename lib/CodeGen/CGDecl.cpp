@@ -57,9 +57,14 @@ void CodeGenFunction::EmitVarDecl(const VarDecl *D) {
   auto Type = D->getType();
   if(Type.hasAttributeSpec(Qualifiers::AS_save) && !IsMainProgram) {
     Ptr = CGM.EmitGlobalVariable(CurFn->getName(), D);
-    HasSavedVariables = true;
+    if(CGM.IsThreadLocal(D))
+      HasThreadLocalSavedVariables = true;
+    else HasSavedVariables = true;
   } else {
-    if(Type->isArrayType())
+    if(SoAVariables.count(D))
+      Ptr = Builder.CreateAlloca(getTypes().ConvertSoAArrayTypeForMem(Type->asArrayType()),
+                                 nullptr, D->getName());
+    else if(Type->isArrayType())
       Ptr = CreateArrayAlloca(Type, D->getName());
     else Ptr = Builder.CreateAlloca(ConvertTypeForMem(Type),
                                     nullptr, D->getName());
@@ -70,9 +75,12 @@ void CodeGenFunction::EmitVarDecl(const VarDecl *D) {
 class VarInitEmitter : public ConstDeclVisitor<VarInitEmitter> {
   CodeGenFunction &CGF;
   bool VisitSaveQualified;
+  bool VisitThreadLocal;
 public:
- VarInitEmitter(CodeGenFunction &cgf, bool VisitSave = false)
-    : CGF(cgf), VisitSaveQualified(VisitSave) {}
+ VarInitEmitter(CodeGenFunction &cgf, bool VisitSave = false,
+                bool ThreadLocal = false)
+    : CGF(cgf), VisitSaveQualified(VisitSave),
+      VisitThreadLocal(ThreadLocal) {}
 
   void VisitVarDecl(const VarDecl *D) {
     if(D->isParameter() || D->isArgument() ||
@@ -81,6 +89,8 @@ public:
     bool HasSave = D->getType().hasAttributeSpec(Qualifiers::AS_save);
     if(HasSave != VisitSaveQualified)
       return;
+    if(HasSave && CGF.getModule().IsThreadLocal(D) != VisitThreadLocal)
+      return;
     if(D->hasInit())
       CGF.EmitVarInitializer(D);
   }
@@ -91,8 +101,9 @@ void CodeGenFunction::EmitVarInitializers(const DeclContext *DC) {
   DV.Visit(DC);
 }
 
-void CodeGenFunction::EmitSavedVarInitializers(const DeclContext *DC) {
-  VarInitEmitter DV(*this, true);
+void CodeGenFunction::EmitSavedVarInitializers(const DeclContext *DC,
+                                               bool ThreadLocal) {
+  VarInitEmitter DV(*this, true, ThreadLocal);
   DV.Visit(DC);
 }
 
@@ -110,6 +121,10 @@ void CodeGenFunction::EmitVarInitializer(const VarDecl *D) {
     }
     return;
   }
+  if(T->isRecordType()) {
+    EmitAggregateExpr(D->getInit(), GetVarPtr(D));
+    return;
+  }
   auto Val = EmitRValue(D->getInit());
   EmitStoreCharSameLength(Val, GetVarPtr(D), D->getType());
 }
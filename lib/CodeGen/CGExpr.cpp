@@ -63,10 +63,8 @@ void CodeGenFunction::EmitStore(RValueTy Val, LValueTy Dest, QualType T) {
     Builder.CreateStore(Val.asScalar(), Ptr, IsVolatile);
   } else if(Val.isComplex())
     EmitComplexStore(Val.asComplex(), Ptr, IsVolatile);
-  else if(Val.isAggregate()) {
-    Builder.CreateStore(Builder.CreateLoad(Val.getAggregateAddr(), Val.isVolatileQualifier()),
-                        Ptr, IsVolatile);
-  }
+  else if(Val.isAggregate())
+    EmitAggregateCopy(Dest, Val);
 }
 
 void CodeGenFunction::EmitStoreCharSameLength(RValueTy Val, LValueTy Dest, QualType T) {
@@ -156,6 +154,11 @@ LValueTy LValueExprEmitter::VisitArrayElementExpr(const ArrayElementExpr *E) {
 }
 
 LValueTy LValueExprEmitter::VisitMemberExpr(const MemberExpr *E) {
+  if(auto Element = dyn_cast<ArrayElementExpr>(E->getTarget())) {
+    if(CGF.IsSoAArrayExpr(Element->getTarget()))
+      return CGF.EmitArrayElementPtr(Element->getTarget(), Element->getSubscripts(),
+                                     E->getField());
+  }
   return CGF.EmitAggregateMember(Visit(E->getTarget()).getPointer(),
                                  E->getField());
 }
@@ -19,14 +19,85 @@
 namespace flang {
 namespace CodeGen {
 
+/// The maximum number of the scalar fields in a record which is
+/// copied field by field instead of with a memcpy.
+static const unsigned MaxFieldwiseCopyFields = 4;
+
+/// DestinationIndependenceChecker - Returns true if the value of the
+/// expression can't depend on the record it's stored to, i.e. when the
+/// expression doesn't read any records or call any procedures.
+class DestinationIndependenceChecker
+  : public ConstExprVisitor<DestinationIndependenceChecker, bool> {
+public:
+  bool Check(const Expr *E) {
+    if(E->getType()->isRecordType() && !isa<TypeConstructorExpr>(E))
+      return false;
+    return Visit(E);
+  }
+
+  bool VisitExpr(const Expr *E) {
+    return false;
+  }
+  bool VisitConstantExpr(const ConstantExpr *E) {
+    return true;
+  }
+  bool VisitVarExpr(const VarExpr *E) {
+    return true;
+  }
+  bool VisitUnaryExpr(const UnaryExpr *E) {
+    return Check(E->getExpression());
+  }
+  bool VisitBinaryExpr(const BinaryExpr *E) {
+    return Check(E->getLHS()) && Check(E->getRHS());
+  }
+  bool VisitImplicitCastExpr(const ImplicitCastExpr *E) {
+    return Check(E->getExpression());
+  }
+  bool VisitArrayElementExpr(const ArrayElementExpr *E) {
+    for(auto I : E->getSubscripts()) {
+      if(!Check(I))
+        return false;
+    }
+    return true;
+  }
+  bool VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
+    for(auto I : E->getArguments()) {
+      if(!Check(I))
+        return false;
+    }
+    return true;
+  }
+  bool VisitTypeConstructorExpr(const TypeConstructorExpr *E) {
+    for(auto I : E->getArguments()) {
+      if(!Check(I))
+        return false;
+    }
+    return true;
+  }
+};
+
 class AggregateExprEmitter
   : public ConstExprVisitor<AggregateExprEmitter, RValueTy> {
   CodeGenFunction &CGF;
   CGBuilderTy &Builder;
+  LValueTy Dest;
 public:
 
   AggregateExprEmitter(CodeGenFunction &cgf);
 
+  bool hasDestination() const {
+    return Dest.getPointer() != nullptr;
+  }
+  LValueTy takeDestination() {
+    auto Result = Dest;
+    Dest = LValueTy(nullptr);
+    return Result;
+  }
+  void setDestination(LValueTy Value) {
+    assert(Value.getPointer());
+    Dest = Value;
+  }
+
   RValueTy EmitExpr(const Expr *E);
   RValueTy VisitVarExpr(const VarExpr *E);
   RValueTy VisitArrayElementExpr(const ArrayElementExpr *E);
@@ -36,7 +107,7 @@ public:
 };
 
 AggregateExprEmitter::AggregateExprEmitter(CodeGenFunction &cgf)
-  : CGF(cgf), Builder(cgf.getBuilder()) {}
+  : CGF(cgf), Builder(cgf.getBuilder()), Dest(nullptr) {}
 
 RValueTy AggregateExprEmitter::EmitExpr(const Expr *E) {
   return Visit(E);
@@ -58,27 +129,54 @@ RValueTy AggregateExprEmitter::VisitArrayElementExpr(const ArrayElementExpr *E)
 }
 
 RValueTy AggregateExprEmitter::VisitMemberExpr(const MemberExpr *E) {
+  // The component of an element of an array with the struct of arrays
+  // layout is an element of the component's array.
+  if(auto Element = dyn_cast<ArrayElementExpr>(E->getTarget())) {
+    if(CGF.IsSoAArrayExpr(Element->getTarget()))
+      return RValueTy::getAggregate(CGF.EmitArrayElementPtr(Element->getTarget(),
+                                                            Element->getSubscripts(),
+                                                            E->getField()));
+  }
   auto Val = EmitExpr(E->getTarget());
   return RValueTy::getAggregate(CGF.EmitAggregateMember(Val.getAggregateAddr(), E->getField()),
                                 Val.isVolatileQualifier());
 }
 
 RValueTy AggregateExprEmitter::VisitCallExpr(const CallExpr *E) {
-  return CGF.EmitCall(E);
+  if(!hasDestination() || E->getFunction()->isStatementFunction())
+    return CGF.EmitCall(E);
+  // The returned record is stored straight to the destination.
+  auto Result = takeDestination();
+  CallArgList ArgList;
+  ArgList.addReturnValueArg(RValueTy::getAggregate(Result.getPointer(),
+                                                   Result.isVolatileQualifier()));
+  return CGF.EmitCall(E->getFunction(), ArgList, E->getArguments());
 }
 
 RValueTy AggregateExprEmitter::VisitTypeConstructorExpr(const TypeConstructorExpr *E) {
-  // create a temporary object.
-  auto TempStruct = CGF.CreateTempAlloca(CGF.ConvertTypeForMem(E->getType()), "type-constructor");
+  // The fields are stored straight to the destination when their values
+  // don't depend on it, otherwise to a temporary object.
   auto Values = E->getArguments();
+  LValueTy Result;
+  if(hasDestination() &&
+     DestinationIndependenceChecker().VisitTypeConstructorExpr(E))
+    Result = takeDestination();
+  else
+    Result = LValueTy(CGF.CreateTempAlloca(CGF.ConvertTypeForMem(E->getType()),
+                                           "type-constructor"));
+
   auto Fields = E->getType().getSelfOrArrayElementType()->asRecordType()->getElements();
   for(unsigned I = 0; I < Values.size(); ++I) {
-    CGF.EmitStore(CGF.EmitRValue(Values[I]),
-                  LValueTy(Builder.CreateStructGEP(CGF.ConvertTypeForMem(E->getType()),
-                                                   TempStruct,I)),
-                  Fields[I]->getType());
+    LValueTy Field(Builder.CreateStructGEP(CGF.ConvertTypeForMem(E->getType()),
+                                           Result.getPointer(), I));
+    if(Values[I]->getType()->isRecordType()) {
+      CGF.EmitAggregateExpr(Values[I], Field);
+      continue;
+    }
+    CGF.EmitStore(CGF.EmitRValue(Values[I]), Field, Fields[I]->getType());
   }
-  return RValueTy::getAggregate(TempStruct);
+  return RValueTy::getAggregate(Result.getPointer(),
+                                Result.isVolatileQualifier());
 }
 
 RValueTy CodeGenFunction::EmitAggregateExpr(const Expr *E) {
@@ -86,24 +184,118 @@ RValueTy CodeGenFunction::EmitAggregateExpr(const Expr *E) {
   return EV.EmitExpr(E);
 }
 
+void CodeGenFunction::EmitAggregateExpr(const Expr *E, LValueTy Dest) {
+  AggregateExprEmitter EV(*this);
+  EV.setDestination(Dest);
+  EmitAggregateCopy(Dest, EV.EmitExpr(E));
+}
+
 void CodeGenFunction::EmitAggregateAssignment(const Expr *LHS, const Expr *RHS) {
-  auto Val = EmitAggregateExpr(RHS);
-  auto Dest = EmitLValue(LHS);
-  Builder.CreateStore(Builder.CreateLoad(Val.getAggregateAddr(), Val.isVolatileQualifier()),
-                      Dest.getPointer(), Dest.isVolatileQualifier());
+  EmitAggregateExpr(RHS, EmitLValue(LHS));
+}
+
+/// CountScalarFields - Returns the number of the scalar fields in the
+/// given record, or -1 if the record has an array field.
+static int CountScalarFields(llvm::StructType *T) {
+  int Count = 0;
+  for(auto Field : T->elements()) {
+    if(auto Record = dyn_cast<llvm::StructType>(Field)) {
+      auto FieldCount = CountScalarFields(Record);
+      if(FieldCount < 0)
+        return -1;
+      Count += FieldCount;
+    } else if(Field->isAggregateType())
+      return -1;
+    else ++Count;
+  }
+  return Count;
+}
+
+void CodeGenFunction::EmitAggregateCopy(llvm::Value *Dest, llvm::Value *Src,
+                                        llvm::StructType *T,
+                                        bool IsDestVolatile, bool IsSrcVolatile) {
+  for(unsigned I = 0; I < T->getNumElements(); ++I) {
+    auto DestField = Builder.CreateStructGEP(T, Dest, I);
+    auto SrcField = Builder.CreateStructGEP(T, Src, I);
+    if(auto Record = dyn_cast<llvm::StructType>(T->getElementType(I))) {
+      EmitAggregateCopy(DestField, SrcField, Record,
+                        IsDestVolatile, IsSrcVolatile);
+      continue;
+    }
+    Builder.CreateStore(Builder.CreateLoad(SrcField, IsSrcVolatile),
+                        DestField, IsDestVolatile);
+  }
+}
+
+void CodeGenFunction::EmitAggregateCopy(LValueTy Dest, RValueTy Src) {
+  auto Ptr = Src.getAggregateAddr();
+  if(Dest.getPointer() == Ptr)
+    return;
+  // Small records are copied field by field, so that the fields can be
+  // promoted to registers, and the others are copied with a memcpy.
+  auto Type = cast<llvm::PointerType>(Ptr->getType())->getElementType();
+  auto Record = dyn_cast<llvm::StructType>(Type);
+  int Count = Record? CountScalarFields(Record) : -1;
+  if(Count >= 0 && unsigned(Count) <= MaxFieldwiseCopyFields) {
+    EmitAggregateCopy(Dest.getPointer(), Ptr, Record,
+                      Dest.isVolatileQualifier(), Src.isVolatileQualifier());
+    return;
+  }
+  auto &DL = CGM.getDataLayout();
+  Builder.CreateMemCpy(Dest.getPointer(), Ptr,
+                       DL.getTypeStoreSize(Type), DL.getABITypeAlignment(Type),
+                       Dest.isVolatileQualifier() || Src.isVolatileQualifier());
 }
 
 llvm::Value *CodeGenFunction::EmitAggregateMember(llvm::Value *Agg, const FieldDecl *Field) {
   return Builder.CreateStructGEP(nullptr, Agg, Field->getIndex());
 }
 
+llvm::Value *CodeGenFunction::EmitCoercedLoad(llvm::Value *Ptr, llvm::Type *RecordTy,
+                                              llvm::Type *Ty) {
+  auto &DL = CGM.getDataLayout();
+  auto Size = DL.getTypeAllocSize(RecordTy);
+  auto Align = DL.getABITypeAlignment(RecordTy);
+  if(DL.getTypeAllocSize(Ty) <= Size) {
+    auto Load = Builder.CreateLoad(
+      Builder.CreateBitCast(Ptr, llvm::PointerType::get(Ty, 0)));
+    Load->setAlignment(Align);
+    return Load;
+  }
+  // The coerced type can be larger than the record, e.g. { <2 x float>, float }
+  // for three reals, so the record is copied into a temporary first.
+  auto Temp = CreateTempAlloca(Ty, "coerce");
+  Temp->setAlignment(std::max(Align, DL.getABITypeAlignment(Ty)));
+  Builder.CreateMemCpy(Temp, Ptr, Size, Align);
+  return Builder.CreateLoad(Temp);
+}
+
+void CodeGenFunction::EmitCoercedStore(llvm::Value *Value, llvm::Value *Ptr,
+                                       llvm::Type *RecordTy, bool IsVolatile) {
+  auto &DL = CGM.getDataLayout();
+  auto Ty = Value->getType();
+  auto Size = DL.getTypeAllocSize(RecordTy);
+  auto Align = DL.getABITypeAlignment(RecordTy);
+  if(DL.getTypeAllocSize(Ty) <= Size) {
+    auto Store = Builder.CreateStore(Value,
+      Builder.CreateBitCast(Ptr, llvm::PointerType::get(Ty, 0)), IsVolatile);
+    Store->setAlignment(Align);
+    return;
+  }
+  // Only the bytes of the record are copied out of the temporary.
+  auto Temp = CreateTempAlloca(Ty, "coerce");
+  Temp->setAlignment(std::max(Align, DL.getABITypeAlignment(Ty)));
+  Builder.CreateStore(Value, Temp);
+  Builder.CreateMemCpy(Ptr, Temp, Size, Align, IsVolatile);
+}
+
 void CodeGenFunction::EmitAggregateReturn(const CGFunctionInfo::RetInfo &Info, llvm::Value *Ptr) {
-  if(Info.Type->isComplexType()) {
-    if(Info.ABIInfo.hasAggregateReturnType()) {
-      Builder.CreateRet(Builder.CreateLoad(
-        Builder.CreateBitCast(Ptr, llvm::PointerType::get(Info.ABIInfo.getAggregateReturnType(), 0))));
-      return;
-    }
+  if(Info.ABIInfo.hasAggregateReturnType()) {
+    // The value is returned as the type which was chosen by the
+    // target's ABI.
+    Builder.CreateRet(EmitCoercedLoad(Ptr, ConvertTypeForMem(Info.Type),
+                                      Info.ABIInfo.getAggregateReturnType()));
+  } else if(Info.Type->isComplexType()) {
     Builder.CreateRet(CreateComplexAggregate(
                         EmitComplexLoad(Ptr)));
   } else {
@@ -111,5 +303,13 @@ void CodeGenFunction::EmitAggregateReturn(const CGFunctionInfo::RetInfo &Info, l
   }
 }
 
+void CodeGenFunction::EmitAggregateReturnValueStore(const CGFunctionInfo::RetInfo &Info,
+                                                    llvm::Value *Value, llvm::Value *Ptr,
+                                                    bool IsVolatile) {
+  if(!Info.ABIInfo.hasAggregateReturnType()) {
+    Builder.CreateStore(Value, Ptr, IsVolatile);
+    return;
+  }
+  EmitCoercedStore(Value, Ptr, ConvertTypeForMem(Info.Type), IsVolatile);
 }
 }
@@ -159,9 +159,8 @@ CharacterValueTy CharacterExprEmitter::VisitArrayElementExpr(const ArrayElementE
 }
 
 CharacterValueTy CharacterExprEmitter::VisitMemberExpr(const MemberExpr *E) {
-  auto Val = CGF.EmitAggregateExpr(E->getTarget());
-  return CGF.GetCharacterValueFromPtr(CGF.EmitAggregateMember(Val.getAggregateAddr(), E->getField()),
-                                      E->getType());
+  auto Val = CGF.EmitAggregateExpr(E);
+  return CGF.GetCharacterValueFromPtr(Val.getAggregateAddr(), E->getType());
 }
 
 void CodeGenFunction::EmitCharacterAssignment(const Expr *LHS, const Expr *RHS) {
@@ -283,9 +283,8 @@ ComplexValueTy ComplexExprEmitter::VisitArrayElementExpr(const ArrayElementExpr
 }
 
 ComplexValueTy ComplexExprEmitter::VisitMemberExpr(const MemberExpr *E) {
-  auto Val = CGF.EmitAggregateExpr(E->getTarget());
-  return CGF.EmitComplexLoad(CGF.EmitAggregateMember(Val.getAggregateAddr(), E->getField()),
-                             Val.isVolatileQualifier());
+  auto Val = CGF.EmitAggregateExpr(E);
+  return CGF.EmitComplexLoad(Val.getAggregateAddr(), Val.isVolatileQualifier());
 }
 
 ComplexValueTy CodeGenFunction::EmitComplexExpr(const Expr *E) {
@@ -111,6 +111,12 @@ llvm::Value *ScalarExprEmitter::VisitVarExpr(const VarExpr *E) {
     return CGF.GetInlinedArgumentValue(VD).asScalar();
   if(VD->isParameter())
     return EmitExpr(VD->getInit());
+  if(auto Scope = CGF.getConstantArguments()) {
+    auto Value = Scope->get(E);
+    if(Value.second)
+      return llvm::ConstantInt::get(CGF.ConvertType(VD->getType()),
+                                    Value.first, true);
+  }
   auto Ptr = CGF.GetVarPtr(VD);
   return Builder.CreateLoad(Ptr,VD->getName());
 }
@@ -366,9 +372,8 @@ llvm::Value *ScalarExprEmitter::VisitArrayElementExpr(const ArrayElementExpr *E)
 }
 
 llvm::Value *ScalarExprEmitter::VisitMemberExpr(const MemberExpr *E) {
-  auto Val = CGF.EmitAggregateExpr(E->getTarget());
-  return Builder.CreateLoad(CGF.EmitAggregateMember(Val.getAggregateAddr(), E->getField()),
-                            Val.isVolatileQualifier());
+  auto Val = CGF.EmitAggregateExpr(E);
+  return Builder.CreateLoad(Val.getAggregateAddr(), Val.isVolatileQualifier());
 }
 
 llvm::Value *ScalarExprEmitter::VisitFunctionRefExpr(const FunctionRefExpr *E) {
@@ -0,0 +1,274 @@
+//===--- CGInline.cpp - Inlining of small procedures ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This contains code to inline the calls to tiny leaf procedures during
+// code generation (-finline-small-procedures), so that they are inlined
+// even when LLVM's inliner doesn't run.
+//
+// A procedure is inlined when its body has only a few statements, it doesn't
+// call any other procedures or perform any I/O, and all of its arguments and
+// local variables are numeric or logical scalars which aren't saved. The
+// arguments are still passed by reference, as the inlined body uses the
+// addresses of the actual arguments.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CodeGenFunction.h"
+#include "CodeGenModule.h"
+#include "flang/AST/Decl.h"
+#include "flang/AST/ExprVisitor.h"
+#include "flang/AST/StmtVisitor.h"
+
+namespace flang {
+namespace CodeGen {
+
+/// The maximum number of statements in an inlined procedure.
+static const unsigned MaxInlinedStmts = 8;
+
+/// InlineCandidateChecker - Counts the statements of a procedure, and fails
+/// when the procedure uses anything which can't be inlined.
+class InlineCandidateChecker : public ConstExprVisitor<InlineCandidateChecker>,
+                               public ConstStmtVisitor<InlineCandidateChecker> {
+  const FunctionDecl *Function;
+  unsigned NumStmts;
+  bool Failed;
+
+public:
+  InlineCandidateChecker(const FunctionDecl *Func)
+    : Function(Func), NumStmts(0), Failed(false) {}
+
+  bool hasFailed() const { return Failed; }
+
+  /// getNumStmts - Returns the number of the statements which were visited.
+  unsigned getNumStmts() const { return NumStmts; }
+
+  using ConstExprVisitor<InlineCandidateChecker>::Visit;
+  using ConstStmtVisitor<InlineCandidateChecker>::Visit;
+
+  void Visit(ArrayRef<Expr*> Exprs) {
+    for(auto E : Exprs)
+      Visit(E);
+  }
+  void VisitOrNull(const Expr *E) {
+    if(E) Visit(E);
+  }
+  void VisitOrNull(const Stmt *S) {
+    if(!S)
+      return;
+    // The branch targets are emitted only once per statement.
+    if(S->getStmtLabel() && S->isStmtLabelUsedAsGotoTarget())
+      Failed = true;
+    Visit(S);
+  }
+
+  // expressions
+
+  void VisitExpr(const Expr *E) {
+    Failed = true;
+  }
+  void VisitConstantExpr(const ConstantExpr *E) {}
+  void VisitVarExpr(const VarExpr *E) {
+    // The variables of the host can't be accessed from the caller.
+    auto VD = E->getVarDecl();
+    if(VD->isParameter() || VD->getDeclContext() == Function)
+      return;
+    if(VD->isArgument()) {
+      if(auto Func = dyn_cast<FunctionDecl>(VD->getDeclContext())) {
+        if(Func->isStatementFunction() && Func->getDeclContext() == Function)
+          return;
+      }
+    }
+    Failed = true;
+  }
+  void VisitUnaryExpr(const UnaryExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitBinaryExpr(const BinaryExpr *E) {
+    Visit(E->getLHS());
+    Visit(E->getRHS());
+  }
+  void VisitImplicitCastExpr(const ImplicitCastExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitCallExpr(const CallExpr *E) {
+    if(!E->getFunction()->isStatementFunction() ||
+       E->getFunction()->getDeclContext() != Function)
+      Failed = true;
+    Visit(E->getArguments());
+  }
+  void VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitRangeExpr(const RangeExpr *E) {
+    VisitOrNull(E->getFirstExpr());
+    VisitOrNull(E->getSecondExpr());
+  }
+
+  // statements
+
+  void VisitStmt(const Stmt *S) {
+    Failed = true;
+  }
+  void VisitConstructPartStmt(const ConstructPartStmt *S) {}
+  void VisitDeclStmt(const DeclStmt *S) {}
+  void VisitContinueStmt(const ContinueStmt *S) {}
+  void VisitCycleStmt(const CycleStmt *S) {}
+  void VisitExitStmt(const ExitStmt *S) {}
+  void VisitReturnStmt(const ReturnStmt *S) {
+    // Alternate returns aren't supported.
+    if(S->getE())
+      Failed = true;
+  }
+  void VisitCompoundStmt(const CompoundStmt *S) {
+    NumStmts += S->getBody().size();
+    for(auto I : S->getBody())
+      VisitOrNull(I);
+  }
+  void VisitBlockStmt(const BlockStmt *S) {
+    NumStmts += S->getStatements().size();
+    for(auto I : S->getStatements())
+      VisitOrNull(I);
+  }
+  void VisitIfStmt(const IfStmt *S) {
+    Visit(S->getCondition());
+    VisitOrNull(S->getThenStmt());
+    VisitOrNull(S->getElseStmt());
+  }
+  void VisitDoStmt(const DoStmt *S) {
+    Visit(S->getDoVar());
+    Visit(S->getInitialParameter());
+    Visit(S->getTerminalParameter());
+    VisitOrNull(S->getIncrementationParameter());
+    VisitOrNull(S->getBody());
+  }
+  void VisitDoWhileStmt(const DoWhileStmt *S) {
+    Visit(S->getCondition());
+    VisitOrNull(S->getBody());
+  }
+  void VisitSelectCaseStmt(const SelectCaseStmt *S) {
+    Visit(S->getOperand());
+    for(auto Case = S->getFirstCase(); Case; Case = Case->getNextCase()) {
+      Visit(Case->getValues());
+      VisitOrNull(Case->getBody());
+    }
+    if(S->hasDefaultCase())
+      VisitOrNull(S->getDefaultCase()->getBody());
+  }
+  void VisitAssignmentStmt(const AssignmentStmt *S) {
+    Visit(S->getLHS());
+    Visit(S->getRHS());
+  }
+};
+
+/// IsInlinableType - Returns true if a variable of the given type can be
+/// used by an inlined procedure.
+static bool IsInlinableType(QualType T) {
+  if(T.isNull() || T->isArrayType())
+    return false;
+  return T->isIntegerType() || T->isRealType() ||
+         T->isLogicalType() || T->isComplexType();
+}
+
+/// IsInlinableVariable - Returns true if the given variable of an inlined
+/// procedure can be replaced by a temporary or an actual argument.
+static bool IsInlinableVariable(const VarDecl *VD) {
+  if(VD->isParameter())
+    return true;
+  if(VD->hasStorageSet() || VD->hasInit() ||
+     VD->getType().hasAttributeSpec(Qualifiers::AS_save))
+    return false;
+  return IsInlinableType(VD->getType());
+}
+
+bool CodeGenModule::isInlinableFunction(const FunctionDecl *Function) {
+  if(!CodeGenOpts.InlineSmallProcedures)
+    return false;
+  auto Cached = InlinableFunctions.find(Function);
+  if(Cached != InlinableFunctions.end())
+    return Cached->second;
+
+  bool Result = false;
+  if((Function->isNormalFunction() || Function->isSubroutine()) &&
+     Function->getBody() && !Function->isExternalArgument() &&
+     (Function->isSubroutine() || IsInlinableType(Function->getType()))) {
+    Result = true;
+    for(auto I = Function->decls_begin(), End = Function->decls_end();
+        I != End; ++I) {
+      if(auto Internal = dyn_cast<FunctionDecl>(*I)) {
+        if(!Internal->isStatementFunction()) {
+          Result = false;
+          break;
+        }
+      } else if(auto VD = dyn_cast<VarDecl>(*I)) {
+        if(!VD->isFunctionResult() && !IsInlinableVariable(VD)) {
+          Result = false;
+          break;
+        }
+      }
+    }
+    for(auto Arg : Function->getArguments()) {
+      if(!IsInlinableType(Arg->getType()))
+        Result = false;
+    }
+    if(Result) {
+      InlineCandidateChecker Checker(Function);
+      Checker.Visit(Function->getBody());
+      Result = !Checker.hasFailed() &&
+               Checker.getNumStmts() <= MaxInlinedStmts;
+    }
+  }
+  InlinableFunctions[Function] = Result;
+  return Result;
+}
+
+RValueTy CodeGenFunction::EmitInlinedCall(const FunctionDecl *Function,
+                                          ArrayRef<Expr*> Arguments) {
+  // The dummy arguments refer to the actual arguments.
+  auto Args = Function->getArguments();
+  for(size_t I = 0; I < Args.size(); ++I) {
+    auto Ptr = EmitCallArgPtr(Arguments[I]);
+    auto PtrType = llvm::PointerType::get(ConvertTypeForMem(Args[I]->getType()), 0);
+    if(Ptr->getType() != PtrType)
+      Ptr = Builder.CreateBitCast(Ptr, PtrType);
+    LocalVariables[Args[I]] = Ptr;
+  }
+
+  // Every inlined call gets its own local variables.
+  for(auto I = Function->decls_begin(), End = Function->decls_end();
+      I != End; ++I) {
+    auto VD = dyn_cast<VarDecl>(*I);
+    if(!VD || VD->isParameter() || VD->isArgument() || VD->isFunctionResult())
+      continue;
+    LocalVariables[VD] = CreateTempAlloca(ConvertTypeForMem(VD->getType()),
+                                          VD->getName());
+  }
+
+  auto SavedReturnValuePtr = ReturnValuePtr;
+  auto SavedReturnBlock = ReturnBlock;
+  ReturnValuePtr = nullptr;
+  if(Function->isNormalFunction())
+    ReturnValuePtr = CreateTempAlloca(ConvertType(Function->getType()),
+                                      Function->getName());
+  ReturnBlock = createBasicBlock("inline-return");
+
+  EmitStmt(Function->getBody());
+  EmitBlock(ReturnBlock);
+
+  auto ResultPtr = ReturnValuePtr;
+  ReturnValuePtr = SavedReturnValuePtr;
+  ReturnBlock = SavedReturnBlock;
+  if(!ResultPtr)
+    return RValueTy();
+  if(Function->getType()->isComplexType())
+    return EmitComplexLoad(ResultPtr);
+  return Builder.CreateLoad(ResultPtr);
+}
+
+}
+} // end namespace flang
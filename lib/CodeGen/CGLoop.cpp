@@ -0,0 +1,1102 @@
+//===--- CGLoop.cpp - Emit LLVM Code for recognized DO loops --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This contains the analysis of DO loops and the code which emits
+// the loops that implement common array operations (copy, zero fill,
+// scaling, dot product, axpy and matrix multiplication) in a form which
+// is easier for LLVM to optimize. It also reorders and tiles the loop
+// nests which access the arrays against the column major order.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CGLoop.h"
+#include "CGArray.h"
+#include "CodeGenFunction.h"
+#include "CodeGenModule.h"
+#include "flang/AST/ASTContext.h"
+#include "flang/Frontend/FrontendDiagnostic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Metadata.h"
+#include <algorithm>
+
+namespace flang {
+namespace CodeGen {
+
+//===----------------------------------------------------------------------===//
+// Loop analysis
+//===----------------------------------------------------------------------===//
+
+bool MatchAffineSubscript(const ASTContext &C, const Expr *E,
+                          AffineSubscript &Result) {
+  if(!E->getType()->isIntegerType())
+    return false;
+  int64_t Value;
+  if(E->EvaluateAsInt(Value, C)) {
+    Result = AffineSubscript(Value);
+    return true;
+  }
+  if(auto Var = dyn_cast<VarExpr>(E)) {
+    Result = AffineSubscript(Var->getVarDecl(), 1, 0);
+    return true;
+  }
+  if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    return MatchAffineSubscript(C, Cast->getExpression(), Result);
+
+  if(auto Unary = dyn_cast<UnaryExpr>(E)) {
+    if(!MatchAffineSubscript(C, Unary->getExpression(), Result))
+      return false;
+    if(Unary->getOperator() == UnaryExpr::Minus) {
+      Result.Coefficient = -Result.Coefficient;
+      Result.Offset = -Result.Offset;
+      return true;
+    }
+    return Unary->getOperator() == UnaryExpr::Plus;
+  }
+
+  auto Binary = dyn_cast<BinaryExpr>(E);
+  if(!Binary)
+    return false;
+  AffineSubscript LHS, RHS;
+  if(!MatchAffineSubscript(C, Binary->getLHS(), LHS) ||
+     !MatchAffineSubscript(C, Binary->getRHS(), RHS))
+    return false;
+
+  switch(Binary->getOperator()) {
+  case BinaryExpr::Minus:
+    RHS.Coefficient = -RHS.Coefficient;
+    RHS.Offset = -RHS.Offset;
+    // fallthrough
+  case BinaryExpr::Plus:
+    if(LHS.Var && RHS.Var && LHS.Var != RHS.Var)
+      return false;
+    Result = AffineSubscript(LHS.Var? LHS.Var : RHS.Var,
+                             LHS.Coefficient + RHS.Coefficient,
+                             LHS.Offset + RHS.Offset);
+    break;
+  case BinaryExpr::Multiply:
+    if(LHS.isConstant())
+      std::swap(LHS, RHS);
+    if(!RHS.isConstant())
+      return false;
+    Result = AffineSubscript(LHS.Var, LHS.Coefficient * RHS.Offset,
+                             LHS.Offset * RHS.Offset);
+    break;
+  default:
+    return false;
+  }
+  // I - I => 0
+  if(Result.Coefficient == 0)
+    Result.Var = nullptr;
+  return true;
+}
+
+bool MatchAffineSubscripts(const ASTContext &C, const ArrayElementExpr *E,
+                           SmallVectorImpl<AffineSubscript> &Result) {
+  for(auto I : E->getSubscripts()) {
+    AffineSubscript Subscript;
+    if(!MatchAffineSubscript(C, I, Subscript))
+      return false;
+    Result.push_back(Subscript);
+  }
+  return true;
+}
+
+const VarDecl *GetArrayElementVar(const ArrayElementExpr *E) {
+  if(auto Var = dyn_cast<VarExpr>(E->getTarget())) {
+    if(!Var->getVarDecl()->isParameter())
+      return Var->getVarDecl();
+  }
+  return nullptr;
+}
+
+static bool AddLoopBodyStatement(const Stmt *S,
+                                 SmallVectorImpl<const Stmt*> &Result) {
+  if(S->isStmtLabelUsedAsGotoTarget())
+    return false;
+  if(!isa<ConstructPartStmt>(S) && !isa<ContinueStmt>(S))
+    Result.push_back(S);
+  return true;
+}
+
+bool GetLoopBodyStatements(const Stmt *Body,
+                           SmallVectorImpl<const Stmt*> &Result) {
+  if(!Body)
+    return true;
+  if(auto Block = dyn_cast<BlockStmt>(Body)) {
+    for(auto I : Block->getStatements()) {
+      if(!AddLoopBodyStatement(I, Result))
+        return false;
+    }
+    return true;
+  }
+  return AddLoopBodyStatement(Body, Result);
+}
+
+const VarDecl *GetUnitStrideLoopVar(const ASTContext &C, const DoStmt *S) {
+  auto Var = S->getDoVar()->getVarDecl();
+  if(!Var->getType()->isIntegerType())
+    return nullptr;
+  if(auto Inc = S->getIncrementationParameter()) {
+    int64_t Step;
+    if(!Inc->EvaluateAsInt(Step, C) || Step != 1)
+      return nullptr;
+  }
+  return Var;
+}
+
+bool IsLoopInvariantExpr(const Expr *E, ArrayRef<const VarDecl*> LoopVars) {
+  if(isa<ConstantExpr>(E))
+    return true;
+  if(auto Var = dyn_cast<VarExpr>(E)) {
+    auto VD = Var->getVarDecl();
+    if(VD->getType()->isArrayType())
+      return false;
+    return std::find(LoopVars.begin(), LoopVars.end(), VD) == LoopVars.end();
+  }
+  if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    return IsLoopInvariantExpr(Cast->getExpression(), LoopVars);
+  if(auto Unary = dyn_cast<UnaryExpr>(E))
+    return IsLoopInvariantExpr(Unary->getExpression(), LoopVars);
+  if(auto Binary = dyn_cast<BinaryExpr>(E))
+    return IsLoopInvariantExpr(Binary->getLHS(), LoopVars) &&
+           IsLoopInvariantExpr(Binary->getRHS(), LoopVars);
+  return false;
+}
+
+bool HasIndependentStorage(const VarDecl *VD) {
+  auto Set = VD->getStorageSet();
+  if(!Set)
+    return true;
+  if(isa<EquivalenceSet>(Set))
+    return false;
+  for(auto Obj : cast<CommonBlockSet>(Set)->getObjects()) {
+    if(Obj.Var == VD)
+      return Obj.Equiv == nullptr;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Loop idiom recognition
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+enum LoopIdiomKind {
+  IdiomCopy,
+  IdiomZeroFill,
+  IdiomScale,
+  IdiomDotProduct,
+  IdiomAxpy,
+  IdiomMatrixMultiply
+};
+
+/// LoopBounds - the values which control a unit stride DO loop.
+struct LoopBounds {
+  llvm::Value *VarPtr;
+  llvm::Value *Init;
+  llvm::Value *Count;
+};
+
+/// CountedLoopEmitter - Emits a unit stride DO loop
+/// which runs for the precomputed number of iterations.
+class CountedLoopEmitter {
+  CodeGenFunction &CGF;
+  CGBuilderTy &Builder;
+  LoopBounds Bounds;
+  llvm::Value *Counter;
+  llvm::BasicBlock *Loop;
+  llvm::BasicBlock *EndLoop;
+public:
+  CountedLoopEmitter(CodeGenFunction &cgf)
+    : CGF(cgf), Builder(cgf.getBuilder()) {}
+
+  void EmitBegin(const LoopBounds &B) {
+    auto &CGM = CGF.getModule();
+    Bounds = B;
+    Builder.CreateStore(Bounds.Init, Bounds.VarPtr);
+    Counter = CGF.CreateTempAlloca(CGM.SizeTy, "iteration-count");
+    Builder.CreateStore(Bounds.Count, Counter);
+
+    Loop = CGF.createBasicBlock("do");
+    auto LoopBody = CGF.createBasicBlock("loop");
+    EndLoop = CGF.createBasicBlock("end-do");
+    CGF.EmitBlock(Loop);
+    auto Cond = Builder.CreateICmpNE(Builder.CreateLoad(Counter),
+                                     llvm::ConstantInt::get(CGM.SizeTy, 0));
+    Builder.CreateCondBr(Cond, LoopBody, EndLoop);
+    CGF.EmitBlock(LoopBody);
+  }
+
+  void EmitEnd(llvm::MDNode *LoopID = nullptr) {
+    auto &CGM = CGF.getModule();
+    auto Val = Builder.CreateLoad(Bounds.VarPtr);
+    Builder.CreateStore(Builder.CreateAdd(Val,
+                          llvm::ConstantInt::get(Val->getType(), 1)),
+                        Bounds.VarPtr);
+    Builder.CreateStore(Builder.CreateSub(Builder.CreateLoad(Counter),
+                          llvm::ConstantInt::get(CGM.SizeTy, 1)),
+                        Counter);
+    auto Latch = Builder.CreateBr(Loop);
+    if(LoopID)
+      Latch->setMetadata("llvm.loop", LoopID);
+    CGF.EmitBlock(EndLoop);
+  }
+};
+
+/// LoopEmitterBase - the common code for the emitters which
+/// replace the DO loops with the equivalent, but faster, code.
+class LoopEmitterBase {
+protected:
+  CodeGenFunction &CGF;
+  CodeGenModule &CGM;
+  CGBuilderTy &Builder;
+  const ASTContext &Context;
+
+  LoopEmitterBase(CodeGenFunction &cgf)
+    : CGF(cgf), CGM(cgf.getModule()), Builder(cgf.getBuilder()),
+      Context(cgf.getContext()) {}
+
+  LoopBounds EmitLoopBounds(const DoStmt *S);
+  llvm::Value *EmitLoopVarFinalValue(const LoopBounds &Bounds);
+  void EmitNestFinalValues(ArrayRef<LoopBounds> Bounds,
+                           ArrayRef<llvm::Value*> PrevValues);
+  llvm::MDNode *CreateVectorizeLoopID();
+};
+
+/// LoopIdiomEmitter - recognizes the DO loops which implement
+/// common linear algebra operations and emits them either as
+/// memory intrinsics or as loops which the vectorizer is asked to
+/// vectorize and interleave.
+class LoopIdiomEmitter : public LoopEmitterBase {
+  bool IsContiguousAccess(const ArrayElementExpr *E, const VarDecl *LoopVar,
+                          SmallVectorImpl<AffineSubscript> &Subscripts);
+  bool IsSameElement(const Expr *E, const ArrayElementExpr *Element);
+  bool HaveSameArithmeticType(QualType A, QualType B);
+  bool IsZeroConstant(const Expr *E);
+
+  bool EmitSingleLoop(const DoStmt *S, const VarDecl *Var,
+                      const AssignmentStmt *Body);
+  bool EmitMatrixMultiply(ArrayRef<const DoStmt*> Loops,
+                          ArrayRef<const VarDecl*> Vars,
+                          const AssignmentStmt *Body);
+
+  llvm::Value *EmitByteSize(llvm::Value *Count, llvm::Type *ElementType);
+  void EmitRemark(const DoStmt *S, LoopIdiomKind Kind);
+public:
+  LoopIdiomEmitter(CodeGenFunction &cgf)
+    : LoopEmitterBase(cgf) {}
+
+  bool Emit(const DoStmt *S);
+};
+
+/// LoopNestEmitter - reorders and tiles the perfect DO loop nests
+/// whose innermost loop accesses the arrays with a large stride.
+class LoopNestEmitter : public LoopEmitterBase {
+  /// ArrayAccess - an array element which is accessed in the nest.
+  struct ArrayAccess {
+    const VarDecl *Array;
+    SmallVector<AffineSubscript, 4> Subscripts;
+    bool IsWrite;
+  };
+
+  /// LoopVarUse - describes how the loop variable is used
+  /// in the subscripts of the array accesses.
+  struct LoopVarUse {
+    unsigned Weight;
+    unsigned Contiguous;
+    unsigned Strided;
+  };
+
+  SmallVector<const DoStmt*, 4> Loops;
+  SmallVector<const VarDecl*, 4> Vars;
+  SmallVector<const Stmt*, 8> Body;
+  SmallVector<ArrayAccess, 16> Accesses;
+
+  /// The inner loops of the nests which were reported as impossible
+  /// to reorder.
+  llvm::SmallPtrSetImpl<const DoStmt*> &InnerReportedLoops;
+
+  bool CollectNest(const DoStmt *S);
+  bool CollectAccesses(const Expr *E, bool IsWrite);
+  LoopVarUse GetLoopVarUse(const VarDecl *Var);
+  bool IsReorderingLegal();
+  std::string GetLoopOrder(ArrayRef<unsigned> Order);
+
+  LoopBounds EmitTileBounds(const LoopBounds &Bounds);
+  LoopBounds EmitLoopBoundsInTile(const LoopBounds &Bounds,
+                                  const LoopBounds &Tiles);
+public:
+  LoopNestEmitter(CodeGenFunction &cgf,
+                  llvm::SmallPtrSetImpl<const DoStmt*> &Reported)
+    : LoopEmitterBase(cgf), InnerReportedLoops(Reported) {}
+
+  bool Emit(const DoStmt *S);
+};
+
+} // end anonymous namespace
+
+bool LoopIdiomEmitter::IsContiguousAccess(const ArrayElementExpr *E,
+                                          const VarDecl *LoopVar,
+                                          SmallVectorImpl<AffineSubscript> &Subscripts) {
+  if(!GetArrayElementVar(E))
+    return false;
+  Subscripts.clear();
+  if(!MatchAffineSubscripts(Context, E, Subscripts))
+    return false;
+  // The loop walks the first dimension, which is contiguous
+  // in the column major order.
+  if(!Subscripts[0].isUnitStride(LoopVar))
+    return false;
+  for(size_t I = 1; I < Subscripts.size(); ++I) {
+    if(Subscripts[I].Var == LoopVar)
+      return false;
+  }
+  return true;
+}
+
+bool LoopIdiomEmitter::IsSameElement(const Expr *E,
+                                     const ArrayElementExpr *Element) {
+  auto Other = dyn_cast<ArrayElementExpr>(E);
+  if(!Other || GetArrayElementVar(Other) != GetArrayElementVar(Element))
+    return false;
+  SmallVector<AffineSubscript, 4> A, B;
+  if(!MatchAffineSubscripts(Context, Element, A) ||
+     !MatchAffineSubscripts(Context, Other, B))
+    return false;
+  return std::equal(A.begin(), A.end(), B.begin());
+}
+
+bool LoopIdiomEmitter::HaveSameArithmeticType(QualType A, QualType B) {
+  if(!((A->isIntegerType() && B->isIntegerType()) ||
+       (A->isRealType() && B->isRealType())))
+    return false;
+  return CGF.ConvertType(A) == CGF.ConvertType(B);
+}
+
+bool LoopIdiomEmitter::IsZeroConstant(const Expr *E) {
+  if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    E = Cast->getExpression();
+  if(auto Int = dyn_cast<IntegerConstantExpr>(E))
+    return Int->getValue() == 0;
+  if(auto Real = dyn_cast<RealConstantExpr>(E)) {
+    auto Value = Real->getValue();
+    return Value.isZero() && !Value.isNegative();
+  }
+  return false;
+}
+
+LoopBounds LoopEmitterBase::EmitLoopBounds(const DoStmt *S) {
+  LoopBounds Result;
+  Result.VarPtr = CGF.GetVarPtr(S->getDoVar()->getVarDecl());
+  Result.Init = CGF.EmitScalarExpr(S->getInitialParameter());
+  auto End = CGF.EmitScalarExpr(S->getTerminalParameter());
+  // Count = MAX(End - Init + 1, 0)
+  auto Count = Builder.CreateAdd(Builder.CreateSub(End, Result.Init),
+                                 llvm::ConstantInt::get(End->getType(), 1));
+  Count = Builder.CreateSExtOrTrunc(Count, CGM.SizeTy);
+  auto Zero = llvm::ConstantInt::get(CGM.SizeTy, 0);
+  Result.Count = Builder.CreateSelect(Builder.CreateICmpSGT(Count, Zero),
+                                      Count, Zero, "max");
+  return Result;
+}
+
+llvm::Value *LoopEmitterBase::EmitLoopVarFinalValue(const LoopBounds &Bounds) {
+  return Builder.CreateAdd(Bounds.Init,
+                           Builder.CreateSExtOrTrunc(Bounds.Count,
+                                                     Bounds.Init->getType()));
+}
+
+void LoopEmitterBase::EmitNestFinalValues(ArrayRef<LoopBounds> Bounds,
+                                          ArrayRef<llvm::Value*> PrevValues) {
+  // Give the DO variables the values they would have after
+  // the original nest. The variable of an inner loop is only
+  // defined when all of the outer loops have run.
+  llvm::Value *OuterLoopsRan = nullptr;
+  auto Zero = llvm::ConstantInt::get(CGM.SizeTy, 0);
+  for(size_t I = 0; I < Bounds.size(); ++I) {
+    auto Value = EmitLoopVarFinalValue(Bounds[I]);
+    if(OuterLoopsRan)
+      Value = Builder.CreateSelect(OuterLoopsRan, Value, PrevValues[I]);
+    Builder.CreateStore(Value, Bounds[I].VarPtr);
+    auto Ran = Builder.CreateICmpNE(Bounds[I].Count, Zero);
+    OuterLoopsRan = OuterLoopsRan? Builder.CreateAnd(OuterLoopsRan, Ran) : Ran;
+  }
+}
+
+llvm::Value *LoopIdiomEmitter::EmitByteSize(llvm::Value *Count,
+                                            llvm::Type *ElementType) {
+  auto Size = CGM.getDataLayout().getTypeAllocSize(ElementType);
+  return Builder.CreateMul(Count, llvm::ConstantInt::get(CGM.SizeTy, Size));
+}
+
+llvm::MDNode *LoopEmitterBase::CreateVectorizeLoopID() {
+  auto &VMContext = CGF.getLLVMContext();
+  llvm::Metadata *Vectorize[] = {
+    llvm::MDString::get(VMContext, "llvm.loop.vectorize.enable"),
+    llvm::ConstantAsMetadata::get(Builder.getTrue())
+  };
+  llvm::Metadata *Interleave[] = {
+    llvm::MDString::get(VMContext, "llvm.loop.interleave.count"),
+    llvm::ConstantAsMetadata::get(Builder.getInt32(4))
+  };
+  // The first operand is a self reference which makes the loop id unique.
+  auto TempNode = llvm::MDNode::getTemporary(VMContext, llvm::None);
+  llvm::Metadata *Args[] = {
+    TempNode.get(),
+    llvm::MDNode::get(VMContext, Vectorize),
+    llvm::MDNode::get(VMContext, Interleave)
+  };
+  auto LoopID = llvm::MDNode::get(VMContext, Args);
+  LoopID->replaceOperandWith(0, LoopID);
+  return LoopID;
+}
+
+void LoopIdiomEmitter::EmitRemark(const DoStmt *S, LoopIdiomKind Kind) {
+  CGM.getDiags().Report(S->getLocation(), diag::remark_fe_loop_idiom)
+    << int(Kind);
+}
+
+bool LoopIdiomEmitter::Emit(const DoStmt *S) {
+  auto Var = GetUnitStrideLoopVar(Context, S);
+  if(!Var)
+    return false;
+  SmallVector<const Stmt*, 4> Body;
+  if(!GetLoopBodyStatements(S->getBody(), Body) || Body.size() != 1)
+    return false;
+  if(auto Assignment = dyn_cast<AssignmentStmt>(Body[0]))
+    return EmitSingleLoop(S, Var, Assignment);
+
+  // A perfect nest of three loops.
+  const DoStmt *Loops[3] = { S, nullptr, nullptr };
+  const VarDecl *Vars[3] = { Var, nullptr, nullptr };
+  for(int I = 1; I < 3; ++I) {
+    Loops[I] = dyn_cast<DoStmt>(Body[0]);
+    if(!Loops[I])
+      return false;
+    Vars[I] = GetUnitStrideLoopVar(Context, Loops[I]);
+    if(!Vars[I])
+      return false;
+    Body.clear();
+    if(!GetLoopBodyStatements(Loops[I]->getBody(), Body) || Body.size() != 1)
+      return false;
+  }
+  auto Assignment = dyn_cast<AssignmentStmt>(Body[0]);
+  if(!Assignment)
+    return false;
+  return EmitMatrixMultiply(Loops, Vars, Assignment);
+}
+
+bool LoopIdiomEmitter::EmitSingleLoop(const DoStmt *S, const VarDecl *Var,
+                                      const AssignmentStmt *Body) {
+  auto LHS = Body->getLHS();
+  auto RHS = Body->getRHS();
+  SmallVector<AffineSubscript, 4> Subscripts;
+
+  // S = S + X(I) * Y(I)
+  if(auto Acc = dyn_cast<VarExpr>(LHS)) {
+    auto AccVar = Acc->getVarDecl();
+    auto Sum = dyn_cast<BinaryExpr>(RHS);
+    if(AccVar == Var || !HasIndependentStorage(AccVar) ||
+       !Sum || Sum->getOperator() != BinaryExpr::Plus)
+      return false;
+    bool AccFirst = true;
+    auto Other = Sum->getRHS();
+    auto AccOperand = dyn_cast<VarExpr>(Sum->getLHS());
+    if(!AccOperand || AccOperand->getVarDecl() != AccVar) {
+      AccFirst = false;
+      Other = Sum->getLHS();
+      AccOperand = dyn_cast<VarExpr>(Sum->getRHS());
+      if(!AccOperand || AccOperand->getVarDecl() != AccVar)
+        return false;
+    }
+    auto Product = dyn_cast<BinaryExpr>(Other);
+    if(!Product || Product->getOperator() != BinaryExpr::Multiply)
+      return false;
+    auto X = dyn_cast<ArrayElementExpr>(Product->getLHS());
+    auto Y = dyn_cast<ArrayElementExpr>(Product->getRHS());
+    if(!X || !Y ||
+       !IsContiguousAccess(X, Var, Subscripts) ||
+       !IsContiguousAccess(Y, Var, Subscripts) ||
+       !HaveSameArithmeticType(Acc->getType(), X->getType()) ||
+       !HaveSameArithmeticType(Acc->getType(), Y->getType()))
+      return false;
+
+    EmitRemark(S, IdiomDotProduct);
+    auto Bounds = EmitLoopBounds(S);
+    // Keep the partial sum in a temporary so that it stays in a register.
+    auto AccPtr = CGF.CreateTempAlloca(CGF.ConvertType(Acc->getType()),
+                                       "dot-acc");
+    Builder.CreateStore(CGF.EmitScalarExpr(Acc), AccPtr);
+    CountedLoopEmitter Loop(CGF);
+    Loop.EmitBegin(Bounds);
+    auto Mul = CGF.EmitScalarBinaryExpr(BinaryExpr::Multiply,
+                                        CGF.EmitScalarExpr(X),
+                                        CGF.EmitScalarExpr(Y));
+    auto Partial = Builder.CreateLoad(AccPtr);
+    Builder.CreateStore(AccFirst?
+                          CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, Partial, Mul) :
+                          CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, Mul, Partial),
+                        AccPtr);
+    // Vectorizing the loop splits the sum into several partial sums, which
+    // changes the rounding of a real sum unless reassociation is allowed.
+    if(Acc->getType()->isIntegerType() || CGM.getCodeGenOpts().UnsafeFPMath)
+      Loop.EmitEnd(CreateVectorizeLoopID());
+    else
+      Loop.EmitEnd();
+    CGF.EmitAssignment(CGF.EmitLValue(Acc), Builder.CreateLoad(AccPtr));
+    return true;
+  }
+
+  auto Dest = dyn_cast<ArrayElementExpr>(LHS);
+  if(!Dest || !IsContiguousAccess(Dest, Var, Subscripts))
+    return false;
+  auto DestVar = GetArrayElementVar(Dest);
+  if(!HasIndependentStorage(DestVar))
+    return false;
+  auto ElementType = CGF.ConvertTypeForMem(Dest->getType());
+  auto Align = CGM.getDataLayout().getABITypeAlignment(ElementType);
+  // The memory intrinsics skip the bounds checks of the individual elements.
+  bool UseMemIntrinsics = !CGM.getCodeGenOpts().BoundsCheck;
+
+  // A(I) = B(I)
+  if(auto Src = dyn_cast<ArrayElementExpr>(RHS)) {
+    if(!UseMemIntrinsics)
+      return false;
+    auto SrcVar = GetArrayElementVar(Src);
+    if(!SrcVar || SrcVar == DestVar || !HasIndependentStorage(SrcVar) ||
+       !IsContiguousAccess(Src, Var, Subscripts) ||
+       Dest->getType()->isCharacterType() ||
+       CGF.ConvertTypeForMem(Src->getType()) != ElementType)
+      return false;
+
+    EmitRemark(S, IdiomCopy);
+    auto Bounds = EmitLoopBounds(S);
+    // Compute the addresses of the elements for the first iteration.
+    Builder.CreateStore(Bounds.Init, Bounds.VarPtr);
+    auto DestPtr = CGF.EmitArrayElementPtr(Dest);
+    auto SrcPtr = CGF.EmitArrayElementPtr(Src);
+    Builder.CreateMemMove(DestPtr, SrcPtr,
+                          EmitByteSize(Bounds.Count, ElementType), Align);
+    Builder.CreateStore(EmitLoopVarFinalValue(Bounds), Bounds.VarPtr);
+    return true;
+  }
+
+  // A(I) = 0
+  if(IsZeroConstant(RHS)) {
+    if(!UseMemIntrinsics ||
+       !HaveSameArithmeticType(Dest->getType(), RHS->getType()))
+      return false;
+
+    EmitRemark(S, IdiomZeroFill);
+    auto Bounds = EmitLoopBounds(S);
+    Builder.CreateStore(Bounds.Init, Bounds.VarPtr);
+    Builder.CreateMemSet(CGF.EmitArrayElementPtr(Dest), Builder.getInt8(0),
+                         EmitByteSize(Bounds.Count, ElementType), Align);
+    Builder.CreateStore(EmitLoopVarFinalValue(Bounds), Bounds.VarPtr);
+    return true;
+  }
+
+  auto Binary = dyn_cast<BinaryExpr>(RHS);
+  if(!Binary || !HaveSameArithmeticType(Dest->getType(), RHS->getType()))
+    return false;
+
+  // Y(I) = Y(I) + A * X(I)
+  const BinaryExpr *Scaled = Binary;
+  const ArrayElementExpr *Acc = nullptr;
+  bool AccFirst = true;
+  if(Binary->getOperator() == BinaryExpr::Plus) {
+    if(IsSameElement(Binary->getLHS(), Dest)) {
+      Acc = cast<ArrayElementExpr>(Binary->getLHS());
+      Scaled = dyn_cast<BinaryExpr>(Binary->getRHS());
+    } else if(IsSameElement(Binary->getRHS(), Dest)) {
+      AccFirst = false;
+      Acc = cast<ArrayElementExpr>(Binary->getRHS());
+      Scaled = dyn_cast<BinaryExpr>(Binary->getLHS());
+    } else
+      return false;
+  }
+
+  // Y(I) = A * X(I)
+  if(!Scaled || Scaled->getOperator() != BinaryExpr::Multiply)
+    return false;
+  bool AlphaFirst = true;
+  const Expr *Alpha = Scaled->getLHS();
+  auto X = dyn_cast<ArrayElementExpr>(Scaled->getRHS());
+  if(!X) {
+    AlphaFirst = false;
+    Alpha = Scaled->getRHS();
+    X = dyn_cast<ArrayElementExpr>(Scaled->getLHS());
+  }
+  const VarDecl *LoopVars[] = { Var };
+  if(!X || !IsContiguousAccess(X, Var, Subscripts) ||
+     !IsLoopInvariantExpr(Alpha, LoopVars) ||
+     !HaveSameArithmeticType(Dest->getType(), X->getType()) ||
+     !HaveSameArithmeticType(Dest->getType(), Alpha->getType()))
+    return false;
+  auto XVar = GetArrayElementVar(X);
+  if(XVar == DestVar) {
+    // Scaling in place is fine, but the axpy needs two arrays.
+    if(Acc || !IsSameElement(X, Dest))
+      return false;
+  } else if(!HasIndependentStorage(XVar))
+    return false;
+
+  EmitRemark(S, Acc? IdiomAxpy : IdiomScale);
+  auto Bounds = EmitLoopBounds(S);
+  auto AlphaValue = CGF.EmitScalarExpr(Alpha);
+  CountedLoopEmitter Loop(CGF);
+  Loop.EmitBegin(Bounds);
+  auto XValue = CGF.EmitScalarExpr(X);
+  llvm::Value *Result = AlphaFirst?
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Multiply, AlphaValue, XValue) :
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Multiply, XValue, AlphaValue);
+  if(Acc) {
+    auto AccValue = CGF.EmitScalarExpr(Acc);
+    Result = AccFirst?
+      CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, AccValue, Result) :
+      CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, Result, AccValue);
+  }
+  CGF.EmitAssignment(CGF.EmitLValue(Dest), Result);
+  Loop.EmitEnd(CreateVectorizeLoopID());
+  return true;
+}
+
+bool LoopIdiomEmitter::EmitMatrixMultiply(ArrayRef<const DoStmt*> Loops,
+                                          ArrayRef<const VarDecl*> Vars,
+                                          const AssignmentStmt *Body) {
+  // C(I,J) = C(I,J) + A(I,K) * B(K,J)
+  if(Vars[0] == Vars[1] || Vars[0] == Vars[2] || Vars[1] == Vars[2])
+    return false;
+  for(auto Loop : Loops) {
+    if(!IsLoopInvariantExpr(Loop->getInitialParameter(), Vars) ||
+       !IsLoopInvariantExpr(Loop->getTerminalParameter(), Vars))
+      return false;
+  }
+
+  auto Dest = dyn_cast<ArrayElementExpr>(Body->getLHS());
+  auto Sum = dyn_cast<BinaryExpr>(Body->getRHS());
+  if(!Dest || Dest->getSubscripts().size() != 2 ||
+     !Sum || Sum->getOperator() != BinaryExpr::Plus)
+    return false;
+  SmallVector<AffineSubscript, 2> DestSubscripts;
+  if(!MatchAffineSubscripts(Context, Dest, DestSubscripts))
+    return false;
+  auto RowVar = DestSubscripts[0].Var;
+  auto ColVar = DestSubscripts[1].Var;
+  if(!DestSubscripts[0].isUnitStride(RowVar) ||
+     !DestSubscripts[1].isUnitStride(ColVar) || RowVar == ColVar)
+    return false;
+
+  // Find out which loop runs over which dimension.
+  int RowLoop = -1, ColLoop = -1, SumLoop = -1;
+  for(int I = 0; I < 3; ++I) {
+    if(Vars[I] == RowVar) RowLoop = I;
+    else if(Vars[I] == ColVar) ColLoop = I;
+    else SumLoop = I;
+  }
+  if(RowLoop == -1 || ColLoop == -1)
+    return false;
+  auto SumVar = Vars[SumLoop];
+
+  bool AccFirst = true;
+  auto Other = Sum->getRHS();
+  auto Acc = Sum->getLHS();
+  if(!IsSameElement(Acc, Dest)) {
+    AccFirst = false;
+    std::swap(Other, Acc);
+    if(!IsSameElement(Acc, Dest))
+      return false;
+  }
+  auto Product = dyn_cast<BinaryExpr>(Other);
+  if(!Product || Product->getOperator() != BinaryExpr::Multiply)
+    return false;
+  auto A = dyn_cast<ArrayElementExpr>(Product->getLHS());
+  auto B = dyn_cast<ArrayElementExpr>(Product->getRHS());
+  if(!A || !B || A->getSubscripts().size() != 2 ||
+     B->getSubscripts().size() != 2)
+    return false;
+  bool AFirst = true;
+  SmallVector<AffineSubscript, 2> ASubscripts, BSubscripts;
+  if(!MatchAffineSubscripts(Context, A, ASubscripts) ||
+     !MatchAffineSubscripts(Context, B, BSubscripts))
+    return false;
+  if(!ASubscripts[0].isUnitStride(RowVar)) {
+    AFirst = false;
+    std::swap(A, B);
+    std::swap(ASubscripts, BSubscripts);
+  }
+  if(!ASubscripts[0].isUnitStride(RowVar) ||
+     !ASubscripts[1].isUnitStride(SumVar) ||
+     !BSubscripts[0].isUnitStride(SumVar) ||
+     !BSubscripts[1].isUnitStride(ColVar))
+    return false;
+
+  auto CVar = GetArrayElementVar(Dest);
+  auto AVar = GetArrayElementVar(A);
+  auto BVar = GetArrayElementVar(B);
+  if(!AVar || !BVar || CVar == AVar || CVar == BVar ||
+     !HasIndependentStorage(CVar) || !HasIndependentStorage(AVar) ||
+     !HasIndependentStorage(BVar) ||
+     !HaveSameArithmeticType(Dest->getType(), A->getType()) ||
+     !HaveSameArithmeticType(Dest->getType(), B->getType()))
+    return false;
+
+  EmitRemark(Loops[0], IdiomMatrixMultiply);
+  LoopBounds Bounds[3];
+  llvm::Value *PrevValues[3];
+  for(int I = 0; I < 3; ++I)
+    Bounds[I] = EmitLoopBounds(Loops[I]);
+  for(int I = 0; I < 3; ++I)
+    PrevValues[I] = Builder.CreateLoad(Bounds[I].VarPtr);
+
+  // Emit the nest in the J, K, I order, so that the innermost loop
+  // walks the columns of C and A with unit stride. Every element of C
+  // still accumulates the products in the same order.
+  CountedLoopEmitter Outer(CGF), Middle(CGF), Inner(CGF);
+  Outer.EmitBegin(Bounds[ColLoop]);
+  Middle.EmitBegin(Bounds[SumLoop]);
+  auto BValue = CGF.EmitScalarExpr(B);
+  Inner.EmitBegin(Bounds[RowLoop]);
+  auto AValue = CGF.EmitScalarExpr(A);
+  llvm::Value *Result = AFirst?
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Multiply, AValue, BValue) :
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Multiply, BValue, AValue);
+  auto AccValue = CGF.EmitScalarExpr(Acc);
+  Result = AccFirst?
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, AccValue, Result) :
+    CGF.EmitScalarBinaryExpr(BinaryExpr::Plus, Result, AccValue);
+  CGF.EmitAssignment(CGF.EmitLValue(Dest), Result);
+  Inner.EmitEnd(CreateVectorizeLoopID());
+  Middle.EmitEnd();
+  Outer.EmitEnd();
+
+  EmitNestFinalValues(Bounds, PrevValues);
+  return true;
+}
+
+/// The number of iterations in one tile of a tiled loop, which is chosen
+/// so that a tile of an array of double precision values fits into L1.
+static const unsigned LoopTileSize = 32;
+
+bool LoopNestEmitter::CollectNest(const DoStmt *S) {
+  for(auto Loop = S; Loop; ) {
+    auto Var = GetUnitStrideLoopVar(Context, Loop);
+    if(!Var || std::find(Vars.begin(), Vars.end(), Var) != Vars.end())
+      return false;
+    Loops.push_back(Loop);
+    Vars.push_back(Var);
+    Body.clear();
+    if(!GetLoopBodyStatements(Loop->getBody(), Body))
+      return false;
+    Loop = Body.size() == 1? dyn_cast<DoStmt>(Body[0]) : nullptr;
+  }
+  if(Loops.size() < 2 || Body.empty())
+    return false;
+  for(auto Loop : Loops) {
+    if(!IsLoopInvariantExpr(Loop->getInitialParameter(), Vars) ||
+       !IsLoopInvariantExpr(Loop->getTerminalParameter(), Vars))
+      return false;
+  }
+  // Only the array elements can be assigned, as the assignment
+  // of a scalar makes the result depend on the order of iterations.
+  for(auto I : Body) {
+    auto Assignment = dyn_cast<AssignmentStmt>(I);
+    if(!Assignment || !isa<ArrayElementExpr>(Assignment->getLHS()) ||
+       !CollectAccesses(Assignment->getLHS(), true) ||
+       !CollectAccesses(Assignment->getRHS(), false))
+      return false;
+  }
+  return true;
+}
+
+bool LoopNestEmitter::CollectAccesses(const Expr *E, bool IsWrite) {
+  if(isa<ConstantExpr>(E))
+    return true;
+  if(auto Var = dyn_cast<VarExpr>(E))
+    return !Var->getVarDecl()->getType()->isArrayType();
+  if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    return CollectAccesses(Cast->getExpression(), false);
+  if(auto Unary = dyn_cast<UnaryExpr>(E))
+    return CollectAccesses(Unary->getExpression(), false);
+  if(auto Binary = dyn_cast<BinaryExpr>(E))
+    return CollectAccesses(Binary->getLHS(), false) &&
+           CollectAccesses(Binary->getRHS(), false);
+
+  auto Element = dyn_cast<ArrayElementExpr>(E);
+  if(!Element || Element->getType()->isCharacterType())
+    return false;
+  ArrayAccess Access;
+  Access.Array = GetArrayElementVar(Element);
+  Access.IsWrite = IsWrite;
+  if(!Access.Array || !HasIndependentStorage(Access.Array) ||
+     !MatchAffineSubscripts(Context, Element, Access.Subscripts))
+    return false;
+  Accesses.push_back(Access);
+  return true;
+}
+
+LoopNestEmitter::LoopVarUse LoopNestEmitter::GetLoopVarUse(const VarDecl *Var) {
+  LoopVarUse Use = { 0, 0, 0 };
+  for(const auto &Access : Accesses) {
+    for(size_t Dim = 0; Dim < Access.Subscripts.size(); ++Dim) {
+      if(Access.Subscripts[Dim].Var != Var)
+        continue;
+      Use.Weight += Dim;
+      if(Dim == 0) ++Use.Contiguous;
+      else ++Use.Strided;
+    }
+  }
+  return Use;
+}
+
+bool LoopNestEmitter::IsReorderingLegal() {
+  for(const auto &Write : Accesses) {
+    if(!Write.IsWrite)
+      continue;
+    // The element which is written has to be accessed using the same
+    // subscripts everywhere in the loop body.
+    for(const auto &Access : Accesses) {
+      if(Access.Array == Write.Array && !(Access.Subscripts == Write.Subscripts))
+        return false;
+    }
+    // The iterations which write the same element can only differ in one
+    // loop variable, as only the relative order of those iterations
+    // is preserved after the loops are reordered.
+    size_t UsedVars = 0;
+    for(auto Var : Vars) {
+      for(const auto &Subscript : Write.Subscripts) {
+        if(Subscript.Var == Var) {
+          ++UsedVars;
+          break;
+        }
+      }
+    }
+    if(UsedVars + 1 < Vars.size())
+      return false;
+  }
+  return true;
+}
+
+std::string LoopNestEmitter::GetLoopOrder(ArrayRef<unsigned> Order) {
+  std::string Result;
+  for(auto I : Order) {
+    if(!Result.empty())
+      Result += ", ";
+    Result += Vars[I]->getName();
+  }
+  return Result;
+}
+
+LoopBounds LoopNestEmitter::EmitTileBounds(const LoopBounds &Bounds) {
+  LoopBounds Result;
+  Result.VarPtr = CGF.CreateTempAlloca(CGM.SizeTy, "tile");
+  Result.Init = llvm::ConstantInt::get(CGM.SizeTy, 0);
+  auto TileSize = llvm::ConstantInt::get(CGM.SizeTy, LoopTileSize);
+  Result.Count = Builder.CreateUDiv(
+                   Builder.CreateAdd(Bounds.Count,
+                     llvm::ConstantInt::get(CGM.SizeTy, LoopTileSize - 1)),
+                   TileSize);
+  return Result;
+}
+
+LoopBounds LoopNestEmitter::EmitLoopBoundsInTile(const LoopBounds &Bounds,
+                                                 const LoopBounds &Tiles) {
+  LoopBounds Result;
+  auto TileSize = llvm::ConstantInt::get(CGM.SizeTy, LoopTileSize);
+  auto Start = Builder.CreateMul(Builder.CreateLoad(Tiles.VarPtr), TileSize);
+  Result.VarPtr = Bounds.VarPtr;
+  Result.Init = Builder.CreateAdd(Bounds.Init,
+                  Builder.CreateZExtOrTrunc(Start, Bounds.Init->getType()));
+  auto Remaining = Builder.CreateSub(Bounds.Count, Start);
+  Result.Count = Builder.CreateSelect(Builder.CreateICmpULT(Remaining, TileSize),
+                                      Remaining, TileSize, "min");
+  return Result;
+}
+
+bool LoopNestEmitter::Emit(const DoStmt *S) {
+  if(!CollectNest(S))
+    return false;
+
+  // Order the loops so that the variables which are used in the
+  // higher dimensions are incremented in the outer loops.
+  SmallVector<LoopVarUse, 4> Uses;
+  SmallVector<unsigned, 4> Order;
+  for(unsigned I = 0; I < Vars.size(); ++I) {
+    Uses.push_back(GetLoopVarUse(Vars[I]));
+    Order.push_back(I);
+  }
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return Uses[A].Weight > Uses[B].Weight;
+  });
+  bool Interchange = false;
+  for(unsigned I = 0; I < Order.size(); ++I) {
+    if(Order[I] != I)
+      Interchange = true;
+  }
+  // When one array is accessed with the transposed subscripts of the
+  // other one, there's no order in which both are accessed with a unit
+  // stride, so the two innermost loops are tiled.
+  auto Inner = Order[Order.size() - 1];
+  auto Outer = Order[Order.size() - 2];
+  bool Tile = Uses[Inner].Strided != 0 && Uses[Outer].Contiguous != 0;
+  if(!Interchange && !Tile)
+    return false;
+
+  if(!IsReorderingLegal()) {
+    // The nest is reported once, at its outermost loop, and not again
+    // when its inner loops are emitted as a nest of their own.
+    if(Interchange && !InnerReportedLoops.count(S)) {
+      CGM.getDiags().Report(S->getLocation(),
+                            diag::warn_fe_loop_interchange_illegal)
+        << GetLoopOrder(Order);
+      InnerReportedLoops.insert(Loops.begin() + 1, Loops.end());
+    }
+    return false;
+  }
+  CGM.getDiags().Report(S->getLocation(), diag::remark_fe_loop_interchange)
+    << (Interchange? (Tile? 2 : 0) : 1) << GetLoopOrder(Order);
+
+  SmallVector<LoopBounds, 4> Bounds;
+  SmallVector<llvm::Value*, 4> PrevValues;
+  for(auto Loop : Loops)
+    Bounds.push_back(EmitLoopBounds(Loop));
+  for(const auto &B : Bounds)
+    PrevValues.push_back(Builder.CreateLoad(B.VarPtr));
+
+  SmallVector<CountedLoopEmitter, 8> Emitters;
+  auto EmitLoopBegin = [&](const LoopBounds &B) {
+    Emitters.push_back(CountedLoopEmitter(CGF));
+    Emitters.back().EmitBegin(B);
+  };
+  size_t UntiledLoops = Order.size() - (Tile? 2 : 0);
+  for(size_t I = 0; I < UntiledLoops; ++I)
+    EmitLoopBegin(Bounds[Order[I]]);
+  if(Tile) {
+    auto OuterTiles = EmitTileBounds(Bounds[Outer]);
+    auto InnerTiles = EmitTileBounds(Bounds[Inner]);
+    EmitLoopBegin(OuterTiles);
+    EmitLoopBegin(InnerTiles);
+    EmitLoopBegin(EmitLoopBoundsInTile(Bounds[Outer], OuterTiles));
+    EmitLoopBegin(EmitLoopBoundsInTile(Bounds[Inner], InnerTiles));
+  }
+  for(auto I : Body)
+    CGF.EmitStmt(I);
+  for(auto I = Emitters.rbegin(); I != Emitters.rend(); ++I)
+    I->EmitEnd();
+
+  EmitNestFinalValues(Bounds, PrevValues);
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Bounds checking
+//===----------------------------------------------------------------------===//
+
+/// \brief Collects the array elements which are accessed by the given
+/// expression. Returns false if evaluating the expression can
+/// have side effects.
+static bool CollectArrayElements(const Expr *E,
+                                 SmallVectorImpl<const ArrayElementExpr*> &Result) {
+  if(isa<ConstantExpr>(E) || isa<VarExpr>(E))
+    return true;
+  if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    return CollectArrayElements(Cast->getExpression(), Result);
+  if(auto Unary = dyn_cast<UnaryExpr>(E))
+    return CollectArrayElements(Unary->getExpression(), Result);
+  if(auto Binary = dyn_cast<BinaryExpr>(E))
+    return CollectArrayElements(Binary->getLHS(), Result) &&
+           CollectArrayElements(Binary->getRHS(), Result);
+  auto Element = dyn_cast<ArrayElementExpr>(E);
+  if(!Element)
+    return false;
+  for(auto I : Element->getSubscripts()) {
+    if(!CollectArrayElements(I, Result))
+      return false;
+  }
+  if(GetArrayElementVar(Element))
+    Result.push_back(Element);
+  return true;
+}
+
+void CodeGenFunction::EmitLoopSubscriptChecks(const DoStmt *S) {
+  auto Var = GetUnitStrideLoopVar(getContext(), S);
+  if(!Var ||
+     !IsLoopInvariantExpr(S->getInitialParameter(), Var) ||
+     !IsLoopInvariantExpr(S->getTerminalParameter(), Var))
+    return;
+
+  // The checks can only be done before the loop when every iteration
+  // accesses all of the elements, so the body can only consist
+  // of assignments without any side effects.
+  SmallVector<const Stmt*, 8> Body;
+  SmallVector<const ArrayElementExpr*, 16> Elements;
+  if(!GetLoopBodyStatements(S->getBody(), Body))
+    return;
+  for(auto I : Body) {
+    auto Assignment = dyn_cast<AssignmentStmt>(I);
+    if(!Assignment ||
+       !CollectArrayElements(Assignment->getLHS(), Elements) ||
+       !CollectArrayElements(Assignment->getRHS(), Elements))
+      return;
+  }
+
+  llvm::Value *Init = nullptr;
+  llvm::Value *End = nullptr;
+  llvm::BasicBlock *EndBlock = nullptr;
+  for(auto Element : Elements) {
+    auto Subscripts = Element->getSubscripts();
+    ArrayValueExprEmitter EV(*this, false);
+    for(size_t I = 0; I < Subscripts.size(); ++I) {
+      AffineSubscript Subscript;
+      if(!MatchAffineSubscript(getContext(), Subscripts[I], Subscript) ||
+         Subscript.Var != Var)
+        continue;
+      if(!EndBlock) {
+        // Only check the subscripts when the loop runs at least once.
+        Init = EmitSizeIntExpr(S->getInitialParameter());
+        End = EmitSizeIntExpr(S->getTerminalParameter());
+        auto CheckBlock = createBasicBlock("do-bounds-check");
+        EndBlock = createBasicBlock("do-bounds-check-end");
+        Builder.CreateCondBr(Builder.CreateICmpSLE(Init, End),
+                             CheckBlock, EndBlock);
+        EmitBlock(CheckBlock);
+      }
+      if(EV.getDimensions().empty())
+        EV.EmitExpr(Element->getTarget());
+      // The subscript is monotonic, so its extreme values
+      // are reached in the first and the last iteration.
+      auto Coefficient = llvm::ConstantInt::get(CGM.SizeTy, Subscript.Coefficient);
+      auto Offset = llvm::ConstantInt::get(CGM.SizeTy, Subscript.Offset);
+      EmitArraySubscriptCheck(Builder.CreateAdd(Builder.CreateMul(Init, Coefficient),
+                                                Offset),
+                              EV.getDimensions()[I], I);
+      EmitArraySubscriptCheck(Builder.CreateAdd(Builder.CreateMul(End, Coefficient),
+                                                Offset),
+                              EV.getDimensions()[I], I);
+      CheckedSubscripts.insert(Subscripts[I]);
+    }
+  }
+  if(EndBlock)
+    EmitBlock(EndBlock);
+}
+
+bool CodeGenFunction::EmitDoStmtAsIdiom(const DoStmt *S) {
+  LoopIdiomEmitter Emitter(*this);
+  return Emitter.Emit(S);
+}
+
+bool CodeGenFunction::EmitDoStmtAsReorderedNest(const DoStmt *S) {
+  LoopNestEmitter Emitter(*this, InnerReportedLoops);
+  return Emitter.Emit(S);
+}
+
+}
+} // end namespace flang
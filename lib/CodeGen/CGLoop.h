@@ -0,0 +1,96 @@
+//===--- CGLoop.h - Analysis of DO loops for LLVM CodeGen -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This contains the helpers which are used to analyze DO loops and their
+// array accesses before the loops are emitted.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FLANG_CODEGEN_CGLOOP_H
+#define FLANG_CODEGEN_CGLOOP_H
+
+#include "flang/AST/Decl.h"
+#include "flang/AST/Expr.h"
+#include "flang/AST/Stmt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace flang {
+class ASTContext;
+
+namespace CodeGen {
+
+/// AffineSubscript - an integer expression of the form
+/// Coefficient * Var + Offset. The variable is null when the
+/// expression is a constant.
+class AffineSubscript {
+public:
+  const VarDecl *Var;
+  int64_t Coefficient;
+  int64_t Offset;
+
+  AffineSubscript()
+    : Var(nullptr), Coefficient(0), Offset(0) {}
+  AffineSubscript(int64_t Value)
+    : Var(nullptr), Coefficient(0), Offset(Value) {}
+  AffineSubscript(const VarDecl *V, int64_t Coeff, int64_t Off)
+    : Var(V), Coefficient(Coeff), Offset(Off) {}
+
+  bool isConstant() const {
+    return Var == nullptr;
+  }
+
+  /// \brief Returns true if this subscript is 'V + Offset'.
+  bool isUnitStride(const VarDecl *V) const {
+    return Var == V && Coefficient == 1;
+  }
+
+  bool operator==(const AffineSubscript &Other) const {
+    return Var == Other.Var && Coefficient == Other.Coefficient &&
+           Offset == Other.Offset;
+  }
+};
+
+/// \brief Matches the given integer expression to the affine form.
+/// Returns false if the expression isn't an affine function of
+/// at most one scalar variable.
+bool MatchAffineSubscript(const ASTContext &C, const Expr *E,
+                          AffineSubscript &Result);
+
+/// \brief Matches all the subscripts of the given array element.
+bool MatchAffineSubscripts(const ASTContext &C, const ArrayElementExpr *E,
+                           SmallVectorImpl<AffineSubscript> &Result);
+
+/// \brief Returns the variable which is accessed by the given
+/// array element, or null if the target isn't a variable.
+const VarDecl *GetArrayElementVar(const ArrayElementExpr *E);
+
+/// \brief Collects the statements of the given loop body, skipping the
+/// END DO and CONTINUE statements. Returns false if a statement in
+/// the body is a branch target.
+bool GetLoopBodyStatements(const Stmt *Body,
+                           SmallVectorImpl<const Stmt*> &Result);
+
+/// \brief Returns the loop variable if the given DO loop is an integer
+/// loop with a unit increment, or null otherwise.
+const VarDecl *GetUnitStrideLoopVar(const ASTContext &C, const DoStmt *S);
+
+/// \brief Returns true if the given scalar expression has the same value
+/// during every iteration of a loop over the given variables, i.e. it
+/// only consists of constants and scalar variables other than those.
+bool IsLoopInvariantExpr(const Expr *E, ArrayRef<const VarDecl*> LoopVars);
+
+/// \brief Returns true if the storage of the given variable can't
+/// be shared with any other variable through EQUIVALENCE.
+bool HasIndependentStorage(const VarDecl *VD);
+
+}
+}  // end namespace flang
+
+#endif
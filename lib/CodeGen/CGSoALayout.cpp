@@ -0,0 +1,270 @@
+//===--- CGSoALayout.cpp - Struct of arrays layout for derived types ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This contains code to find the local arrays of derived type which are
+// stored with one array per component (-fsoa-derived-types).
+//
+// An array can only be stored this way when every reference to it selects
+// a component, i.e. a%x, a(i)%x or a(1:n)%x, as the elements of such an
+// array don't exist in memory.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CodeGenFunction.h"
+#include "CodeGenModule.h"
+#include "flang/AST/Decl.h"
+#include "flang/AST/ExprVisitor.h"
+#include "flang/AST/StmtVisitor.h"
+#include "flang/AST/StorageSet.h"
+
+namespace flang {
+namespace CodeGen {
+
+/// SoAUseChecker - Removes the candidate arrays which are referenced
+/// without the selection of a component. An unknown expression or statement
+/// removes all of the candidates.
+class SoAUseChecker : public ConstExprVisitor<SoAUseChecker>,
+                      public ConstStmtVisitor<SoAUseChecker> {
+  llvm::SmallPtrSet<const VarDecl*, 4> &Candidates;
+
+  /// IsComponentTarget - Returns true if the given expression is a
+  /// candidate array, or an element or a section of it.
+  bool IsComponentTarget(const Expr *E) {
+    if(auto Element = dyn_cast<ArrayElementExpr>(E)) {
+      Visit(Element->getSubscripts());
+      E = Element->getTarget();
+    } else if(auto Section = dyn_cast<ArraySectionExpr>(E)) {
+      Visit(Section->getSubscripts());
+      E = Section->getTarget();
+    }
+    if(auto Var = dyn_cast<VarExpr>(E))
+      return Candidates.count(Var->getVarDecl()) != 0;
+    return false;
+  }
+
+public:
+  SoAUseChecker(llvm::SmallPtrSet<const VarDecl*, 4> &Vars)
+    : Candidates(Vars) {}
+
+  using ConstExprVisitor<SoAUseChecker>::Visit;
+  using ConstStmtVisitor<SoAUseChecker>::Visit;
+
+  void Visit(ArrayRef<Expr*> Exprs) {
+    for(auto E : Exprs)
+      Visit(E);
+  }
+  void VisitOrNull(const Expr *E) {
+    if(E) Visit(E);
+  }
+  void VisitOrNull(const Stmt *S) {
+    if(S) Visit(S);
+  }
+
+  // expressions
+
+  void VisitExpr(const Expr *E) {
+    Candidates.clear();
+  }
+  void VisitConstantExpr(const ConstantExpr *E) {}
+  void VisitRepeatedConstantExpr(const RepeatedConstantExpr *E) {}
+  void VisitFunctionRefExpr(const FunctionRefExpr *E) {}
+  void VisitVarExpr(const VarExpr *E) {
+    Candidates.erase(E->getVarDecl());
+  }
+  void VisitUnaryExpr(const UnaryExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitBinaryExpr(const BinaryExpr *E) {
+    Visit(E->getLHS());
+    Visit(E->getRHS());
+  }
+  void VisitImplicitCastExpr(const ImplicitCastExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitMemberExpr(const MemberExpr *E) {
+    if(!IsComponentTarget(E->getTarget()))
+      Visit(E->getTarget());
+  }
+  void VisitSubstringExpr(const SubstringExpr *E) {
+    Visit(E->getTarget());
+    VisitOrNull(E->getStartingPoint());
+    VisitOrNull(E->getEndPoint());
+  }
+  void VisitArrayElementExpr(const ArrayElementExpr *E) {
+    Visit(E->getTarget());
+    Visit(E->getSubscripts());
+  }
+  void VisitArraySectionExpr(const ArraySectionExpr *E) {
+    Visit(E->getTarget());
+    Visit(E->getSubscripts());
+  }
+  void VisitImplicitArrayOperationExpr(const ImplicitArrayOperationExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitCallExpr(const CallExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitImpliedDoExpr(const ImpliedDoExpr *E) {
+    Visit(E->getBody());
+    Visit(E->getInitialParameter());
+    Visit(E->getTerminalParameter());
+    VisitOrNull(E->getIncrementationParameter());
+  }
+  void VisitArrayConstructorExpr(const ArrayConstructorExpr *E) {
+    Visit(E->getItems());
+  }
+  void VisitTypeConstructorExpr(const TypeConstructorExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitRangeExpr(const RangeExpr *E) {
+    VisitOrNull(E->getFirstExpr());
+    VisitOrNull(E->getSecondExpr());
+  }
+  void VisitStridedRangeExpr(const StridedRangeExpr *E) {
+    VisitRangeExpr(E);
+    VisitOrNull(E->getStride());
+  }
+
+  // statements
+
+  void VisitStmt(const Stmt *S) {
+    Candidates.clear();
+  }
+  void VisitConstructPartStmt(const ConstructPartStmt *S) {}
+  void VisitDeclStmt(const DeclStmt *S) {}
+  void VisitFormatStmt(const FormatStmt *S) {}
+  void VisitContinueStmt(const ContinueStmt *S) {}
+  void VisitCycleStmt(const CycleStmt *S) {}
+  void VisitExitStmt(const ExitStmt *S) {}
+  void VisitGotoStmt(const GotoStmt *S) {}
+  void VisitCompoundStmt(const CompoundStmt *S) {
+    for(auto I : S->getBody())
+      Visit(I);
+  }
+  void VisitBlockStmt(const BlockStmt *S) {
+    for(auto I : S->getStatements())
+      Visit(I);
+  }
+  void VisitAssignStmt(const AssignStmt *S) {
+    Visit(S->getDestination());
+  }
+  void VisitAssignedGotoStmt(const AssignedGotoStmt *S) {
+    Visit(S->getDestination());
+  }
+  void VisitComputedGotoStmt(const ComputedGotoStmt *S) {
+    Visit(S->getExpression());
+  }
+  void VisitIfStmt(const IfStmt *S) {
+    Visit(S->getCondition());
+    VisitOrNull(S->getThenStmt());
+    VisitOrNull(S->getElseStmt());
+  }
+  void VisitDoStmt(const DoStmt *S) {
+    Visit(S->getDoVar());
+    Visit(S->getInitialParameter());
+    Visit(S->getTerminalParameter());
+    VisitOrNull(S->getIncrementationParameter());
+    VisitOrNull(S->getBody());
+  }
+  void VisitDoWhileStmt(const DoWhileStmt *S) {
+    Visit(S->getCondition());
+    VisitOrNull(S->getBody());
+  }
+  void VisitSelectCaseStmt(const SelectCaseStmt *S) {
+    Visit(S->getOperand());
+    for(auto Case = S->getFirstCase(); Case; Case = Case->getNextCase()) {
+      Visit(Case->getValues());
+      VisitOrNull(Case->getBody());
+    }
+    if(S->hasDefaultCase())
+      VisitOrNull(S->getDefaultCase()->getBody());
+  }
+  void VisitWhereStmt(const WhereStmt *S) {
+    Visit(S->getMask());
+    VisitOrNull(S->getThenStmt());
+    VisitOrNull(S->getElseStmt());
+  }
+  void VisitStopStmt(const StopStmt *S) {
+    VisitOrNull(S->getStopCode());
+  }
+  void VisitReturnStmt(const ReturnStmt *S) {
+    VisitOrNull(S->getE());
+  }
+  void VisitCallStmt(const CallStmt *S) {
+    Visit(S->getArguments());
+  }
+  void VisitAssignmentStmt(const AssignmentStmt *S) {
+    Visit(S->getLHS());
+    Visit(S->getRHS());
+  }
+  void VisitPrintStmt(const PrintStmt *S) {
+    Visit(S->getOutputList());
+  }
+  void VisitWriteStmt(const WriteStmt *S) {
+    Visit(S->getOutputList());
+  }
+};
+
+/// IsSoACandidate - Returns true if the given variable is a fixed size
+/// local array of a derived type from -fsoa-derived-types.
+static bool IsSoACandidate(CodeGenFunction &CGF, const VarDecl *VD) {
+  if(!VD->isLocalVariable() || VD->hasStorageSet() || VD->hasInit() ||
+     VD->isThreadPrivate())
+    return false;
+  auto Type = VD->getType();
+  if(Type.hasAttributeSpec(Qualifiers::AS_save))
+    return false;
+  auto ATy = Type->asArrayType();
+  if(!ATy)
+    return false;
+  auto RTy = ATy->getElementType()->asRecordType();
+  uint64_t Size;
+  return RTy && CGF.getTypes().isSoARecordType(RTy) &&
+         ATy->EvaluateSize(Size, CGF.getContext());
+}
+
+void CodeGenFunction::FindSoAVariables(const DeclContext *DC, const Stmt *S) {
+  if(CGM.getCodeGenOpts().SoADerivedTypes.empty())
+    return;
+
+  llvm::SmallPtrSet<const VarDecl*, 4> Candidates;
+  for(auto I = DC->decls_begin(), End = DC->decls_end(); I != End; ++I) {
+    // The internal and statement functions can use the arrays of
+    // the host, so the arrays are left alone.
+    if(isa<FunctionDecl>(*I))
+      return;
+    if(auto VD = dyn_cast<VarDecl>(*I)) {
+      if(IsSoACandidate(*this, VD))
+        Candidates.insert(VD);
+    }
+  }
+  if(Candidates.empty() || !S)
+    return;
+
+  SoAUseChecker Checker(Candidates);
+  Checker.Visit(S);
+  for(auto VD : Candidates)
+    SoAVariables.insert(VD);
+}
+
+bool CodeGenFunction::IsSoAArrayExpr(const Expr *E) const {
+  if(SoAVariables.empty())
+    return false;
+  if(auto Section = dyn_cast<ArraySectionExpr>(E))
+    E = Section->getTarget();
+  if(auto Var = dyn_cast<VarExpr>(E))
+    return SoAVariables.count(Var->getVarDecl()) != 0;
+  return false;
+}
+
+}
+} // end namespace flang
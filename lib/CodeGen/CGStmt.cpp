@@ -257,6 +257,13 @@ public:
 };
 
 void CodeGenFunction::EmitDoStmt(const DoStmt *S) {
+  if(CGM.getCodeGenOpts().BoundsCheck)
+    EmitLoopSubscriptChecks(S);
+  if(CGM.getCodeGenOpts().LoopIdiomRecognize && EmitDoStmtAsIdiom(S))
+    return;
+  if(CGM.getCodeGenOpts().LoopInterchange && EmitDoStmtAsReorderedNest(S))
+    return;
+
   // Init
   auto VarPtr = GetVarPtr(cast<VarExpr>(S->getDoVar())->getVarDecl());
   auto InitValue = EmitScalarExpr(S->getInitialParameter());
@@ -32,6 +32,18 @@ void CGLibflangSystemRuntime::EmitInit(CodeGenFunction &CGF) {
   auto Func = CGM.GetRuntimeFunction("sys_init", ArrayRef<CGType>());
   CallArgList ArgList;
   CGF.EmitCall(Func.getFunction(), Func.getInfo(), ArgList);
+
+  // Configure the floating point environment (i.e. MXCSR on x86)
+  // before any user code runs.
+  auto &Opts = CGM.getCodeGenOpts();
+  if(Opts.getFPDenormalMode() == CodeGenOptions::FPD_IEEE &&
+     !Opts.FPExceptionTraps)
+    return;
+  auto FPEnvFunc = CGM.GetRuntimeFunction2("sys_fpenv", CGM.Int32Ty,
+                                           CGM.Int32Ty);
+  CGF.EmitCall2(FPEnvFunc,
+                CGF.getBuilder().getInt32(Opts.getFPDenormalMode()),
+                CGF.getBuilder().getInt32(Opts.FPExceptionTraps));
 }
 
 llvm::Value *CGLibflangSystemRuntime::EmitMalloc(CodeGenFunction &CGF, llvm::Value *Size) {
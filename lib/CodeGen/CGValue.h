@@ -76,16 +76,23 @@ public:
   ArrayRef<ArrayDimensionValueTy> Dimensions;
   llvm::Value *Ptr;
   llvm::Value *Offset;
+  /// Components - the indices of the derived type components which
+  /// are selected from every element, i.e. a%b%c.
+  ArrayRef<unsigned> Components;
 
   ArrayValueRef(ArrayRef<ArrayDimensionValueTy> Dims,
                llvm::Value *P,
-               llvm::Value *offset = nullptr)
+               llvm::Value *offset = nullptr,
+               ArrayRef<unsigned> components = ArrayRef<unsigned>())
     : Dimensions(Dims), Ptr(P),
-      Offset(offset) {}
+      Offset(offset), Components(components) {}
 
   bool hasOffset() const {
     return Offset != nullptr;
   }
+  bool hasComponents() const {
+    return !Components.empty();
+  }
 };
 
 /// ArrayVectorValueTy - this is a one dimensional
@@ -0,0 +1,431 @@
+//===--- CGWholeProgram.cpp - Whole program procedure specialization ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This contains code to find the procedures which can be specialized when
+// the translation unit is the whole program (-fwhole-program).
+//
+// A procedure which is only called directly from this translation unit gets
+// internal linkage, and its integer, real and complex scalar arguments which
+// are never modified or passed on to another procedure are passed by value
+// instead of by reference.
+//
+// An internal procedure whose explicit shape arrays have bounds that depend
+// on such arguments is cloned for the call sites which pass constants for
+// them, so that the array strides are constants in the clone. The call sites
+// in the innermost loops are cloned first, until the clone size budget is
+// exhausted.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CodeGenModule.h"
+#include "flang/AST/Decl.h"
+#include "flang/AST/ExprVisitor.h"
+#include "flang/AST/StmtVisitor.h"
+#include "llvm/ADT/StringSet.h"
+#include <algorithm>
+
+namespace flang {
+namespace CodeGen {
+
+/// The maximum number of clones of one procedure.
+static const unsigned MaxClonesPerFunction = 4;
+
+/// The maximum number of statements in all of the clones.
+static const unsigned CloneStmtBudget = 512;
+
+/// WholeProgramCall - A direct call to a procedure.
+struct WholeProgramCall {
+  const FunctionDecl *Function;
+  ArrayRef<Expr*> Arguments;
+  unsigned LoopDepth;
+};
+
+/// ArgumentUseChecker - Removes the candidate arguments which are modified
+/// or passed by reference, and collects the names of the procedures which
+/// are called through an external declaration or used as an actual
+/// argument. An unknown expression or statement fails the analysis.
+class ArgumentUseChecker : public ConstExprVisitor<ArgumentUseChecker>,
+                           public ConstStmtVisitor<ArgumentUseChecker> {
+  llvm::SmallPtrSet<const VarDecl*, 16> &Candidates;
+  llvm::StringSet<> &ExternalNames;
+  SmallVectorImpl<WholeProgramCall> &Calls;
+  unsigned LoopDepth;
+  unsigned NumStmts;
+  bool Failed;
+
+  /// VisitDefinition - Visits an expression which is assigned to.
+  void VisitDefinition(const Expr *E) {
+    if(auto Var = dyn_cast<VarExpr>(E))
+      Candidates.erase(Var->getVarDecl());
+    else Visit(E);
+  }
+
+  /// VisitCallArguments - Visits the actual arguments of a procedure
+  /// which receives its arguments by reference.
+  void VisitCallArguments(const FunctionDecl *Function,
+                          ArrayRef<Expr*> Arguments) {
+    if(Function->isExternal() && !Function->isExternalArgument())
+      ExternalNames.insert(Function->getName());
+    else if(!Function->isExternal() && !Function->isStatementFunction()) {
+      WholeProgramCall Call = { Function, Arguments, LoopDepth };
+      Calls.push_back(Call);
+    }
+    if(Function->isStatementFunction()) {
+      Visit(Arguments);
+      return;
+    }
+    for(auto E : Arguments)
+      VisitDefinition(E);
+  }
+
+public:
+  ArgumentUseChecker(llvm::SmallPtrSet<const VarDecl*, 16> &Args,
+                     llvm::StringSet<> &Names,
+                     SmallVectorImpl<WholeProgramCall> &CallList)
+    : Candidates(Args), ExternalNames(Names), Calls(CallList),
+      LoopDepth(0), NumStmts(0), Failed(false) {}
+
+  bool hasFailed() const { return Failed; }
+
+  /// getNumStmts - Returns the number of the statements which were visited.
+  unsigned getNumStmts() const { return NumStmts; }
+
+  using ConstExprVisitor<ArgumentUseChecker>::Visit;
+  using ConstStmtVisitor<ArgumentUseChecker>::Visit;
+
+  void Visit(ArrayRef<Expr*> Exprs) {
+    for(auto E : Exprs)
+      Visit(E);
+  }
+  void VisitOrNull(const Expr *E) {
+    if(E) Visit(E);
+  }
+  void VisitOrNull(const Stmt *S) {
+    if(S) Visit(S);
+  }
+
+  // expressions
+
+  void VisitExpr(const Expr *E) {
+    Failed = true;
+  }
+  void VisitConstantExpr(const ConstantExpr *E) {}
+  void VisitRepeatedConstantExpr(const RepeatedConstantExpr *E) {}
+  void VisitFunctionRefExpr(const FunctionRefExpr *E) {
+    ExternalNames.insert(E->getFunctionDecl()->getName());
+  }
+  void VisitVarExpr(const VarExpr *E) {}
+  void VisitUnaryExpr(const UnaryExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitBinaryExpr(const BinaryExpr *E) {
+    Visit(E->getLHS());
+    Visit(E->getRHS());
+  }
+  void VisitImplicitCastExpr(const ImplicitCastExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitMemberExpr(const MemberExpr *E) {
+    Visit(E->getTarget());
+  }
+  void VisitSubstringExpr(const SubstringExpr *E) {
+    Visit(E->getTarget());
+    VisitOrNull(E->getStartingPoint());
+    VisitOrNull(E->getEndPoint());
+  }
+  void VisitArrayElementExpr(const ArrayElementExpr *E) {
+    Visit(E->getTarget());
+    Visit(E->getSubscripts());
+  }
+  void VisitArraySectionExpr(const ArraySectionExpr *E) {
+    Visit(E->getTarget());
+    Visit(E->getSubscripts());
+  }
+  void VisitImplicitArrayOperationExpr(const ImplicitArrayOperationExpr *E) {
+    Visit(E->getExpression());
+  }
+  void VisitCallExpr(const CallExpr *E) {
+    VisitCallArguments(E->getFunction(), E->getArguments());
+  }
+  void VisitIntrinsicCallExpr(const IntrinsicCallExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitImpliedDoExpr(const ImpliedDoExpr *E) {
+    Candidates.erase(E->getVarDecl());
+    Visit(E->getBody());
+    Visit(E->getInitialParameter());
+    Visit(E->getTerminalParameter());
+    VisitOrNull(E->getIncrementationParameter());
+  }
+  void VisitArrayConstructorExpr(const ArrayConstructorExpr *E) {
+    Visit(E->getItems());
+  }
+  void VisitTypeConstructorExpr(const TypeConstructorExpr *E) {
+    Visit(E->getArguments());
+  }
+  void VisitRangeExpr(const RangeExpr *E) {
+    VisitOrNull(E->getFirstExpr());
+    VisitOrNull(E->getSecondExpr());
+  }
+  void VisitStridedRangeExpr(const StridedRangeExpr *E) {
+    VisitRangeExpr(E);
+    VisitOrNull(E->getStride());
+  }
+
+  // statements
+
+  void VisitStmt(const Stmt *S) {
+    Failed = true;
+  }
+  void VisitConstructPartStmt(const ConstructPartStmt *S) {}
+  void VisitDeclStmt(const DeclStmt *S) {}
+  void VisitFormatStmt(const FormatStmt *S) {}
+  void VisitContinueStmt(const ContinueStmt *S) {}
+  void VisitCycleStmt(const CycleStmt *S) {}
+  void VisitExitStmt(const ExitStmt *S) {}
+  void VisitGotoStmt(const GotoStmt *S) {}
+  void VisitCompoundStmt(const CompoundStmt *S) {
+    NumStmts += S->getBody().size();
+    for(auto I : S->getBody())
+      Visit(I);
+  }
+  void VisitBlockStmt(const BlockStmt *S) {
+    NumStmts += S->getStatements().size();
+    for(auto I : S->getStatements())
+      Visit(I);
+  }
+  void VisitAssignStmt(const AssignStmt *S) {
+    VisitDefinition(S->getDestination());
+  }
+  void VisitAssignedGotoStmt(const AssignedGotoStmt *S) {
+    Visit(S->getDestination());
+  }
+  void VisitComputedGotoStmt(const ComputedGotoStmt *S) {
+    Visit(S->getExpression());
+  }
+  void VisitIfStmt(const IfStmt *S) {
+    Visit(S->getCondition());
+    VisitOrNull(S->getThenStmt());
+    VisitOrNull(S->getElseStmt());
+  }
+  void VisitDoStmt(const DoStmt *S) {
+    VisitDefinition(S->getDoVar());
+    Visit(S->getInitialParameter());
+    Visit(S->getTerminalParameter());
+    VisitOrNull(S->getIncrementationParameter());
+    ++LoopDepth;
+    VisitOrNull(S->getBody());
+    --LoopDepth;
+  }
+  void VisitDoWhileStmt(const DoWhileStmt *S) {
+    Visit(S->getCondition());
+    ++LoopDepth;
+    VisitOrNull(S->getBody());
+    --LoopDepth;
+  }
+  void VisitSelectCaseStmt(const SelectCaseStmt *S) {
+    Visit(S->getOperand());
+    for(auto Case = S->getFirstCase(); Case; Case = Case->getNextCase()) {
+      Visit(Case->getValues());
+      VisitOrNull(Case->getBody());
+    }
+    if(S->hasDefaultCase())
+      VisitOrNull(S->getDefaultCase()->getBody());
+  }
+  void VisitWhereStmt(const WhereStmt *S) {
+    Visit(S->getMask());
+    VisitOrNull(S->getThenStmt());
+    VisitOrNull(S->getElseStmt());
+  }
+  void VisitStopStmt(const StopStmt *S) {
+    VisitOrNull(S->getStopCode());
+  }
+  void VisitReturnStmt(const ReturnStmt *S) {
+    VisitOrNull(S->getE());
+  }
+  void VisitCallStmt(const CallStmt *S) {
+    VisitCallArguments(S->getFunction(), S->getArguments());
+  }
+  void VisitAssignmentStmt(const AssignmentStmt *S) {
+    VisitDefinition(S->getLHS());
+    Visit(S->getRHS());
+  }
+  void VisitPrintStmt(const PrintStmt *S) {
+    Visit(S->getOutputList());
+  }
+  void VisitWriteStmt(const WriteStmt *S) {
+    Visit(S->getOutputList());
+  }
+};
+
+/// IsSpecializableFunction - Returns true if the given procedure is defined
+/// in this translation unit and doesn't have any internal procedures which
+/// could modify its arguments.
+static bool IsSpecializableFunction(const FunctionDecl *Function) {
+  if(!(Function->isNormalFunction() || Function->isSubroutine()) ||
+     !Function->getBody())
+    return false;
+  for(auto I = Function->decls_begin(), End = Function->decls_end();
+      I != End; ++I) {
+    if(auto Internal = dyn_cast<FunctionDecl>(*I)) {
+      if(!Internal->isStatementFunction())
+        return false;
+    }
+  }
+  return true;
+}
+
+/// IsByValueCandidate - Returns true if the given argument is a scalar
+/// which can be passed in registers.
+static bool IsByValueCandidate(const VarDecl *Arg) {
+  auto Type = Arg->getType();
+  return Type->isIntegerType() || Type->isRealType() ||
+         Type->isComplexType();
+}
+
+/// CollectBoundArguments - Finds the arguments of the given procedure which
+/// are used by the given array bound.
+static void CollectBoundArguments(const FunctionDecl *Function, const Expr *E,
+                                  SmallVectorImpl<const VarDecl*> &Args) {
+  if(!E)
+    return;
+  if(auto Unary = dyn_cast<UnaryExpr>(E))
+    CollectBoundArguments(Function, Unary->getExpression(), Args);
+  else if(auto Binary = dyn_cast<BinaryExpr>(E)) {
+    CollectBoundArguments(Function, Binary->getLHS(), Args);
+    CollectBoundArguments(Function, Binary->getRHS(), Args);
+  } else if(auto Cast = dyn_cast<ImplicitCastExpr>(E))
+    CollectBoundArguments(Function, Cast->getExpression(), Args);
+  else if(auto Var = dyn_cast<VarExpr>(E)) {
+    auto VD = Var->getVarDecl();
+    if(VD->isArgument() && VD->getDeclContext() == Function &&
+       std::find(Args.begin(), Args.end(), VD) == Args.end())
+      Args.push_back(VD);
+  }
+}
+
+/// GetCloneableArguments - Finds the arguments of the given procedure
+/// which are passed by value and are used in the bounds of its explicit
+/// shape arrays.
+static void GetCloneableArguments(CodeGenModule &CGM,
+                                  const FunctionDecl *Function,
+                                  SmallVectorImpl<const VarDecl*> &Args) {
+  SmallVector<const VarDecl*, 4> BoundArgs;
+  for(auto I = Function->decls_begin(), End = Function->decls_end();
+      I != End; ++I) {
+    auto VD = dyn_cast<VarDecl>(*I);
+    if(!VD)
+      continue;
+    auto ATy = VD->getType()->asArrayType();
+    if(!ATy)
+      continue;
+    for(auto Dim : ATy->getDimensions()) {
+      if(!isa<ExplicitShapeSpec>(Dim))
+        continue;
+      CollectBoundArguments(Function, Dim->getLowerBoundOrNull(), BoundArgs);
+      CollectBoundArguments(Function, Dim->getUpperBoundOrNull(), BoundArgs);
+    }
+  }
+  for(auto Arg : BoundArgs) {
+    if(Arg->getType()->isIntegerType() && CGM.isByValueArgument(Arg))
+      Args.push_back(Arg);
+  }
+}
+
+void CodeGenModule::AnalyzeWholeProgram(const TranslationUnitDecl *TU) {
+  if(!CodeGenOpts.WholeProgram)
+    return;
+
+  SmallVector<const FunctionDecl*, 16> Functions;
+  llvm::SmallPtrSet<const VarDecl*, 16> Candidates;
+  SmallVector<const Stmt*, 16> Bodies;
+  for(auto I = TU->decls_begin(), End = TU->decls_end(); I != End; ++I) {
+    if((*I)->getDeclContext() != TU)
+      continue;
+    if(auto Program = dyn_cast<MainProgramDecl>(*I)) {
+      if(Program->getBody())
+        Bodies.push_back(Program->getBody());
+    } else if(auto Function = dyn_cast<FunctionDecl>(*I)) {
+      if(!IsSpecializableFunction(Function))
+        continue;
+      Functions.push_back(Function);
+      Bodies.push_back(Function->getBody());
+      for(auto Arg : Function->getArguments()) {
+        if(IsByValueCandidate(Arg))
+          Candidates.insert(Arg);
+      }
+    }
+  }
+
+  llvm::StringSet<> ExternalNames;
+  SmallVector<WholeProgramCall, 32> Calls;
+  llvm::DenseMap<const Stmt*, unsigned> BodySizes;
+  ArgumentUseChecker Checker(Candidates, ExternalNames, Calls);
+  for(auto Body : Bodies) {
+    auto NumStmts = Checker.getNumStmts();
+    Checker.Visit(Body);
+    BodySizes[Body] = Checker.getNumStmts() - NumStmts;
+  }
+  if(Checker.hasFailed())
+    return;
+
+  for(auto Function : Functions) {
+    if(ExternalNames.count(Function->getName()))
+      continue;
+    InternalFunctions.insert(Function);
+    for(auto Arg : Function->getArguments()) {
+      if(Candidates.count(Arg))
+        ByValueArguments.insert(Arg);
+    }
+  }
+
+  // Clone the procedures for the call sites in the innermost loops first.
+  std::stable_sort(Calls.begin(), Calls.end(),
+                   [](const WholeProgramCall &LHS, const WholeProgramCall &RHS) {
+    return LHS.LoopDepth > RHS.LoopDepth;
+  });
+  unsigned Budget = CloneStmtBudget;
+  for(auto Call : Calls) {
+    auto Function = Call.Function;
+    if(!InternalFunctions.count(Function))
+      continue;
+    auto Size = BodySizes[Function->getBody()];
+    if(Size > Budget || FindFunctionClone(Function, Call.Arguments))
+      continue;
+    SmallVector<const VarDecl*, 4> Args;
+    GetCloneableArguments(*this, Function, Args);
+    if(Args.empty())
+      continue;
+    unsigned NumClones = 0;
+    for(auto &Clone : FunctionClones) {
+      if(Clone->Function == Function)
+        ++NumClones;
+    }
+    if(NumClones >= MaxClonesPerFunction)
+      continue;
+
+    std::unique_ptr<FunctionClone> Clone(new FunctionClone(Context, Function));
+    auto FuncArgs = Function->getArguments();
+    for(size_t I = 0; I < FuncArgs.size() && I < Call.Arguments.size(); ++I) {
+      int64_t Value;
+      if(std::find(Args.begin(), Args.end(), FuncArgs[I]) == Args.end() ||
+         !Call.Arguments[I]->EvaluateAsInt(Value, Context))
+        continue;
+      Clone->Arguments.push_back(std::make_pair(FuncArgs[I], Value));
+      Clone->Scope.Assign(FuncArgs[I], Value);
+    }
+    if(Clone->Arguments.empty())
+      continue;
+    FunctionClones.push_back(std::move(Clone));
+    Budget -= Size;
+  }
+}
+
+}
+} // end namespace flang
@@ -30,11 +30,13 @@ namespace CodeGen {
 CodeGenFunction::CodeGenFunction(CodeGenModule &cgm, llvm::Function *Fn)
   : CGM(cgm), /*, Target(cgm.getTarget()),*/
     Builder(cgm.getModule().getContext()),
-    UnreachableBlock(nullptr), CurFn(Fn), IsMainProgram(false),
+    UnreachableBlock(nullptr), CurFn(Fn), ConstantArguments(nullptr),
+    IsMainProgram(false),
     ReturnValuePtr(nullptr), AllocaInsertPt(nullptr),
     AssignedGotoVarPtr(nullptr), AssignedGotoDispatchBlock(nullptr),
     CurLoopScope(nullptr), CurInlinedStmtFunc(nullptr) {
   HasSavedVariables = false;
+  HasThreadLocalSavedVariables = false;
 }
 
 CodeGenFunction::~CodeGenFunction() {
@@ -111,6 +113,21 @@ void CodeGenFunction::EmitFunctionPrologue(const FunctionDecl *Func,
   for(auto Arg : ArgsList) {
     if(Arg->getType()->isCharacterType())
       GetCharacterArg(Arg);
+    else if(CGM.isByValueArgument(Arg)) {
+      // The argument passed by value is stored in a local variable,
+      // which the optimizer promotes back to a register.
+      auto Ptr = Builder.CreateAlloca(ConvertTypeForMem(Arg->getType()),
+                                      nullptr,
+                                      llvm::Twine(Arg->getName()) + ".addr");
+      auto Value = LocalVariables[Arg];
+      if(Arg->getType()->isComplexType())
+        EmitComplexStore(Value->getType()->isVectorTy()?
+                           ExtractComplexVectorValue(Value) :
+                           ExtractComplexValue(Value), Ptr);
+      else
+        Builder.CreateStore(Value, Ptr);
+      LocalVariables[Arg] = Ptr;
+    }
   }
 
   // Create return value and lbock
@@ -123,27 +140,39 @@ void CodeGenFunction::EmitFunctionPrologue(const FunctionDecl *Func,
 }
 
 void CodeGenFunction::EmitFunctionBody(const DeclContext *DC, const Stmt *S) {
+  FindSoAVariables(DC, S);
   EmitFunctionDecls(DC);
   auto BodyBB = createBasicBlock("body");
   AllocaInsertPt = Builder.CreateBr(BodyBB);
   EmitBlock(BodyBB);
   if(HasSavedVariables)
     EmitFirstInvocationBlock(DC, S);
+  if(HasThreadLocalSavedVariables)
+    EmitFirstInvocationBlock(DC, S, true);
   EmitVarInitializers(DC);
   if(S)
     EmitStmt(S);
 }
 
+/// EmitFirstInvocationBlock - Emits the initializers of the saved
+/// variables which are executed only during the first invocation of
+/// the function. The thread local variables use a thread local flag
+/// instead, so that every thread initializes its own copy.
 void CodeGenFunction::EmitFirstInvocationBlock(const DeclContext *DC,
-                                               const Stmt *S) {
-  auto GlobalFirstInvocationFlag = CGM.EmitGlobalVariable(CurFn->getName(), "FIRST_INVOCATION",
+                                               const Stmt *S,
+                                               bool ThreadLocal) {
+  auto GlobalFirstInvocationFlag = CGM.EmitGlobalVariable(CurFn->getName(),
+                                                          ThreadLocal? "FIRST_THREAD_INVOCATION" :
+                                                                       "FIRST_INVOCATION",
                                                           CGM.Int1Ty, Builder.getTrue());
+  if(ThreadLocal)
+    CGM.SetThreadLocal(GlobalFirstInvocationFlag);
   auto FirstInvocationBB = createBasicBlock("first-invocation");
   auto EndBB = createBasicBlock("first-invocation-end");
   Builder.CreateCondBr(Builder.CreateLoad(GlobalFirstInvocationFlag), FirstInvocationBB,
                        EndBB);
   EmitBlock(FirstInvocationBB);
-  EmitSavedVarInitializers(DC);
+  EmitSavedVarInitializers(DC, ThreadLocal);
   Builder.CreateStore(Builder.getFalse(), GlobalFirstInvocationFlag);
   EmitBlock(EndBB);
 }
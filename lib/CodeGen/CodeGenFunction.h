@@ -24,6 +24,7 @@
 #include "flang/Frontend/CodeGenOptions.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/IR/ValueHandle.h"
@@ -103,6 +104,7 @@ class CodeGenFunction {
   llvm::Instruction *AllocaInsertPt;
 
   bool HasSavedVariables;
+  bool HasThreadLocalSavedVariables;
 
   llvm::DenseMap<const Stmt*, llvm::BasicBlock*> GotoTargets;
   llvm::SmallVector<const Stmt*, 8> AssignedGotoTargets;
@@ -111,6 +113,23 @@ class CodeGenFunction {
 
   llvm::SmallVector<llvm::Value*, 8> TempHeapAllocations;
 
+  /// CheckedSubscripts - the array subscripts whose bounds
+  /// checks were hoisted out of the DO loop that contains them.
+  llvm::SmallPtrSet<const Expr*, 16> CheckedSubscripts;
+
+  /// InnerReportedLoops - the inner loops of the DO loop nests which were
+  /// reported as impossible to reorder, so that their subnests aren't
+  /// reported again.
+  llvm::SmallPtrSet<const DoStmt*, 4> InnerReportedLoops;
+
+  /// SoAVariables - the local arrays of derived type which are stored
+  /// with one array per component.
+  llvm::SmallPtrSet<const VarDecl*, 4> SoAVariables;
+
+  /// ConstantArguments - the values of the arguments which are replaced
+  /// by constants in a clone of a procedure.
+  const ExprEvalScope *ConstantArguments;
+
   bool IsMainProgram;
 
 protected:
@@ -153,6 +172,13 @@ public:
     return CurFn;
   }
 
+  const ExprEvalScope *getConstantArguments() const {
+    return ConstantArguments;
+  }
+  void setConstantArguments(const ExprEvalScope *Scope) {
+    ConstantArguments = Scope;
+  }
+
   llvm::Type *ConvertTypeForMem(QualType T) const;
   llvm::Type *ConvertType(QualType T) const;
 
@@ -202,14 +228,38 @@ public:
   void EmitFunctionBody(const DeclContext *DC, const Stmt *S);
   void EmitFunctionEpilogue(const FunctionDecl *Func,
                             const CGFunctionInfo *Info);
+  /// EmitCoercedLoad - Loads a value of the type which the ABI uses for
+  /// the given record. Goes through a temporary when the type is larger
+  /// than the record.
+  llvm::Value *EmitCoercedLoad(llvm::Value *Ptr, llvm::Type *RecordTy,
+                               llvm::Type *Ty);
+
+  /// EmitCoercedStore - Stores a value of the type which the ABI uses for
+  /// the given record into the record.
+  void EmitCoercedStore(llvm::Value *Value, llvm::Value *Ptr,
+                        llvm::Type *RecordTy, bool IsVolatile = false);
+
   void EmitAggregateReturn(const CGFunctionInfo::RetInfo &Info, llvm::Value *Ptr);
+  void EmitAggregateReturnValueStore(const CGFunctionInfo::RetInfo &Info,
+                                     llvm::Value *Value, llvm::Value *Ptr,
+                                     bool IsVolatile = false);
   void EmitCleanup();
 
   void EmitVarDecl(const VarDecl *D);
+
+  /// FindSoAVariables - Finds the local arrays of the derived types from
+  /// -fsoa-derived-types which can be stored with one array per component,
+  /// i.e. the arrays which are only used to access their components.
+  void FindSoAVariables(const DeclContext *DC, const Stmt *S);
+
+  /// IsSoAArrayExpr - Returns true if the given expression is an array,
+  /// or a section of an array, which is stored with one array per component.
+  bool IsSoAArrayExpr(const Expr *E) const;
   void EmitVarInitializers(const DeclContext *DC);
-  void EmitSavedVarInitializers(const DeclContext *DC);
+  void EmitSavedVarInitializers(const DeclContext *DC, bool ThreadLocal = false);
   void EmitVarInitializer(const VarDecl *D);
-  void EmitFirstInvocationBlock(const DeclContext *DC, const Stmt *S);
+  void EmitFirstInvocationBlock(const DeclContext *DC, const Stmt *S,
+                                bool ThreadLocal = false);
 
   std::pair<int64_t, int64_t> GetObjectBounds(const VarDecl *Var, const Expr *E);
   EquivSet EmitEquivalenceSet(const EquivalenceSet *S);
@@ -256,6 +306,16 @@ public:
   void EmitComputedGotoStmt(const ComputedGotoStmt *S);
   void EmitIfStmt(const IfStmt *S);
   void EmitDoStmt(const DoStmt *S);
+
+  /// EmitDoStmtAsIdiom - Emits the given DO loop as a memory
+  /// intrinsic or a vectorizable loop if it implements a common array
+  /// operation. Returns false if the loop wasn't recognized.
+  bool EmitDoStmtAsIdiom(const DoStmt *S);
+
+  /// EmitDoStmtAsReorderedNest - Emits the given perfect DO loop nest
+  /// with the loops interchanged or tiled so that the arrays are accessed
+  /// in the column major order. Returns false if the nest wasn't changed.
+  bool EmitDoStmtAsReorderedNest(const DoStmt *S);
   void EmitDoWhileStmt(const DoWhileStmt *S);
   void EmitCycleStmt(const CycleStmt *S);
   void EmitExitStmt(const ExitStmt *S);
@@ -365,7 +425,12 @@ public:
   // aggregate expressions
 
   RValueTy EmitAggregateExpr(const Expr *E);
+  void EmitAggregateExpr(const Expr *E, LValueTy Dest);
   void EmitAggregateAssignment(const Expr *LHS, const Expr *RHS);
+  void EmitAggregateCopy(LValueTy Dest, RValueTy Src);
+  void EmitAggregateCopy(llvm::Value *Dest, llvm::Value *Src,
+                         llvm::StructType *T,
+                         bool IsDestVolatile, bool IsSrcVolatile);
   llvm::Value *EmitAggregateMember(llvm::Value *Agg, const FieldDecl *Field);
   RValueTy EmitAggregateMember(const Expr *E, const FieldDecl *Field);
 
@@ -454,9 +519,18 @@ public:
   bool IsInlinedArgument(const VarDecl *VD);
   RValueTy GetInlinedArgumentValue(const VarDecl *VD);
 
+  /// EmitInlinedCall - Emits the body of a small procedure in place
+  /// of a call to it (-finline-small-procedures).
+  RValueTy EmitInlinedCall(const FunctionDecl *Function,
+                           ArrayRef<Expr*> Arguments);
+
   // arrays
+  /// \brief Returns the pointer to the element of the given array. If
+  /// SoAComponent is given, the array is stored with one array per component
+  /// and the pointer to the given component of the element is returned.
   llvm::Value *EmitArrayElementPtr(const Expr *Target,
-                                   const ArrayRef<Expr*> Subscripts);
+                                   const ArrayRef<Expr*> Subscripts,
+                                   const FieldDecl *SoAComponent = nullptr);
   llvm::Value *EmitArrayElementPtr(const ArrayElementExpr *E) {
     return EmitArrayElementPtr(E->getTarget(), E->getSubscripts());
   }
@@ -476,6 +550,27 @@ public:
   llvm::Value *EmitArrayElementPtr(ArrayRef<llvm::Value*> Subscripts,
                                    const ArrayValueRef &Value);
 
+  /// \brief Returns the pointer to the element at the given offset, or
+  /// to its selected components.
+  llvm::Value *EmitArrayValueElementPtr(llvm::Value *Offset,
+                                        const ArrayValueRef &Value);
+
+  /// EmitArraySubscriptCheck - Emits the check which reports an error
+  /// when the subscript is outside of the bounds of the given dimension.
+  void EmitArraySubscriptCheck(llvm::Value *Subscript,
+                               const ArrayDimensionValueTy &Dim, int I);
+
+  /// EmitArraySectionCheck - Emits the bounds check for the given
+  /// range section, which is only done when the section isn't empty.
+  void EmitArraySectionCheck(const ArrayDimensionValueTy &Dim,
+                             llvm::Value *LB, llvm::Value *UB,
+                             llvm::Value *Stride, int I);
+
+  /// EmitLoopSubscriptChecks - Emits the bounds checks for the subscripts
+  /// which are affine functions of the DO variable before the loop, so
+  /// that they aren't done in every iteration.
+  void EmitLoopSubscriptChecks(const DoStmt *S);
+
   /// EmitSectionSize - Emits the number of elements in a single
   /// section in the given given array.
   llvm::Value *EmitSectionSize(const ArrayValueRef &Value, int I);
@@ -496,7 +591,9 @@ public:
 
   void GetArrayDimensionsInfo(QualType T, SmallVectorImpl<ArrayDimensionValueTy> &Dims);
 
-  llvm::Value *EmitArrayArgumentPointerValueABI(const Expr *E);
+  llvm::Value *EmitArrayArgumentPointerValueABI(const Expr *E,
+                                                CallArgList *Args = nullptr);
+  void EmitArrayCopyBack(const Expr *E, llvm::Value *TempPtr);
   llvm::Constant *EmitConstantArrayExpr(const ArrayConstructorExpr *E);
   llvm::Value *EmitConstantArrayConstructor(const ArrayConstructorExpr *E);
   ArrayVectorValueTy EmitTempArrayConstructor(const ArrayConstructorExpr *E);
@@ -18,6 +18,7 @@
 #include "flang/AST/ASTContext.h"
 #include "flang/AST/Decl.h"
 #include "flang/AST/DeclVisitor.h"
+#include "flang/AST/Expr.h"
 #include "flang/Basic/Diagnostic.h"
 #include "flang/Frontend/CodeGenOptions.h"
 #include "llvm/ADT/APSInt.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/IR/Mangler.h"
+#include <algorithm>
 
 namespace flang {
 namespace CodeGen {
@@ -125,8 +127,11 @@ CGFunction CodeGenModule::GetFunction(const FunctionDecl *Function) {
 
   auto FunctionInfo = Types.GetFunctionType(Function);
 
+  auto Linkage = InternalFunctions.count(Function)?
+                   llvm::GlobalValue::InternalLinkage :
+                   llvm::GlobalValue::ExternalLinkage;
   auto Func = llvm::Function::Create(FunctionInfo->getFunctionType(),
-                                     llvm::GlobalValue::ExternalLinkage,
+                                     Linkage,
                                      llvm::Twine(Function->getName()) + "_",
                                      &TheModule);
 
@@ -136,6 +141,54 @@ CGFunction CodeGenModule::GetFunction(const FunctionDecl *Function) {
   return Result;
 }
 
+llvm::Function *CodeGenModule::CreateFunctionClone(const FunctionDecl *Function) {
+  auto Original = GetFunction(Function).getFunction();
+  auto Func = llvm::Function::Create(Original->getFunctionType(),
+                                     llvm::GlobalValue::InternalLinkage,
+                                     llvm::Twine(Original->getName()) + ".clone",
+                                     &TheModule);
+  Func->setCallingConv(Original->getCallingConv());
+  return Func;
+}
+
+FunctionClone *CodeGenModule::FindFunctionClone(const FunctionDecl *Function,
+                                                ArrayRef<Expr*> Arguments,
+                                                const ExprEvalScope *Scope) {
+  // Use the clone which replaces the most arguments.
+  FunctionClone *Result = nullptr;
+  auto Args = Function->getArguments();
+  for(auto &Clone : FunctionClones) {
+    if(Clone->Function != Function ||
+       (Result && Result->Arguments.size() >= Clone->Arguments.size()))
+      continue;
+    bool Matches = true;
+    for(auto Arg : Clone->Arguments) {
+      auto I = std::find(Args.begin(), Args.end(), Arg.first) - Args.begin();
+      int64_t Value;
+      if(size_t(I) >= Arguments.size() ||
+         !Arguments[I]->EvaluateAsInt(Value, Context, Scope) ||
+         Value != Arg.second) {
+        Matches = false;
+        break;
+      }
+    }
+    if(Matches)
+      Result = Clone.get();
+  }
+  return Result;
+}
+
+llvm::Function *CodeGenModule::GetFunctionClone(const FunctionDecl *Function,
+                                                ArrayRef<Expr*> Arguments,
+                                                const ExprEvalScope *Scope) {
+  auto Result = FindFunctionClone(Function, Arguments, Scope);
+  if(!Result)
+    return nullptr;
+  if(!Result->Func)
+    Result->Func = CreateFunctionClone(Function);
+  return Result->Func;
+}
+
 void CodeGenModule::EmitTopLevelDecl(const Decl *Declaration) {
   class Visitor : public ConstDeclVisitor<Visitor> {
   public:
@@ -159,6 +212,7 @@ void CodeGenModule::EmitMainProgramDecl(const MainProgramDecl *Program) {
   auto Linkage = llvm::GlobalValue::ExternalLinkage;
   auto Func = llvm::Function::Create(FType, Linkage, "main", &TheModule);
   Func->setCallingConv(llvm::CallingConv::C);
+  SetFunctionAttributes(Func);
 
   CodeGenFunction CGF(*this, Func);
   CGF.EmitMainProgramBody(Program, Program->getBody());
@@ -166,21 +220,71 @@ void CodeGenModule::EmitMainProgramDecl(const MainProgramDecl *Program) {
 
 void CodeGenModule::EmitFunctionDecl(const FunctionDecl *Function) {
   auto FuncInfo = GetFunction(Function);
+  EmitFunctionBody(Function, FuncInfo);
+
+  for(auto &Clone : FunctionClones) {
+    if(Clone->Function != Function)
+      continue;
+    if(!Clone->Func)
+      Clone->Func = CreateFunctionClone(Function);
+    EmitFunctionBody(Function, CGFunction(FuncInfo.getInfo(), Clone->Func),
+                     &Clone->Scope);
+  }
+}
+
+void CodeGenModule::EmitFunctionBody(const FunctionDecl *Function,
+                                     CGFunction FuncInfo,
+                                     const ExprEvalScope *ConstantArguments) {
+  SetFunctionAttributes(FuncInfo.getFunction());
 
   CodeGenFunction CGF(*this, FuncInfo.getFunction());
+  CGF.setConstantArguments(ConstantArguments);
   CGF.EmitFunctionArguments(Function, FuncInfo.getInfo());
   CGF.EmitFunctionPrologue(Function, FuncInfo.getInfo());
   CGF.EmitFunctionBody(Function, Function->getBody());
   CGF.EmitFunctionEpilogue(Function, FuncInfo.getInfo());
 }
 
+void CodeGenModule::SetFunctionAttributes(llvm::Function *Func) {
+  switch(CodeGenOpts.getFPDenormalMode()) {
+  case CodeGenOptions::FPD_IEEE:
+    break;
+  case CodeGenOptions::FPD_PreserveSign:
+    Func->addFnAttr("denormal-fp-math", "preserve-sign");
+    break;
+  case CodeGenOptions::FPD_PositiveZero:
+    Func->addFnAttr("denormal-fp-math", "positive-zero");
+    break;
+  }
+  // The optimizer can't speculate the operations which might trap.
+  if(CodeGenOpts.FPExceptionTraps)
+    Func->addFnAttr("no-trapping-math", "false");
+}
+
+bool CodeGenModule::IsThreadLocal(const VarDecl *Var) const {
+  return Var->isThreadPrivate() || CodeGenOpts.ThreadLocalCommon;
+}
+
+bool CodeGenModule::IsThreadLocal(const CommonBlockDecl *CB) const {
+  return CB->isThreadPrivate() || CodeGenOpts.ThreadLocalCommon;
+}
+
+void CodeGenModule::SetThreadLocal(llvm::GlobalVariable *Var) {
+  // The program units are linked into the executable, so the
+  // initial-exec model avoids the calls to __tls_get_addr.
+  Var->setThreadLocalMode(llvm::GlobalValue::InitialExecTLSModel);
+}
+
 llvm::GlobalVariable *CodeGenModule::EmitGlobalVariable(StringRef FuncName, const VarDecl *Var,
                                                         llvm::Constant *Initializer) {
   auto T = getTypes().ConvertTypeForMem(Var->getType());
-  return new llvm::GlobalVariable(TheModule, T,
-                                  false, llvm::GlobalValue::InternalLinkage,
-                                  llvm::Constant::getNullValue(T),
-                                  llvm::Twine(FuncName) + Var->getName() + "_");
+  auto GV = new llvm::GlobalVariable(TheModule, T,
+                                     false, llvm::GlobalValue::InternalLinkage,
+                                     llvm::Constant::getNullValue(T),
+                                     llvm::Twine(FuncName) + Var->getName() + "_");
+  if(IsThreadLocal(Var))
+    SetThreadLocal(GV);
+  return GV;
 }
 
 llvm::GlobalVariable *CodeGenModule::EmitGlobalVariable(StringRef FuncName, StringRef VarName,
@@ -209,14 +313,20 @@ llvm::Value *CodeGenModule::EmitCommonBlock(const CommonBlockDecl *CB,
     NameRef = "__BLNK__"; // FIXME?
 
   auto Var = TheModule.getGlobalVariable(NameRef);
-  if(Var)
+  if(Var) {
+    // THREADPRIVATE in any program unit applies to the whole block.
+    if(IsThreadLocal(CB))
+      SetThreadLocal(Var);
     return Var;
+  }
   if(!Initializer)
     Initializer = llvm::Constant::getNullValue(Type);
   auto CBVar = new llvm::GlobalVariable(TheModule, Type,
                                         false, llvm::GlobalValue::CommonLinkage,
                                         Initializer, NameRef);
   CBVar->setAlignment(16); // FIXME: proper target dependent alignment value
+  if(IsThreadLocal(CB))
+    SetThreadLocal(CBVar);
   return CBVar;
 }
 
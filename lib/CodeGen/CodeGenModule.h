@@ -16,6 +16,7 @@
 
 #include "CodeGenTypes.h"
 #include "flang/AST/Decl.h"
+#include "flang/AST/ExprConstant.h"
 #include "flang/Basic/LangOptions.h"
 #include "flang/Frontend/CodeGenOptions.h"
 #include "llvm/ADT/DenseMap.h"
@@ -26,6 +27,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/SpecialCaseList.h"
+#include <memory>
+#include <vector>
 
 namespace llvm {
   class Module;
@@ -104,6 +107,20 @@ struct CodeGenTypeCache {
   }
 };
 
+/// FunctionClone - A copy of a procedure in which some of the arguments are
+/// replaced by the constants which are passed at the call sites
+/// (-fwhole-program).
+struct FunctionClone {
+  const FunctionDecl *Function;
+  /// Arguments - the values of the replaced arguments.
+  SmallVector<std::pair<const VarDecl*, int64_t>, 2> Arguments;
+  ExprEvalScope Scope;
+  llvm::Function *Func;
+
+  FunctionClone(ASTContext &C, const FunctionDecl *F)
+    : Function(F), Scope(C), Func(nullptr) {}
+};
+
 /// CodeGenModule - This class organizes the cross-function state that is used
 /// while generating LLVM code.
 class CodeGenModule : public CodeGenTypeCache {
@@ -131,7 +148,32 @@ class CodeGenModule : public CodeGenTypeCache {
 
   llvm::DenseMap<const FunctionDecl*, CGFunction> Functions;
 
+  /// InternalFunctions - the procedures which are only called directly
+  /// from this translation unit (-fwhole-program).
+  llvm::SmallPtrSet<const FunctionDecl*, 16> InternalFunctions;
+
+  /// ByValueArguments - the scalar arguments of the internal procedures
+  /// which are never modified, and are passed by value (-fwhole-program).
+  llvm::SmallPtrSet<const VarDecl*, 16> ByValueArguments;
+
+  /// FunctionClones - the clones of the procedures which are called with
+  /// constant array dimensions (-fwhole-program).
+  std::vector<std::unique_ptr<FunctionClone>> FunctionClones;
+
+  /// InlinableFunctions - caches whether the procedures are small enough
+  /// to be inlined (-finline-small-procedures).
+  llvm::DenseMap<const FunctionDecl*, bool> InlinableFunctions;
 
+  void EmitFunctionBody(const FunctionDecl *Function, CGFunction FuncInfo,
+                        const ExprEvalScope *ConstantArguments = nullptr);
+
+  llvm::Function *CreateFunctionClone(const FunctionDecl *Function);
+
+  /// FindFunctionClone - Returns the clone of the given procedure which
+  /// replaces the most arguments with the constants passed by a call.
+  FunctionClone *FindFunctionClone(const FunctionDecl *Function,
+                                   ArrayRef<Expr*> Arguments,
+                                   const ExprEvalScope *Scope = nullptr);
 
 public:
   CodeGenModule(ASTContext &C, const CodeGenOptions &CodeGenOpts,
@@ -142,6 +184,12 @@ public:
 
   ASTContext &getContext() const { return Context; }
 
+  const LangOptions &getLangOpts() const { return LangOpts; }
+
+  const CodeGenOptions &getCodeGenOpts() const { return CodeGenOpts; }
+
+  DiagnosticsEngine &getDiags() const { return Diags; }
+
   llvm::Module &getModule() const { return TheModule; }
 
   llvm::LLVMContext &getLLVMContext() const { return VMContext; }
@@ -179,12 +227,46 @@ public:
   /// Release - Finalize LLVM code generation.
   void Release();
 
+  /// AnalyzeWholeProgram - Finds the internal procedures, the arguments
+  /// which are passed by value and the procedures which are cloned for
+  /// constant array dimensions when the translation unit is the whole
+  /// program.
+  void AnalyzeWholeProgram(const TranslationUnitDecl *TU);
+
+  /// isByValueArgument - Returns true if the given scalar argument is
+  /// passed by value.
+  bool isByValueArgument(const VarDecl *Arg) const {
+    return ByValueArguments.count(Arg) != 0;
+  }
+
+  /// GetFunctionClone - Returns the clone of the given procedure which
+  /// matches the constant arguments of a call, or null.
+  llvm::Function *GetFunctionClone(const FunctionDecl *Function,
+                                   ArrayRef<Expr*> Arguments,
+                                   const ExprEvalScope *Scope = nullptr);
+
+  /// isInlinableFunction - Returns true if the calls to the given procedure
+  /// are inlined during code generation (-finline-small-procedures).
+  bool isInlinableFunction(const FunctionDecl *Function);
+
   void EmitTopLevelDecl(const Decl *Declaration);
 
   void EmitMainProgramDecl(const MainProgramDecl *Program);
 
   void EmitFunctionDecl(const FunctionDecl *Function);
 
+  /// SetFunctionAttributes - Adds the attributes which are derived
+  /// from the code generation options to the defined function.
+  void SetFunctionAttributes(llvm::Function *Func);
+
+  /// IsThreadLocal - Returns true if every thread gets its own copy
+  /// of the given saved variable or common block.
+  bool IsThreadLocal(const VarDecl *Var) const;
+  bool IsThreadLocal(const CommonBlockDecl *CB) const;
+
+  /// SetThreadLocal - Makes the given global variable thread local.
+  void SetThreadLocal(llvm::GlobalVariable *Var);
+
   llvm::GlobalVariable *EmitGlobalVariable(StringRef FuncName, const VarDecl *Var,
                                            llvm::Constant *Initializer = nullptr);
 
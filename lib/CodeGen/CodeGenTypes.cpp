@@ -13,6 +13,8 @@
 
 #include "CodeGenTypes.h"
 #include "CodeGenModule.h"
+#include "ABIInfo.h"
+#include "TargetInfo.h"
 #include "flang/AST/ASTContext.h"
 #include "flang/AST/Decl.h"
 #include "flang/AST/Expr.h"
@@ -25,6 +27,8 @@ namespace CodeGen {
 
 CodeGenTypes::CodeGenTypes(CodeGenModule &cgm)
   : CGM(cgm), Context(cgm.getContext()) {
+  for(auto &Name : CGM.getCodeGenOpts().SoADerivedTypes)
+    SoARecordNames.insert(Name);
 }
 
 CodeGenTypes::~CodeGenTypes() { }
@@ -129,6 +133,23 @@ llvm::Type *CodeGenTypes::ConvertRecordType(const RecordType *T) {
   return llvm::StructType::get(CGM.getLLVMContext(), Fields);
 }
 
+bool CodeGenTypes::isSoARecordType(const RecordType *T) const {
+  if(SoARecordNames.empty())
+    return false;
+  return SoARecordNames.count(T->getDecl()->getName().lower()) != 0;
+}
+
+llvm::StructType *CodeGenTypes::ConvertSoAArrayTypeForMem(const ArrayType *T) {
+  uint64_t ArraySize;
+  if(!T->EvaluateSize(ArraySize, Context))
+    llvm_unreachable("invalid memory array type");
+  SmallVector<llvm::Type*, 16> Fields;
+  for(auto I : T->getElementType()->asRecordType()->getElements())
+    Fields.push_back(llvm::ArrayType::get(ConvertTypeForMem(I->getType()),
+                                          ArraySize));
+  return llvm::StructType::get(CGM.getLLVMContext(), Fields);
+}
+
 llvm::Type *CodeGenTypes::ConvertFunctionType(const FunctionType *T) {
   return llvm::PointerType::get(GetFunctionType(T->getPrototype())->getFunctionType(), 0);
 }
@@ -145,7 +166,11 @@ const CGFunctionInfo *CodeGenTypes::GetFunctionType(const FunctionDecl *FD) {
   for(size_t I = 0; I < Args.size(); ++I) {
     auto ArgType = Args[I]->getType();
     CGFunctionInfo::ArgInfo Info;
-    Info.ABIInfo = DefaultABI.GetArgABI(ArgType);
+    if(CGM.isByValueArgument(Args[I])) {
+      Info.ABIInfo = ABIArgInfo(ABIArgInfo::Value);
+      CGM.getTargetCodeGenInfo().getABIInfo().computeArgTypeInfo(ArgType, Info.ABIInfo);
+    } else
+      Info.ABIInfo = DefaultABI.GetArgABI(ArgType);
     ConvertArgumentType(ArgTypes, AdditionalArgTypes, ArgType, Info);
     ArgInfo.push_back(Info);
   }
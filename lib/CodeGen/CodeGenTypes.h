@@ -20,6 +20,7 @@
 #include "flang/AST/Type.h"
 #include "flang/Frontend/CodeGenOptions.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Module.h"
 #include <vector>
 
@@ -65,6 +66,11 @@ public:
   ASTContext &Context;
   FortranABI DefaultABI;
 
+private:
+  /// SoARecordNames - The lower case names of the derived types whose
+  /// arrays can be stored with one array per component.
+  llvm::StringSet<> SoARecordNames;
+
 public:
   CodeGenTypes(CodeGenModule &cgm);
   ~CodeGenTypes();
@@ -104,6 +110,14 @@ public:
 
   llvm::Type *ConvertRecordType(const RecordType *T);
 
+  /// isSoARecordType - Returns true if the arrays of the given derived
+  /// type can be stored with one array per component.
+  bool isSoARecordType(const RecordType *T) const;
+
+  /// ConvertSoAArrayTypeForMem - Converts a fixed size array of a derived
+  /// type into a structure which contains an array for every component.
+  llvm::StructType *ConvertSoAArrayTypeForMem(const ArrayType *T);
+
   llvm::Type *ConvertFunctionType(const FunctionType *T);
 
   llvm::Type *ConvertReturnType(QualType T,
@@ -18,16 +18,68 @@
 #include "flang/AST/Expr.h"
 #include "flang/Basic/Diagnostic.h"
 #include "flang/Frontend/CodeGenOptions.h"
+#include "flang/Frontend/FrontendDiagnostic.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
 using namespace flang;
 
 namespace {
 
   using std::unique_ptr;
 
+  /// BufferedDiagnosticClient - Stores the diagnostics which are reported by
+  /// a code generation thread, so that they can be reported in the order
+  /// of the program units once the thread finishes.
+  class BufferedDiagnosticClient : public DiagnosticClient {
+  public:
+    struct BufferedDiagnostic {
+      DiagnosticsEngine::Level Level;
+      SourceLocation Loc;
+      std::string Message;
+      std::vector<SourceRange> Ranges;
+    };
+
+  private:
+    std::vector<BufferedDiagnostic> Diagnostics;
+
+  public:
+    ArrayRef<BufferedDiagnostic> getDiagnostics() const {
+      return Diagnostics;
+    }
+
+    void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel, SourceLocation L,
+                          const llvm::Twine &Msg,
+                          llvm::ArrayRef<SourceRange> Ranges,
+                          llvm::ArrayRef<FixItHint> FixIts) override {
+      DiagnosticClient::HandleDiagnostic(DiagLevel, L, Msg, Ranges, FixIts);
+      BufferedDiagnostic D = { DiagLevel, L, Msg.str(),
+                               std::vector<SourceRange>(Ranges.begin(),
+                                                        Ranges.end()) };
+      Diagnostics.push_back(std::move(D));
+    }
+  };
+
+  /// CodeGenShard - A range of program units which is emitted by its own
+  /// thread into its own module.
+  struct CodeGenShard {
+    ArrayRef<const Decl*> Units;
+    unique_ptr<BufferedDiagnosticClient> DiagClient;
+    unique_ptr<DiagnosticsEngine> Diags;
+    llvm::SmallString<0> Bitcode;
+  };
+
   class CodeGeneratorImpl : public CodeGenerator {
     DiagnosticsEngine &Diags;
     std::unique_ptr<const llvm::DataLayout> TD;
@@ -74,15 +126,130 @@ namespace {
       }
 
       auto TranslationUnit = Ctx.getTranslationUnitDecl();
+      Builder->AnalyzeWholeProgram(TranslationUnit);
+      SmallVector<const Decl*, 32> Units;
       auto I = TranslationUnit->decls_begin();
       for(auto E = TranslationUnit->decls_end(); I!=E; ++I) {
         if((*I)->getDeclContext() == TranslationUnit)
-          Builder->EmitTopLevelDecl(*I);
+          Units.push_back(*I);
+      }
+      if(!EmitUnitsConcurrently(Ctx, Units)) {
+        for(auto D : Units)
+          Builder->EmitTopLevelDecl(D);
       }
 
       if (Builder)
         Builder->Release();
     }
+
+    /// EmitUnitsConcurrently - Emits the program units using several threads
+    /// (-fcodegen-threads). The units are split into contiguous ranges, and
+    /// every range except the first one is emitted by its own thread into a
+    /// separate module. An LLVM context can't be used by several threads, so
+    /// each thread has its own context, and passes its module back as bitcode,
+    /// which is then linked into the resulting module. The first range is
+    /// emitted by this thread directly into the resulting module.
+    ///
+    /// Returns false if the units have to be emitted sequentially.
+    bool EmitUnitsConcurrently(ASTContext &Context,
+                               ArrayRef<const Decl*> Units) {
+      // The whole program optimizations change the procedures' interfaces
+      // based on all of their calls, which every module has to agree on.
+      if(CodeGenOpts.CodeGenThreads < 2 || CodeGenOpts.WholeProgram ||
+         Units.size() < 2)
+        return false;
+
+      size_t NumShards = std::min<size_t>(CodeGenOpts.CodeGenThreads,
+                                          Units.size());
+      std::vector<CodeGenShard> Shards(NumShards);
+      for(size_t I = 0; I < NumShards; ++I) {
+        auto Begin = Units.size() * I / NumShards;
+        auto End = Units.size() * (I + 1) / NumShards;
+        auto &Shard = Shards[I];
+        Shard.Units = Units.slice(Begin, End - Begin);
+        if(I == 0)
+          continue;
+        Shard.DiagClient.reset(new BufferedDiagnosticClient);
+        Shard.Diags.reset(new DiagnosticsEngine(new DiagnosticIDs,
+                                                &Context.getSourceManager(),
+                                                Shard.DiagClient.get(), false));
+        Shard.Diags->copyMappings(Diags);
+      }
+
+      Context.setConcurrentAccess(true);
+      std::vector<std::thread> Threads;
+      for(size_t I = 1; I < NumShards; ++I) {
+        auto Shard = &Shards[I];
+        Threads.push_back(std::thread([this, &Context, Shard] {
+          EmitShard(Context, *Shard);
+        }));
+      }
+      for(auto D : Shards[0].Units)
+        Builder->EmitTopLevelDecl(D);
+      for(auto &Thread : Threads)
+        Thread.join();
+      Context.setConcurrentAccess(false);
+
+      // The diagnostics are replayed through the main engine, so that the
+      // error and warning limits hold across all the shards.
+      for(size_t I = 1; I < NumShards; ++I) {
+        auto &Shard = Shards[I];
+        for(const auto &D : Shard.DiagClient->getDiagnostics())
+          Diags.ReportFormatted(D.Level, D.Loc, D.Message, D.Ranges);
+        if(!LinkShard(Shard)) {
+          Builder.reset();
+          M.reset();
+          break;
+        }
+      }
+      return true;
+    }
+
+    /// EmitShard - Emits the program units of the given shard into a new
+    /// module, and stores the module as bitcode.
+    void EmitShard(ASTContext &Context, CodeGenShard &Shard) {
+      llvm::LLVMContext VMContext;
+      llvm::Module ShardModule(M->getModuleIdentifier(), VMContext);
+      ShardModule.setTargetTriple(Target.Triple);
+      llvm::DataLayout ShardTD(&ShardModule);
+      {
+        CodeGen::CodeGenModule ShardBuilder(Context, CodeGenOpts, ShardModule,
+                                            ShardTD, *Shard.Diags);
+        for(auto D : Shard.Units)
+          ShardBuilder.EmitTopLevelDecl(D);
+        ShardBuilder.Release();
+      }
+      llvm::raw_svector_ostream OS(Shard.Bitcode);
+      llvm::WriteBitcodeToFile(&ShardModule, OS);
+      OS.flush();
+    }
+
+    /// LinkShard - Links the module which was emitted by the given shard
+    /// into the resulting module. Returns false on failure.
+    bool LinkShard(CodeGenShard &Shard) {
+      auto Buffer = llvm::MemoryBufferRef(Shard.Bitcode.str(),
+                                          M->getModuleIdentifier());
+      auto ModuleOrErr = llvm::parseBitcodeFile(Buffer, M->getContext());
+      if(std::error_code EC = ModuleOrErr.getError()) {
+        Diags.Report(diag::err_fe_cannot_link_module)
+          << M->getModuleIdentifier() << EC.message();
+        return false;
+      }
+      std::unique_ptr<llvm::Module> ShardModule(std::move(ModuleOrErr.get()));
+      return !llvm::Linker::LinkModules(M.get(), ShardModule.get(),
+                                        [this](const llvm::DiagnosticInfo &DI) {
+        if(DI.getSeverity() != llvm::DS_Error)
+          return;
+        std::string Message;
+        {
+          llvm::raw_string_ostream Stream(Message);
+          llvm::DiagnosticPrinterRawOStream DP(Stream);
+          DI.print(DP);
+        }
+        Diags.Report(diag::err_fe_cannot_link_module)
+          << M->getModuleIdentifier() << Message;
+      });
+    }
   };
 }
 
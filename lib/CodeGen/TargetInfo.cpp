@@ -19,8 +19,10 @@
 #include "CodeGenModule.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 namespace flang {
 
@@ -57,16 +59,112 @@ void X86_32ABIInfo::computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const {
 /// NB: works only with x86_64-pc-{linux,darwin}
 class X86_64ABIInfo : public ABIInfo  {
   CodeGenModule &CGM;
+
+  /// The classes of the eightbytes of an aggregate.
+  enum Class {
+    NoClass,
+    Integer,
+    SSE,
+    Memory
+  };
+
+  static Class merge(Class A, Class B);
+
+  /// classify - Merges the classes of the scalars in the given type
+  /// into the classes of the eightbytes which contain them.
+  void classify(llvm::Type *T, uint64_t Offset, Class Classes[2],
+                bool HasDouble[2]) const;
+
+  /// getCoercedRecordType - Returns the type which is used to return the
+  /// given record in the registers, or null if it's returned in memory.
+  llvm::Type *getCoercedRecordType(llvm::Type *T) const;
 public:
   X86_64ABIInfo(CodeGenModule &cgm) : CGM(cgm) {}
   void computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const;
+  void computeArgTypeInfo(QualType T, ABIArgInfo &Info) const;
 };
 
+X86_64ABIInfo::Class X86_64ABIInfo::merge(Class A, Class B) {
+  if(A == B || B == NoClass)
+    return A;
+  if(A == NoClass)
+    return B;
+  if(A == Memory || B == Memory)
+    return Memory;
+  return Integer;
+}
+
+void X86_64ABIInfo::classify(llvm::Type *T, uint64_t Offset, Class Classes[2],
+                             bool HasDouble[2]) const {
+  auto &DL = CGM.getDataLayout();
+  if(auto ST = dyn_cast<llvm::StructType>(T)) {
+    auto Layout = DL.getStructLayout(ST);
+    for(unsigned I = 0; I < ST->getNumElements(); ++I)
+      classify(ST->getElementType(I), Offset + Layout->getElementOffset(I),
+               Classes, HasDouble);
+    return;
+  }
+  if(auto AT = dyn_cast<llvm::ArrayType>(T)) {
+    auto ElementSize = DL.getTypeAllocSize(AT->getElementType());
+    for(uint64_t I = 0; I < AT->getNumElements(); ++I)
+      classify(AT->getElementType(), Offset + I * ElementSize,
+               Classes, HasDouble);
+    return;
+  }
+
+  Class C = Memory;
+  if(T->isFloatTy() || T->isDoubleTy())
+    C = SSE;
+  else if(T->isIntegerTy() || T->isPointerTy())
+    C = Integer;
+  // NB: the fields are naturally aligned, so a scalar
+  // never crosses the boundary of an eightbyte.
+  Classes[Offset / 8] = merge(Classes[Offset / 8], C);
+  if(T->isDoubleTy())
+    HasDouble[Offset / 8] = true;
+}
+
+llvm::Type *X86_64ABIInfo::getCoercedRecordType(llvm::Type *T) const {
+  auto Size = CGM.getDataLayout().getTypeAllocSize(T);
+  if(Size == 0 || Size > 16)
+    return nullptr;
+
+  Class Classes[2] = { NoClass, NoClass };
+  bool HasDouble[2] = { false, false };
+  classify(T, 0, Classes, HasDouble);
+
+  llvm::Type *Eightbytes[2];
+  unsigned NumEightbytes = (Size + 7) / 8;
+  for(unsigned I = 0; I < NumEightbytes; ++I) {
+    auto Remaining = Size - I * 8;
+    switch(Classes[I]) {
+    case SSE:
+      if(HasDouble[I])
+        Eightbytes[I] = CGM.DoubleTy;
+      else if(Remaining <= 4)
+        Eightbytes[I] = CGM.FloatTy;
+      else
+        Eightbytes[I] = llvm::VectorType::get(CGM.FloatTy, 2);
+      break;
+    case Integer:
+      Eightbytes[I] = llvm::IntegerType::get(CGM.getLLVMContext(),
+                                             std::min<uint64_t>(Remaining, 8) * 8);
+      break;
+    default:
+      return nullptr;
+    }
+  }
+  if(NumEightbytes == 1)
+    return Eightbytes[0];
+  return llvm::StructType::get(CGM.getLLVMContext(),
+                               llvm::makeArrayRef(Eightbytes, NumEightbytes));
+}
+
 void X86_64ABIInfo::computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const {
-  if(!T->isComplexType())
+  if(Info.getKind() != ABIRetInfo::Value)
     return;
 
-  if(Info.getKind() == ABIRetInfo::Value) {
+  if(T->isComplexType()) {
     switch(T->getBuiltinTypeKind()) {
     case BuiltinType::Real4:
       Info = ABIRetInfo(ABIRetInfo::Value, llvm::VectorType::get(CGM.FloatTy, 2));
@@ -74,11 +172,93 @@ void X86_64ABIInfo::computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const {
     case BuiltinType::Real8:
       break;
     default:
-      llvm_unreachable("invalid type kind");
+      // complex(16) is returned in memory.
+      Info = ABIRetInfo(ABIRetInfo::AggregateValueAsArg);
+      break;
     }
+  } else if(T->isRecordType()) {
+    // The large records are left to the backend, which returns them
+    // in memory.
+    if(auto Coerced = getCoercedRecordType(CGM.getTypes().ConvertTypeForMem(T)))
+      Info = ABIRetInfo(ABIRetInfo::Value, Coerced);
   }
 }
 
+void X86_64ABIInfo::computeArgTypeInfo(QualType T, ABIArgInfo &Info) const {
+  // complex(4) is passed in one SSE register.
+  if(Info.getKind() == ABIArgInfo::Value && T->isComplexType() &&
+     T->getBuiltinTypeKind() == BuiltinType::Real4)
+    Info = ABIArgInfo(ABIArgInfo::ComplexValueAsVector);
+}
+
+/// ABI Info for AArch64 (AAPCS64)
+class AArch64ABIInfo : public ABIInfo  {
+  CodeGenModule &CGM;
+
+  /// isHomogeneousFloatAggregate - Returns true if all the scalars in the
+  /// given type have the same floating point type.
+  bool isHomogeneousFloatAggregate(llvm::Type *T, llvm::Type *&Base,
+                                   uint64_t &Count) const;
+public:
+  AArch64ABIInfo(CodeGenModule &cgm) : CGM(cgm) {}
+  void computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const;
+};
+
+bool AArch64ABIInfo::isHomogeneousFloatAggregate(llvm::Type *T, llvm::Type *&Base,
+                                                 uint64_t &Count) const {
+  if(auto ST = dyn_cast<llvm::StructType>(T)) {
+    for(auto Element : ST->elements()) {
+      if(!isHomogeneousFloatAggregate(Element, Base, Count))
+        return false;
+    }
+    return true;
+  }
+  if(auto AT = dyn_cast<llvm::ArrayType>(T)) {
+    uint64_t ElementCount = 0;
+    if(!isHomogeneousFloatAggregate(AT->getElementType(), Base, ElementCount))
+      return false;
+    Count += ElementCount * AT->getNumElements();
+    return true;
+  }
+  if(!T->isFloatingPointTy() || (Base && Base != T))
+    return false;
+  Base = T;
+  ++Count;
+  return true;
+}
+
+void AArch64ABIInfo::computeReturnTypeInfo(QualType T, ABIRetInfo &Info) const {
+  // The complex values are homogeneous aggregates, which are
+  // returned in the floating point registers.
+  if(Info.getKind() != ABIRetInfo::Value || !T->isRecordType())
+    return;
+
+  auto Type = CGM.getTypes().ConvertTypeForMem(T);
+  llvm::Type *Base = nullptr;
+  uint64_t Count = 0;
+  if(isHomogeneousFloatAggregate(Type, Base, Count) && Base &&
+     Count <= 4) {
+    Info = ABIRetInfo(ABIRetInfo::Value, llvm::ArrayType::get(Base, Count));
+    return;
+  }
+
+  // The other records up to 16 bytes are returned in the general
+  // purpose registers, and the larger ones are left to the backend.
+  auto Size = CGM.getDataLayout().getTypeAllocSize(Type);
+  if(Size == 0 || Size > 16)
+    return;
+  if(Size <= 8) {
+    Info = ABIRetInfo(ABIRetInfo::Value,
+                      llvm::IntegerType::get(CGM.getLLVMContext(), Size * 8));
+    return;
+  }
+  llvm::Type *Parts[] = {
+    CGM.Int64Ty, llvm::IntegerType::get(CGM.getLLVMContext(), (Size - 8) * 8)
+  };
+  Info = ABIRetInfo(ABIRetInfo::Value,
+                    llvm::StructType::get(CGM.getLLVMContext(), Parts));
+}
+
 //===----------------------------------------------------------------------===//
 // Driver code
 //===----------------------------------------------------------------------===//
@@ -101,6 +281,10 @@ const TargetCodeGenInfo &CodeGenModule::getTargetCodeGenInfo() {
   case llvm::Triple::x86_64:
     TheTargetCodeGenInfo = new TargetCodeGenInfo(new X86_64ABIInfo(*this));
     break;
+
+  case llvm::Triple::aarch64:
+    TheTargetCodeGenInfo = new TargetCodeGenInfo(new AArch64ABIInfo(*this));
+    break;
   }
   return *TheTargetCodeGenInfo;
 }
@@ -0,0 +1,457 @@
+//===--- ASTUnit.cpp - ASTUnit utility ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// ASTUnit implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "flang/Frontend/ASTUnit.h"
+#include "flang/AST/Decl.h"
+#include "flang/Parse/Parser.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cctype>
+#include <cstring>
+
+namespace flang {
+
+//===----------------------------------------------------------------------===//
+// Program unit splitting.
+//===----------------------------------------------------------------------===//
+//
+// The splitter looks only at the first line of every statement, and finds
+// the statements which begin and end the program units. This is a
+// conservative approximation of the parser, which is good enough to find the
+// boundaries of the program units in the valid programs. When the splitter
+// is wrong, the affected program units are just parsed together.
+//
+
+/// SqueezeStatement - Returns the upper case text of the statement
+/// without the blanks.
+static std::string SqueezeStatement(StringRef Text) {
+  std::string Result;
+  Result.reserve(Text.size());
+  for(auto C : Text) {
+    if(isspace(C)) continue;
+    Result.push_back(toupper(C));
+  }
+  return Result;
+}
+
+/// StripComment - Removes the trailing '!' comment from a free form line.
+static StringRef StripComment(StringRef Line) {
+  char Quote = '\0';
+  for(size_t I = 0; I < Line.size(); ++I) {
+    char C = Line[I];
+    if(Quote) {
+      if(C == Quote) Quote = '\0';
+    } else if(C == '\'' || C == '"')
+      Quote = C;
+    else if(C == '!')
+      return Line.substr(0, I);
+  }
+  return Line;
+}
+
+static bool HasTopLevelEquals(StringRef Stmt) {
+  int Parens = 0;
+  for(auto C : Stmt) {
+    if(C == '(') ++Parens;
+    else if(C == ')') --Parens;
+    else if(C == '=' && Parens <= 0) return true;
+  }
+  return false;
+}
+
+/// SkipParens - Skips the parenthesized text at the start of the statement.
+static bool SkipParens(StringRef &Stmt) {
+  if(!Stmt.startswith("("))
+    return false;
+  int Parens = 0;
+  for(size_t I = 0; I < Stmt.size(); ++I) {
+    if(Stmt[I] == '(') ++Parens;
+    else if(Stmt[I] == ')' && --Parens == 0) {
+      Stmt = Stmt.drop_front(I + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+/// StripSubprogramPrefix - Removes the prefix specifiers and the
+/// result type of a function statement.
+static StringRef StripSubprogramPrefix(StringRef Stmt) {
+  static const char *const Prefixes[] = {
+    "RECURSIVE", "PURE", "IMPURE", "ELEMENTAL"
+  };
+  static const char *const Types[] = {
+    "INTEGER", "REAL", "COMPLEX", "LOGICAL", "CHARACTER",
+    "DOUBLEPRECISION", "DOUBLECOMPLEX"
+  };
+  bool Changed = true;
+  while(Changed) {
+    Changed = false;
+    for(auto Prefix : Prefixes) {
+      if(Stmt.startswith(Prefix)) {
+        Stmt = Stmt.drop_front(strlen(Prefix));
+        Changed = true;
+      }
+    }
+    for(auto Type : Types) {
+      if(!Stmt.startswith(Type))
+        continue;
+      StringRef Rest = Stmt.drop_front(strlen(Type));
+      if(Rest.startswith("*")) {
+        Rest = Rest.drop_front(1);
+        if(!SkipParens(Rest))
+          Rest = Rest.ltrim("0123456789");
+      } else
+        SkipParens(Rest);
+      Stmt = Rest;
+      Changed = true;
+      break;
+    }
+    if(Stmt.startswith("TYPE(")) {
+      Stmt = Stmt.drop_front(4);
+      SkipParens(Stmt);
+      Changed = true;
+    }
+  }
+  return Stmt;
+}
+
+static bool IsSubprogramBegin(StringRef Stmt) {
+  Stmt = StripSubprogramPrefix(Stmt);
+  return Stmt.startswith("FUNCTION") || Stmt.startswith("SUBROUTINE");
+}
+
+static bool IsProgramUnitBegin(StringRef Stmt) {
+  if(HasTopLevelEquals(Stmt))
+    return false;
+  if(Stmt.startswith("PROGRAM") || Stmt.startswith("BLOCKDATA"))
+    return true;
+  if(Stmt.startswith("MODULE") && !Stmt.startswith("MODULEPROCEDURE"))
+    return true;
+  return IsSubprogramBegin(Stmt);
+}
+
+static bool IsProgramUnitEnd(StringRef Stmt) {
+  if(Stmt == "END")
+    return true;
+  if(HasTopLevelEquals(Stmt))
+    return false;
+  return Stmt.startswith("ENDPROGRAM") || Stmt.startswith("ENDSUBROUTINE") ||
+         Stmt.startswith("ENDFUNCTION") || Stmt.startswith("ENDMODULE") ||
+         Stmt.startswith("ENDBLOCKDATA");
+}
+
+void SplitProgramUnits(StringRef Source, bool FixedForm,
+                       SmallVectorImpl<StringRef> &Units) {
+  size_t UnitStart = 0;
+  bool InUnit = false;
+  bool Continued = false;
+  unsigned InterfaceDepth = 0;
+  // For every open program unit, true if it can contain subprograms.
+  SmallVector<bool, 4> HasContains;
+
+  size_t LineStart = 0;
+  while(LineStart < Source.size()) {
+    size_t LineEnd = Source.find('\n', LineStart);
+    size_t Next = LineEnd == StringRef::npos? Source.size() : LineEnd + 1;
+    StringRef Line = Source.slice(LineStart, Next).rtrim("\r\n");
+    LineStart = Next;
+
+    // Find the text of the statement which starts on this line.
+    StringRef Text;
+    if(FixedForm) {
+      if(Line.empty() || Line[0] == 'C' || Line[0] == 'c' ||
+         Line[0] == '*' || Line[0] == '!')
+        continue;
+      if(Line.size() > 5 && Line[5] != ' ' && Line[5] != '0')
+        continue;
+      Text = Line.size() > 6? StripComment(Line.drop_front(6)) : StringRef();
+    } else {
+      Text = StripComment(Line).trim();
+      if(Text.empty())
+        continue;
+      bool IsContinuation = Continued;
+      Continued = Text.endswith("&");
+      if(IsContinuation)
+        continue;
+      Text = Text.ltrim("0123456789").ltrim();
+    }
+    std::string Stmt = SqueezeStatement(Text);
+    if(Stmt.empty())
+      continue;
+
+    if(!InUnit) {
+      InUnit = true;
+      HasContains.clear();
+      InterfaceDepth = 0;
+      if(!IsProgramUnitBegin(Stmt) && IsProgramUnitEnd(Stmt)) {
+        // A main program which is just an END statement.
+        Units.push_back(Source.slice(UnitStart, Next));
+        UnitStart = Next;
+        InUnit = false;
+        continue;
+      }
+      // A statement which doesn't begin a program unit begins
+      // a main program without a PROGRAM statement.
+      HasContains.push_back(false);
+      continue;
+    }
+
+    StringRef S(Stmt);
+    if(S == "CONTAINS") {
+      HasContains.back() = true;
+      continue;
+    }
+    if(S.startswith("INTERFACE") || S.startswith("ABSTRACTINTERFACE")) {
+      ++InterfaceDepth;
+      continue;
+    }
+    if(S.startswith("ENDINTERFACE")) {
+      if(InterfaceDepth) --InterfaceDepth;
+      continue;
+    }
+    if((HasContains.back() || InterfaceDepth) && IsProgramUnitBegin(S)) {
+      HasContains.push_back(false);
+      continue;
+    }
+    if(IsProgramUnitEnd(S)) {
+      HasContains.pop_back();
+      if(HasContains.empty()) {
+        Units.push_back(Source.slice(UnitStart, Next));
+        UnitStart = Next;
+        InUnit = false;
+      }
+    }
+  }
+
+  // The trailing comments belong to the last program unit.
+  if(UnitStart < Source.size()) {
+    if(Units.empty() || InUnit)
+      Units.push_back(Source.substr(UnitStart));
+    else
+      Units.back() = Source.slice(Units.back().data() - Source.data(),
+                                  Source.size());
+  }
+}
+
+/// CollectIdentifiers - Adds the upper case words of the text to the set.
+static void CollectIdentifiers(StringRef Text, llvm::StringSet<> &Identifiers) {
+  std::string Word;
+  for(size_t I = 0; I <= Text.size(); ++I) {
+    char C = I < Text.size()? Text[I] : ' ';
+    if(isalnum(C) || C == '_') {
+      if(!Word.empty() || isalpha(C))
+        Word.push_back(toupper(C));
+      continue;
+    }
+    if(!Word.empty()) {
+      Identifiers.insert(Word);
+      Word.clear();
+    }
+  }
+}
+
+static void CollectDeclaredNames(const SourceProgramUnit &Unit,
+                                 llvm::StringSet<> &Names) {
+  for(auto D : Unit.Decls) {
+    if(auto ND = dyn_cast<NamedDecl>(D))
+      Names.insert(ND->getName().upper());
+  }
+}
+
+static bool UsesAnyName(const SourceProgramUnit &Unit,
+                        const llvm::StringSet<> &Names) {
+  for(const auto &Name : Names) {
+    if(Unit.Identifiers.count(Name.getKey()))
+      return true;
+  }
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// ASTUnit.
+//===----------------------------------------------------------------------===//
+
+/// StoredDiagnosticClient - Stores the diagnostics in the program
+/// unit which is being parsed.
+class ASTUnit::StoredDiagnosticClient : public DiagnosticClient {
+  ASTUnit &Unit;
+public:
+  StoredDiagnosticClient(ASTUnit &U) : Unit(U) {}
+
+  void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel, SourceLocation L,
+                        const llvm::Twine &Msg,
+                        llvm::ArrayRef<SourceRange> Ranges,
+                        llvm::ArrayRef<FixItHint> FixIts) override {
+    DiagnosticClient::HandleDiagnostic(DiagLevel, L, Msg, Ranges, FixIts);
+    if(Unit.CurrentUnit)
+      Unit.CurrentUnit->Diagnostics.push_back(StoredDiagnostic(DiagLevel, L,
+                                                               Msg.str()));
+  }
+};
+
+ASTUnit::ASTUnit(StringRef Filename, const LangOptions &Opts)
+  : LangOpts(Opts), OriginalSourceFile(Filename), CurrentUnit(nullptr) {}
+
+ASTUnit::~ASTUnit() {}
+
+bool ASTUnit::hadErrors() const {
+  for(const auto &Unit : ProgramUnits) {
+    for(const auto &D : Unit->Diagnostics) {
+      if(D.Level >= DiagnosticsEngine::Error)
+        return true;
+    }
+  }
+  return false;
+}
+
+bool ASTUnit::getLineAndColumn(SourceLocation Loc, unsigned &Line,
+                               unsigned &Column) const {
+  for(const auto &Unit : ProgramUnits) {
+    auto Buffer = SrcMgr.getMemoryBuffer(Unit->BufferID);
+    if(Loc.getPointer() < Buffer->getBufferStart() ||
+       Loc.getPointer() > Buffer->getBufferEnd())
+      continue;
+    auto LineAndColumn = SrcMgr.getLineAndColumn(Loc, Unit->BufferID);
+    Line = Unit->Line + LineAndColumn.first;
+    Column = LineAndColumn.second;
+    return false;
+  }
+  return true;
+}
+
+void ASTUnit::ParseProgramUnit(SourceProgramUnit &Unit) {
+  Unit.BufferID = SrcMgr.AddNewSourceBuffer(
+                    llvm::MemoryBuffer::getMemBufferCopy(Unit.Text,
+                                                         OriginalSourceFile),
+                    llvm::SMLoc());
+  Unit.Decls.clear();
+  Unit.Diagnostics.clear();
+  Unit.Reparsed = true;
+
+  auto TU = Ctx->getTranslationUnitDecl();
+  llvm::SmallPtrSet<Decl*, 64> OldDecls;
+  OldDecls.insert(TU->decls_begin(), TU->decls_end());
+
+  CurrentUnit = &Unit;
+  TheParser->EnterMainBuffer(Unit.BufferID);
+  Diagnostics->getClient()->BeginSourceFile(LangOpts, &TheParser->getLexer());
+  TheParser->ParseProgramUnits();
+  Diagnostics->getClient()->EndSourceFile();
+  CurrentUnit = nullptr;
+
+  for(auto I = TU->decls_begin(), E = TU->decls_end(); I != E; ++I) {
+    if(!OldDecls.count(*I))
+      Unit.Decls.push_back(*I);
+  }
+}
+
+void ASTUnit::RemoveProgramUnit(SourceProgramUnit &Unit) {
+  for(auto D : Unit.Decls) {
+    if(auto ND = dyn_cast<NamedDecl>(D))
+      TheSema->RemoveFromScopeChains(ND);
+    else
+      Ctx->getTranslationUnitDecl()->removeDecl(D);
+  }
+  Unit.Decls.clear();
+}
+
+ASTUnit *ASTUnit::LoadFromSource(StringRef Filename, StringRef Source,
+                                 const LangOptions &Opts) {
+  std::unique_ptr<ASTUnit> AST(new ASTUnit(Filename, Opts));
+
+  // The parser starts with the main buffer, which holds the whole source.
+  AST->SrcMgr.AddNewSourceBuffer(
+    llvm::MemoryBuffer::getMemBufferCopy(Source, Filename), llvm::SMLoc());
+  AST->DiagClient.reset(new StoredDiagnosticClient(*AST));
+  AST->Diagnostics = new DiagnosticsEngine(new DiagnosticIDs, &AST->SrcMgr,
+                                           AST->DiagClient.get(), false);
+  AST->Ctx.reset(new ASTContext(AST->SrcMgr, AST->LangOpts));
+  AST->TheSema.reset(new Sema(*AST->Ctx, *AST->Diagnostics));
+  AST->TheParser.reset(new Parser(AST->SrcMgr, AST->LangOpts,
+                                  *AST->Diagnostics, *AST->TheSema));
+  AST->Reparse(Source);
+  return AST.release();
+}
+
+ASTUnit *ASTUnit::LoadFromFile(StringRef Filename, const LangOptions &Opts) {
+  auto MBOrErr = llvm::MemoryBuffer::getFile(Filename);
+  if(MBOrErr.getError())
+    return nullptr;
+  return LoadFromSource(Filename, MBOrErr.get()->getBuffer(), Opts);
+}
+
+void ASTUnit::Reparse(StringRef NewSource) {
+  SmallVector<StringRef, 16> Spans;
+  SplitProgramUnits(NewSource, LangOpts.FixedForm, Spans);
+
+  // Keep the program units whose text hasn't changed.
+  llvm::StringMap<SmallVector<unsigned, 1>> OldUnits;
+  for(unsigned I = ProgramUnits.size(); I != 0; --I)
+    OldUnits[ProgramUnits[I - 1]->Text].push_back(I - 1);
+
+  std::vector<std::unique_ptr<SourceProgramUnit>> NewUnits;
+  unsigned Line = 0;
+  for(auto Span : Spans) {
+    std::unique_ptr<SourceProgramUnit> Unit;
+    auto Old = OldUnits.find(Span);
+    if(Old != OldUnits.end() && !Old->getValue().empty()) {
+      Unit = std::move(ProgramUnits[Old->getValue().back()]);
+      Old->getValue().pop_back();
+      Unit->Reparsed = false;
+    } else {
+      Unit.reset(new SourceProgramUnit);
+      Unit->Text = Span.str();
+      CollectIdentifiers(Span, Unit->Identifiers);
+    }
+    Unit->Offset = Span.data() - NewSource.data();
+    Unit->Line = Line;
+    Line += Span.count('\n');
+    NewUnits.push_back(std::move(Unit));
+  }
+
+  // The names which were declared by the removed and the new program units.
+  llvm::StringSet<> ChangedNames;
+  for(auto &Unit : ProgramUnits) {
+    if(!Unit) continue;
+    CollectDeclaredNames(*Unit, ChangedNames);
+    RemoveProgramUnit(*Unit);
+  }
+  ProgramUnits = std::move(NewUnits);
+
+  for(auto &Unit : ProgramUnits) {
+    if(Unit->BufferID) continue;
+    ParseProgramUnit(*Unit);
+    CollectDeclaredNames(*Unit, ChangedNames);
+  }
+
+  // The program units which use the changed names have to be parsed again,
+  // so that they refer to the new declarations.
+  while(!ChangedNames.empty()) {
+    SmallVector<SourceProgramUnit*, 8> Dependents;
+    for(auto &Unit : ProgramUnits) {
+      if(!Unit->Reparsed && UsesAnyName(*Unit, ChangedNames))
+        Dependents.push_back(Unit.get());
+    }
+    ChangedNames.clear();
+    for(auto Unit : Dependents) {
+      CollectDeclaredNames(*Unit, ChangedNames);
+      RemoveProgramUnit(*Unit);
+    }
+    for(auto Unit : Dependents)
+      ParseProgramUnit(*Unit);
+  }
+}
+
+} // end namespace flang
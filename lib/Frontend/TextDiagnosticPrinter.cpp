@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "flang/Frontend/TextDiagnosticPrinter.h"
+#include "flang/Basic/StreamedSource.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
@@ -40,7 +41,39 @@ namespace flang {
 /// \brief Number of spaces to indent when word-wrapping.
 const unsigned WordWrapIndentation = 6;
 
-TextDiagnosticPrinter::~TextDiagnosticPrinter() {}
+/// \brief The size of the pending output at which it is written out.
+const size_t FlushThreshold = 64 * 1024;
+
+TextDiagnosticPrinter::~TextDiagnosticPrinter() {
+  flush();
+}
+
+void TextDiagnosticPrinter::flush() {
+  if (Pending.empty())
+    return;
+  llvm::errs() << Pending;
+  Pending.clear();
+}
+
+void TextDiagnosticPrinter::EndSourceFile() {
+  flush();
+}
+
+void TextDiagnosticPrinter::PrintMessage(const llvm::SMDiagnostic &D,
+                                         bool IsError) {
+  // Colors can only be written to the terminal directly.
+  if (llvm::errs().has_colors()) {
+    flush();
+    SrcMgr.PrintMessage(llvm::errs(), D, true);
+    return;
+  }
+
+  llvm::raw_string_ostream OS(Pending);
+  SrcMgr.PrintMessage(OS, D, false);
+  OS.flush();
+  if (IsError || Pending.size() >= FlushThreshold)
+    flush();
+}
 
 void TextDiagnosticPrinter::HandleDiagnostic(DiagnosticsEngine::Level Level,
                                              SourceLocation L,
@@ -58,8 +91,24 @@ void TextDiagnosticPrinter::HandleDiagnostic(DiagnosticsEngine::Level Level,
   case DiagnosticsEngine::Fatal:   MsgTy = llvm::SourceMgr::DK_Error;   break;
   }
 
-  SrcMgr.PrintMessage(L, MsgTy, Msg,
-                      Ranges, FixIts, true);
+  // The errors are written out immediately, so that they aren't lost
+  // if the compiler crashes afterwards. Only the warnings and the notes
+  // are batched.
+  bool IsError = Level >= DiagnosticsEngine::Error;
+  auto D = SrcMgr.GetMessage(L, MsgTy, Msg, Ranges, FixIts);
+  if(Streamed && L.isValid()) {
+    if(unsigned LineOffset = Streamed->getLineOffset(L)) {
+      llvm::SMDiagnostic Adjusted(SrcMgr, D.getLoc(), D.getFilename(),
+                                  D.getLineNo() + LineOffset,
+                                  D.getColumnNo(), D.getKind(),
+                                  D.getMessage(), D.getLineContents(),
+                                  D.getRanges(), D.getFixIts());
+      PrintMessage(Adjusted, IsError);
+      return;
+    }
+  }
+
+  PrintMessage(D, IsError);
 }
 
 } //namespace flang
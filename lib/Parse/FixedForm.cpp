@@ -35,18 +35,13 @@ void KeywordMatcher::operator=(ArrayRef<KeywordFilter> Filters) {
 }
 
 void KeywordMatcher::Register(tok::TokenKind Keyword) {
-  auto Identifier = getTokenName(Keyword);
-  std::string Name(Identifier);
-  for (size_t I = 0, E = Name.size(); I != E; ++I)
-    Name[I] = ::tolower(Name[I]);
-  Keywords.insert(Name);
+  Keywords.set(Keyword);
 }
 
 bool KeywordMatcher::Matches(StringRef Identifier) const {
-  std::string Name(Identifier);
-  for (size_t I = 0, E = Name.size(); I != E; ++I)
-    Name[I] = ::tolower(Name[I]);
- return Keywords.find(Name) != Keywords.end();
+  unsigned Flags;
+  auto Kind = tok::getKeywordKind(Identifier, Flags);
+  return Kind != tok::unknown && Keywords.test(Kind);
 }
 
 static const tok::TokenKind AmbiguousExecKeywords[] = {
@@ -19,7 +19,9 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
+#include <cctype>
 
 // FIXME: Errors from diag:: for BOZ literals
 
@@ -30,6 +32,7 @@ static bool isWhitespace(unsigned char c);
 static bool isHorizontalWhitespace(unsigned char c);
 static bool isHorizontalTab(unsigned char c);
 static bool isVerticalWhitespace(unsigned char c);
+static bool isIdentifierBody(unsigned char c);
 
 Lexer::Lexer(llvm::SourceMgr &SM, const LangOptions &features, DiagnosticsEngine &D)
   : Text(D, features), Diags(D), SrcMgr(SM), Features(features), TokStart(0),
@@ -108,6 +111,33 @@ void Lexer::LineOfText::SetState(const State &S) {
   CurPtr = S.CurPtr;
 }
 
+/// MatchesKeyword - Returns the number of characters which match the given
+/// lower case keyword, ignoring the case, or zero if they don't match.
+static unsigned MatchesKeyword(const char *Ptr, const char *Keyword) {
+  unsigned I = 0;
+  for(; Keyword[I] != '\0'; ++I) {
+    if(Ptr[I] == '\0' || ::tolower(Ptr[I]) != Keyword[I])
+      return 0;
+  }
+  return I;
+}
+
+/// GetDirectiveSentinelLength - Returns the length of the '!$omp' sentinel
+/// if the given comment is a directive which is lexed as a statement,
+/// or zero if it's just a comment. Only THREADPRIVATE is supported.
+static unsigned GetDirectiveSentinelLength(const char *Ptr) {
+  auto Length = MatchesKeyword(Ptr, "!$omp");
+  if(!Length || !isHorizontalWhitespace(Ptr[Length]))
+    return 0;
+  auto Directive = Ptr + Length;
+  while(isHorizontalWhitespace(*Directive))
+    ++Directive;
+  auto DirectiveLength = MatchesKeyword(Directive, "threadprivate");
+  if(!DirectiveLength || isIdentifierBody(Directive[DirectiveLength]))
+    return 0;
+  return Length;
+}
+
 /// SkipBlankLinesAndComments - Helper function that skips blank lines and lines
 /// with only comments.
 bool Lexer::LineOfText::
@@ -120,6 +150,12 @@ SkipBlankLinesAndComments(unsigned &I, const char *&LineBegin, bool IgnoreContin
     ++I, ++BufPtr;
 
   if (I != LanguageOptions.LineLength && *BufPtr == '!') {
+    // The directives are lexed as statements without the sentinel.
+    if (auto SentinelLength = GetDirectiveSentinelLength(BufPtr)) {
+      I += SentinelLength, BufPtr += SentinelLength;
+      LineBegin = BufPtr;
+      return false;
+    }
     do {
       ++BufPtr;
     } while (!isVerticalWhitespace(*BufPtr));
@@ -754,6 +790,22 @@ void Lexer::getSpelling(const Token &Tok,
   }
 }
 
+llvm::StringRef Lexer::getSpelling(const Token &Tok,
+                                   llvm::SmallVectorImpl<char> &Buffer) const {
+  if (!Tok.needsCleaning()) {
+    const char *TokStart = Tok.isLiteral() ?
+      Tok.getLiteralData() : Tok.getLocation().getPointer();
+    return llvm::StringRef(TokStart, Tok.getLength());
+  }
+
+  llvm::SmallVector<llvm::StringRef, 4> Spelling;
+  getSpelling(Tok, Spelling);
+  Buffer.clear();
+  for (auto Part : Spelling)
+    Buffer.append(Part.begin(), Part.end());
+  return llvm::StringRef(Buffer.data(), Buffer.size());
+}
+
 void  Lexer::getFixedFormIdentifierSpelling(const Token &Tok,
                                             llvm::SmallVectorImpl<llvm::StringRef> &Spelling,
                                             const char *TokStart,
@@ -874,17 +926,13 @@ void Lexer::FormTokenWithChars(Token &Result, tok::TokenKind Kind) {
 /// will see if the defined operator is an intrinsic operator. If so, it will
 /// set the token's kind to that value.
 void Lexer::FormDefinedOperatorTokenWithChars(Token &Result) {
-  std::string CleanedOp;
+  llvm::SmallString<64> CleanedOp;
   unsigned TokLen;
   llvm::StringRef FullOp;
 
   if (!Text.IsInCurrentAtom(TokStart) || Result.needsCleaning()) {
-    llvm::SmallVector<llvm::StringRef, 2> Spelling;
     FormTokenWithChars(Result, tok::unknown);
-    getSpelling(Result, Spelling);
-    for(auto Part: Spelling)
-      CleanedOp += Part;
-    FullOp = CleanedOp;
+    FullOp = getSpelling(Result, CleanedOp);
     TokLen = Result.getLength();
   } else {
     TokLen = getCurrentPtr() - TokStart;
@@ -1706,9 +1754,8 @@ FormatDescriptorLexer::FormatDescriptorLexer(const Lexer &TheLexer,
   Offset = 0;
   TextLoc = FormatDescriptor.getLocation();
 
-  llvm::SmallVector<llvm::StringRef, 2> Spelling;
-  TheLexer.getSpelling(FormatDescriptor, Spelling);
-  Text = FormatDescriptor.CleanLiteral(Spelling);
+  llvm::SmallString<64> Buffer;
+  Text = TheLexer.getSpelling(FormatDescriptor, Buffer).str();
 }
 
 SourceLocation FormatDescriptorLexer::getCurrentLoc() const {
@@ -594,7 +594,7 @@ ExprResult Parser::ParseDesignator(bool IsLvalue) {
       }
     } else if(IsPresent(tok::percent)) {
       auto EType = E.get()->getType();
-      if(EType->isRecordType())
+      if(EType.getSelfOrArrayElementType()->isRecordType())
         E = ParseStructureComponent(E);
       else {
         Diag.Report(Tok.getLocation(), diag::err_unexpected_percent);
@@ -602,7 +602,7 @@ ExprResult Parser::ParseDesignator(bool IsLvalue) {
       }
     } else if(IsPresent(tok::period)) {
       auto EType = E.get()->getType();
-      if(EType->isRecordType())
+      if(EType.getSelfOrArrayElementType()->isRecordType())
         E = ParseStructureComponent(E);
       else {
         Diag.Report(Tok.getLocation(), diag::err_unexpected_period);
@@ -473,4 +473,42 @@ Parser::StmtResult Parser::ParseSAVEStmt() {
   return Actions.ActOnCompoundStmt(Context, Loc, StmtList, StmtLabel);
 }
 
+/// ParseTHREADPRIVATEStmt - Parse the THREADPRIVATE directive.
+///
+///   [OpenMP 2.14.2]:
+///     threadprivate-directive :=
+///         !$OMP THREADPRIVATE ( threadprivate-entity-list )
+///
+///     threadprivate-entity :=
+///         variable-name
+///      or / common-block-name /
+Parser::StmtResult Parser::ParseTHREADPRIVATEStmt() {
+  auto Loc = ConsumeToken();
+  if(!ExpectAndConsume(tok::l_paren))
+    return StmtError();
+
+  do {
+    auto IDLoc = Tok.getLocation();
+    const IdentifierInfo *II;
+    if(ConsumeIfPresent(tok::slash)) {
+      IDLoc = Tok.getLocation();
+      II = Tok.getIdentifierInfo();
+      if(!ExpectAndConsume(tok::identifier) ||
+         !ExpectAndConsume(tok::slash))
+        return StmtError();
+      Actions.ActOnTHREADPRIVATECommonBlock(Context, Loc, IDLoc, II);
+    } else {
+      II = Tok.getIdentifierInfo();
+      if(!ExpectAndConsume(tok::identifier))
+        return StmtError();
+      Actions.ActOnTHREADPRIVATE(Context, Loc, IDLoc, II);
+    }
+  } while(ConsumeIfPresent(tok::comma));
+
+  if(!ExpectAndConsume(tok::r_paren))
+    return StmtError();
+  ExpectStatementEnd();
+  return StmtResult();
+}
+
 } // end namespace flang
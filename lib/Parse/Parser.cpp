@@ -19,10 +19,12 @@
 #include "flang/AST/Decl.h"
 #include "flang/AST/Expr.h"
 #include "flang/AST/Stmt.h"
+#include "flang/Basic/StreamedSource.h"
 #include "flang/Basic/TokenKinds.h"
 #include "flang/Sema/DeclSpec.h"
 #include "flang/Sema/Sema.h"
 #include "flang/Sema/Scope.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/APInt.h"
@@ -45,9 +47,8 @@ void PrettyStackTraceParserEntry::print(llvm::raw_ostream &OS) const {
     return;
   }
 
-  llvm::SmallVector<llvm::StringRef, 2> Spelling;
-  FP.getLexer().getSpelling(Tok, Spelling);
-  std::string Name = Tok.CleanLiteral(Spelling);
+  llvm::SmallString<64> Buffer;
+  llvm::StringRef Name = FP.getLexer().getSpelling(Tok, Buffer);
   FP.getLexer().getSourceManager()
     .PrintMessage(Tok.getLocation(), llvm::SourceMgr::DK_Error,
                   "current parser token '" + Name + "'");
@@ -60,7 +61,7 @@ void PrettyStackTraceParserEntry::print(llvm::raw_ostream &OS) const {
 Parser::Parser(llvm::SourceMgr &SM, const LangOptions &Opts, DiagnosticsEngine  &D,
                Sema &actions)
   : TheLexer(SM, Opts, D), Features(Opts), CrashInfo(*this), SrcMgr(SM),
-    Context(actions.Context), Diag(D), Actions(actions),
+    Streamed(nullptr), SpliceIncludes(false), Context(actions.Context), Diag(D), Actions(actions),
     Identifiers(Opts), DontResolveIdentifiers(false),
     DontResolveIdentifiersInSubExpressions(false),
     LexFORMATTokens(false), StmtConstructName(SourceLocation(),nullptr) {
@@ -69,28 +70,73 @@ Parser::Parser(llvm::SourceMgr &SM, const LangOptions &Opts, DiagnosticsEngine
   Tok.startToken();
   NextTok.startToken();
 
+  PrevTokLocEnd = Tok.getLocation();
+  ParenCount = ParenSlashCount = BraceCount = BracketCount = 0;
+  PrevStmtWasSelectCase = false;
+  ExecutionParts = EP_Parse;
+  SkippingExecutionPart = false;
+}
+
+void Parser::EnterMainBuffer(unsigned BufferID) {
+  CurBufferIndex.clear();
+  LexerBufferContext.clear();
+  CurBufferIndex.push_back(BufferID);
+  getLexer().setBuffer(SrcMgr.getMemoryBuffer(BufferID));
+  Tok.startToken();
+  NextTok.startToken();
+
   PrevTokLocEnd = Tok.getLocation();
   ParenCount = ParenSlashCount = BraceCount = BracketCount = 0;
   PrevStmtWasSelectCase = false;
 }
 
 bool Parser::EnterIncludeFile(const std::string &Filename) {
-  std::string IncludedFile;
-  int NewBuf = SrcMgr.AddIncludeFile(Filename, getLexer().getLoc(),
-                                     IncludedFile);
+  int NewBuf;
+  if(SpliceIncludes)
+    NewBuf = AddSplicedIncludeFile(Filename);
+  else {
+    std::string IncludedFile;
+    NewBuf = SrcMgr.AddIncludeFile(Filename, getLexer().getLoc(),
+                                   IncludedFile);
+  }
   if (NewBuf == 0)
     return true;
 
   CurBufferIndex.push_back(NewBuf);
   LexerBufferContext.push_back(getLexer().getBufferPtr());
   getLexer().setBuffer(SrcMgr.getMemoryBuffer(CurBufferIndex.back()));
-  Diag.getClient()->BeginSourceFile(Features, &TheLexer);
+  if(!SpliceIncludes || CurBufferIndex.size() == 2)
+    Diag.getClient()->BeginSourceFile(Features, &TheLexer);
   return false;
 }
 
+/// AddSplicedIncludeFile - Adds a buffer for the included file. When the
+/// file was already included, the new buffer refers to the contents which
+/// were read for it then, so that the file isn't searched for and read
+/// again. Every inclusion still gets its own buffer, so that the
+/// diagnostics show where the file was included from.
+unsigned Parser::AddSplicedIncludeFile(const std::string &Filename) {
+  auto IncludeLoc = getLexer().getLoc();
+  auto Cached = IncludedFiles.find(Filename);
+  if(Cached != IncludedFiles.end()) {
+    auto Buffer = Cached->second;
+    return SrcMgr.AddNewSourceBuffer(
+             llvm::MemoryBuffer::getMemBuffer(Buffer->getBuffer(),
+                                              Buffer->getBufferIdentifier()),
+             IncludeLoc);
+  }
+
+  std::string IncludedFile;
+  unsigned NewBuf = SrcMgr.AddIncludeFile(Filename, IncludeLoc, IncludedFile);
+  if(NewBuf != 0)
+    IncludedFiles[Filename] = SrcMgr.getMemoryBuffer(NewBuf);
+  return NewBuf;
+}
+
 bool Parser::LeaveIncludeFile() {
-  if(CurBufferIndex.size() == 1) return true;//No files included.
-  Diag.getClient()->EndSourceFile();
+  if(CurBufferIndex.size() == 1) return EnterNextChunk();//No files included.
+  if(!SpliceIncludes || CurBufferIndex.size() == 2)
+    Diag.getClient()->EndSourceFile();
   CurBufferIndex.pop_back();
   getLexer().setBuffer(SrcMgr.getMemoryBuffer(CurBufferIndex.back()),
                        LexerBufferContext.back());
@@ -98,6 +144,15 @@ bool Parser::LeaveIncludeFile() {
   return false;
 }
 
+bool Parser::EnterNextChunk() {
+  if(!Streamed) return true;
+  unsigned NewBuf = Streamed->ReadNextChunk();
+  if(NewBuf == 0) return true;
+  CurBufferIndex.back() = NewBuf;
+  getLexer().setBuffer(SrcMgr.getMemoryBuffer(NewBuf));
+  return false;
+}
+
 SourceLocation Parser::getExpectedLoc() const {
   if(Tok.isAtStartOfStatement())
     return PrevTokLocEnd;
@@ -185,6 +240,10 @@ void Parser::Lex() {
   switch (Tok.getKind()) {
   default: return;
   case tok::kw_INCLUDE:{
+    // The execution part which is being skipped is parsed in place
+    // instead.
+    if(SkippingExecutionPart)
+      return;
     bool hadErrors = ParseInclude();
     Tok = NextTok;
     NextTok.setKind(tok::unknown);
@@ -269,21 +328,21 @@ void Parser::ClassifyToken(Token &T) {
   if (T.isNot(tok::identifier))
     return;
 
-  // Set the identifier info for this token.
-  llvm::SmallVector<llvm::StringRef, 2> Spelling;
-  TheLexer.getSpelling(T, Spelling);
-  std::string NameStr = T.CleanLiteral(Spelling);
+  // Set the identifier info for this token. The spelling of a clean
+  // identifier isn't copied.
+  llvm::SmallString<64> Buffer;
+  llvm::StringRef Name = TheLexer.getSpelling(T, Buffer);
 
   // We assume that the "common case" is that if an identifier is also a
   // keyword, it will most likely be used as a keyword. I.e., most programs are
   // sane, and won't use keywords for variable names. We mark it as a keyword
   // for ease in parsing. But it's weak and can change into an identifier or
   // builtin depending upon the context.
-  if (IdentifierInfo *KW = Identifiers.lookupKeyword(NameStr)) {
+  if (IdentifierInfo *KW = Identifiers.lookupKeyword(Name)) {
     T.setIdentifierInfo(KW);
     T.setKind(KW->getTokenID());
   } else {
-    IdentifierInfo *II = getIdentifierInfo(NameStr);
+    IdentifierInfo *II = &Identifiers.get(Name);
     T.setIdentifierInfo(II);
     T.setKind(II->getTokenID());
   }
@@ -305,9 +364,8 @@ void Parser::CleanLiteral(Token T, std::string &NameStr) {
     return;
   }
 
-  llvm::SmallVector<llvm::StringRef, 2> Spelling;
-  TheLexer.getSpelling(T, Spelling);
-  NameStr = T.CleanLiteral(Spelling);
+  llvm::SmallString<64> Buffer;
+  NameStr = TheLexer.getSpelling(T, Buffer).str();
   if(T.is(tok::char_literal_constant))
     NameStr = std::string(NameStr,1,NameStr.length()-2);
 }
@@ -573,6 +631,7 @@ bool Parser::ParseProgramUnits() {
 
   while (!ParseProgramUnit())
     /* Parse them all */;
+  ParseDeferredExecutionParts();
 
   Actions.ActOnEndTranslationUnit();
   return false;
@@ -660,10 +719,12 @@ bool Parser::ParseMainProgram() {
     NameLoc = PS->getNameLocation();
   }
 
-  MainProgramScope Scope;
-  Actions.ActOnMainProgram(Context, Scope, IDInfo, NameLoc);
+  auto Scope = new MainProgramScope;
+  std::unique_ptr<ExecutableProgramUnitScope> ScopeOwner(Scope);
+  Actions.ActOnMainProgram(Context, *Scope, IDInfo, NameLoc);
 
-  ParseExecutableSubprogramBody(tok::kw_ENDPROGRAM);
+  if(ParseExecutableSubprogramBody(tok::kw_ENDPROGRAM, ScopeOwner))
+    return false;
   auto EndLoc = Tok.getLocation();
   auto EndProgStmt = ParseENDStmt(tok::kw_ENDPROGRAM);
   if(EndProgStmt.isUsable())
@@ -725,7 +786,11 @@ Parser::StmtResult Parser::ParseENDStmt(tok::TokenKind EndKw) {
   return Actions.ActOnEND(Context, Loc, Kind, IDLoc, IDInfo, StmtLabel);
 }
 
-bool Parser::ParseExecutableSubprogramBody(tok::TokenKind EndKw) {
+/// ParseExecutableSubprogramBody - Parses the specification and the execution
+/// parts of a program unit. Returns true if the execution part was deferred
+/// together with the unit's END statement.
+bool Parser::ParseExecutableSubprogramBody(tok::TokenKind EndKw,
+                                           std::unique_ptr<ExecutableProgramUnitScope> &Scope) {
   // FIXME: Check for the specific keywords and not just absence of END or
   //        ENDPROGRAM.
   ParseStatementLabel();
@@ -735,11 +800,146 @@ bool Parser::ParseExecutableSubprogramBody(tok::TokenKind EndKw) {
   // Apply specification statements.
   Actions.ActOnSpecificationPart();
 
+  if(DeferExecutionPart(EndKw, Scope))
+    return true;
+
   ParseStatementLabel();
   ParseExecutionPart();
   return false;
 }
 
+/// DeferExecutionPart - Skips the execution part and the END statement of
+/// the current program unit when the execution parts are deferred or skipped.
+/// The deferred execution part is parsed again from its first statement by
+/// ParseDeferredExecutionParts. The diagnostics are suppressed while the
+/// statements are skipped, so that they are reported only once. An execution
+/// part which includes a file is parsed in place.
+bool Parser::DeferExecutionPart(tok::TokenKind EndKw,
+                                std::unique_ptr<ExecutableProgramUnitScope> &Scope) {
+  if(ExecutionParts == EP_Parse || Streamed || CurBufferIndex.size() != 1)
+    return false;
+
+  auto BufferID = CurBufferIndex.back();
+  auto Begin = LocFirstStmtToken;
+  bool ParseInPlace = false;
+  bool WasSuppressed = Diag.getSuppressAllDiagnostics();
+  Diag.setSuppressAllDiagnostics(true);
+  SkippingExecutionPart = true;
+  while(true) {
+    ParseStatementLabel();
+    ParseConstructNameLabel();
+    LookForExecutableStmtKeyword(StmtLabel || StmtConstructName.isUsable()?
+                                 false : true);
+
+    // Let the execution part report the missing END statement, or enter
+    // the included file.
+    if(Tok.is(tok::eof) || Tok.is(tok::kw_INCLUDE)) {
+      ParseInPlace = true;
+      break;
+    }
+
+    bool IsEnd = false;
+    switch(Tok.getKind()) {
+    case tok::kw_END:
+    case tok::kw_ENDFUNCTION:
+    case tok::kw_ENDPROGRAM:
+    case tok::kw_ENDSUBPROGRAM:
+    case tok::kw_ENDSUBROUTINE:
+      IsEnd = true;
+      if(Features.FixedForm) {
+        auto StmtPoint = LocFirstStmtToken;
+        ConsumeToken();
+        ConsumeIfPresent(tok::identifier);
+        if(IsPresent(tok::l_paren) || IsPresent(tok::equal))
+          IsEnd = false;
+        StartStatementReparse(StmtPoint);
+      }
+      break;
+    case tok::kw_FORMAT:
+      // The format items aren't lexed as normal tokens.
+      LexFORMATTokens = true;
+      Lex();
+      SkipUntilNextStatement();
+      LexFORMATTokens = false;
+      continue;
+    default:
+      break;
+    }
+
+    if(Tok.isAtStartOfStatement()) ConsumeToken();
+    SkipUntilNextStatement();
+    if(IsEnd)
+      break;
+  }
+  SkippingExecutionPart = false;
+  Diag.setSuppressAllDiagnostics(WasSuppressed);
+
+  if(ParseInPlace) {
+    ReenterStatement(BufferID, Begin);
+    return false;
+  }
+  // The statement after the END statement was already lexed without the
+  // diagnostics, so it is lexed again.
+  if(Tok.isNot(tok::eof))
+    ReenterStatement(BufferID, Tok.getLocation());
+
+  StmtLabel = nullptr;
+  Actions.ActOnDeferExecutionPart();
+  if(ExecutionParts == EP_Defer) {
+    DeferredExecutionPart Part;
+    Part.Unit = Actions.CurContext;
+    Part.Scope = std::move(Scope);
+    Part.BufferID = BufferID;
+    Part.Begin = Begin;
+    Part.EndKw = EndKw;
+    DeferredExecutionParts.push_back(std::move(Part));
+  }
+  return true;
+}
+
+/// ParseDeferredExecutionParts - Parses the execution parts which were
+/// deferred until the specification parts of all the units were parsed.
+void Parser::ParseDeferredExecutionParts() {
+  for(auto &Part : DeferredExecutionParts) {
+    ReenterStatement(Part.BufferID, Part.Begin);
+    Actions.ActOnResumeExecutionPart(Part.Unit, *Part.Scope);
+
+    ParseStatementLabel();
+    ParseExecutionPart();
+    auto EndLoc = Tok.getLocation();
+    auto EndStmt = ParseENDStmt(Part.EndKw);
+    if(EndStmt.isUsable())
+      EndLoc = EndStmt.get()->getLocation();
+    StmtLabel = nullptr;
+    Actions.ActOnEndResumedExecutionPart(Part.Unit, EndLoc);
+  }
+  DeferredExecutionParts.clear();
+}
+
+/// ReenterStatement - Makes the parser continue with the statement which
+/// starts at the given location in the given buffer.
+void Parser::ReenterStatement(unsigned BufferID, SourceLocation Loc) {
+  auto Buffer = SrcMgr.getMemoryBuffer(BufferID);
+  auto LineBegin = Loc.getPointer();
+  while(LineBegin != Buffer->getBufferStart() &&
+        (LineBegin[-1] == ' ' || LineBegin[-1] == '\t'))
+    --LineBegin;
+
+  // The statement is lexed from the start of its line when possible,
+  // so that the fixed-form columns are counted correctly.
+  if(LineBegin == Buffer->getBufferStart() ||
+     LineBegin[-1] == '\n' || LineBegin[-1] == '\r') {
+    getLexer().setBuffer(Buffer, LineBegin);
+    Tok.startToken();
+    NextTok.setKind(tok::unknown);
+    Lex();
+    Tok.setFlag(Token::StartOfStatement);
+    return;
+  }
+  getLexer().setBuffer(Buffer, Loc.getPointer(), false);
+  StartStatementReparse(Loc);
+}
+
 /// ParseSpecificationPart - Parse the specification part.
 ///
 ///   [R204]:
@@ -889,8 +1089,9 @@ bool Parser::ParseExternalSubprogram(DeclSpec &ReturnType, int Attr) {
   if(!ExpectAndConsume(tok::identifier))
     return true;
 
-  SubProgramScope Scope;
-  Actions.ActOnSubProgram(Context, Scope, IsSubroutine, IDLoc, II, ReturnType, Attr);
+  auto Scope = new SubProgramScope;
+  std::unique_ptr<ExecutableProgramUnitScope> ScopeOwner(Scope);
+  Actions.ActOnSubProgram(Context, *Scope, IsSubroutine, IDLoc, II, ReturnType, Attr);
   SmallVector<VarDecl* ,8> ArgumentList;
   bool HadErrorsInDeclStmt = false;
 
@@ -939,7 +1140,8 @@ bool Parser::ParseExternalSubprogram(DeclSpec &ReturnType, int Attr) {
 
   auto EndKw = IsSubroutine? tok::kw_ENDSUBROUTINE :
                              tok::kw_ENDFUNCTION;
-  ParseExecutableSubprogramBody(EndKw);
+  if(ParseExecutableSubprogramBody(EndKw, ScopeOwner))
+    return false;
   auto EndLoc = Tok.getLocation();
   auto EndStmt = ParseENDStmt(EndKw);
   if(EndStmt.isUsable())
@@ -1445,6 +1647,7 @@ bool Parser::ParseProcedureDeclStmt() {
 ///      or target-stmt
 ///      or value-stmt
 ///      or volatile-stmt
+///      or threadprivate-directive
 bool Parser::ParseSpecificationStmt() {
   StmtResult Result;
   switch (Tok.getKind()) {
@@ -1522,6 +1725,12 @@ bool Parser::ParseSpecificationStmt() {
   case tok::kw_VOLATILE:
     Result = ParseVOLATILEStmt();
     goto notImplemented;
+  case tok::kw_THREADPRIVATE:
+    // Check if this is an assignment.
+    if(IsNextToken(tok::equal))
+      return true;
+    Result = ParseTHREADPRIVATEStmt();
+    break;
   }
 
   if(Result.isInvalid())
@@ -0,0 +1,68 @@
+//===--- IdentifierResolver.cpp - Identifier resolution -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the IdentifierResolver class, which is used for
+// resolving the identifiers to the declarations which are visible in
+// the current declaration context.
+//
+//===----------------------------------------------------------------------===//
+
+#include "flang/Sema/IdentifierResolver.h"
+#include "flang/AST/Decl.h"
+#include "flang/Basic/IdentifierTable.h"
+
+namespace flang {
+
+IdentifierResolver::IdentifierResolver()
+  : FreeLinks(nullptr) {}
+
+IdentifierResolver::IdDeclLink *
+IdentifierResolver::getChain(const IdentifierInfo *II) {
+  return II? II->getFETokenInfo<IdDeclLink>() : nullptr;
+}
+
+void IdentifierResolver::setChain(const IdentifierInfo *II, IdDeclLink *Chain) {
+  const_cast<IdentifierInfo*>(II)->setFETokenInfo(Chain);
+}
+
+void IdentifierResolver::AddDecl(NamedDecl *D) {
+  auto II = D->getIdentifier();
+  if(!II) return;
+
+  IdDeclLink *Link;
+  if(FreeLinks) {
+    Link = FreeLinks;
+    FreeLinks = FreeLinks->Next;
+  } else
+    Link = new(Allocator) IdDeclLink;
+  Link->D = D;
+  Link->Next = getChain(II);
+  setChain(II, Link);
+}
+
+void IdentifierResolver::RemoveDecl(NamedDecl *D) {
+  auto II = D->getIdentifier();
+  if(!II) return;
+
+  // The declarations are removed in the reverse order,
+  // so the declaration is usually at the head of the chain.
+  IdDeclLink *Prev = nullptr;
+  for(auto Link = getChain(II); Link; Prev = Link, Link = Link->Next) {
+    if(Link->D != D) continue;
+    if(Prev)
+      Prev->Next = Link->Next;
+    else
+      setChain(II, Link->Next);
+    Link->Next = FreeLinks;
+    FreeLinks = Link;
+    return;
+  }
+}
+
+} // end flang namespace
@@ -64,10 +64,25 @@ void Sema::PushDeclContext(DeclContext *DC) {
 
 void Sema::PopDeclContext() {
   assert(CurContext && "DeclContext imbalance!");
+  for(auto I = CurContext->decls_begin(), End = CurContext->decls_end();
+      I != End; ++I) {
+    if(auto ND = dyn_cast<NamedDecl>(*I))
+      IdResolver.RemoveDecl(ND);
+  }
   CurContext = getContainingDC(CurContext);
   assert(CurContext && "Popped translation unit!");
 }
 
+void Sema::PushOnScopeChains(NamedDecl *D) {
+  CurContext->addDecl(D);
+  IdResolver.AddDecl(D);
+}
+
+void Sema::RemoveFromScopeChains(NamedDecl *D) {
+  CurContext->removeDecl(D);
+  IdResolver.RemoveDecl(D);
+}
+
 bool Sema::IsInsideFunctionOrSubroutine() const {
   auto FD = dyn_cast<FunctionDecl>(CurContext);
   return FD && (FD->isNormalFunction() || FD->isSubroutine());
@@ -268,7 +283,10 @@ void Sema::DeclareConstructName(ConstructName Name, NamedConstructStmt *S) {
 }
 
 void Sema::ActOnTranslationUnit(TranslationUnitScope &Scope) {
-  PushDeclContext(Context.getTranslationUnitDecl());
+  // The translation unit stays the current context after its end, so
+  // that more program units can be added to it later.
+  if(CurContext != Context.getTranslationUnitDecl())
+    PushDeclContext(Context.getTranslationUnitDecl());
   CurImplicitTypingScope = &Scope.ImplicitTypingRules;
   CurStmtLabelScope = &Scope.StmtLabels;
 }
@@ -292,7 +310,7 @@ MainProgramDecl *Sema::ActOnMainProgram(ASTContext &C, MainProgramScope &Scope,
   auto ParentDC = C.getTranslationUnitDecl();
   auto Program = MainProgramDecl::Create(C, ParentDC, NameInfo);
   if(Declare)
-    ParentDC->addDecl(Program);
+    PushOnScopeChains(Program);
   PushDeclContext(Program);
   PushExecutableProgramUnit(Scope);
   return Program;
@@ -335,17 +353,17 @@ FunctionDecl *Sema::ActOnSubProgram(ASTContext &C, SubProgramScope &Scope,
                                                     FunctionDecl::NormalFunction,
                                    ParentDC, NameInfo, ReturnType, Attr);
   if(Declare)
-    ParentDC->addDecl(Func);
+    PushOnScopeChains(Func);
   PushDeclContext(Func);
   PushExecutableProgramUnit(Scope);
 
   if(!IsSubRoutine) {
     auto RetVar = VarDecl::CreateFunctionResult(C, CurContext, IDLoc, IDInfo);
-    CurContext->addDecl(RetVar);
+    PushOnScopeChains(RetVar);
     Func->setResult(RetVar);
   } else {
     auto Self = SelfDecl::Create(C, CurContext, Func);
-    CurContext->addDecl(Self);
+    PushOnScopeChains(Self);
   }
 
   if(ReturnTypeDecl.getTypeSpecType() != TST_unspecified)
@@ -364,7 +382,7 @@ void Sema::ActOnRESULT(ASTContext &C, SourceLocation IDLoc,
     return;
   }
   if(Func->hasResult())
-    CurContext->removeDecl(Func->getResult());
+    RemoveFromScopeChains(Func->getResult());
   if (auto Prev = LookupIdentifier(IDInfo)) {
     Diags.Report(IDLoc, diag::err_redefinition)
       << IDInfo << getTokenRange(IDLoc);
@@ -373,12 +391,12 @@ void Sema::ActOnRESULT(ASTContext &C, SourceLocation IDLoc,
   }
 
   auto RetVar = VarDecl::CreateFunctionResult(C, CurContext, IDLoc, IDInfo);
-  CurContext->addDecl(RetVar);
+  PushOnScopeChains(RetVar);
   RetVar->setType(Func->getType());
   Func->setResult(RetVar);
 
   auto Self = SelfDecl::Create(C, CurContext, Func);
-  CurContext->addDecl(Self);
+  PushOnScopeChains(Self);
 }
 
 VarDecl *Sema::ActOnSubProgramArgument(ASTContext &C, SourceLocation IDLoc,
@@ -390,7 +408,7 @@ VarDecl *Sema::ActOnSubProgramArgument(ASTContext &C, SourceLocation IDLoc,
   }
 
   VarDecl *VD = VarDecl::CreateArgument(C, CurContext, IDLoc, IDInfo);
-  CurContext->addDecl(VD);
+  PushOnScopeChains(VD);
   return VD;
 }
 
@@ -410,7 +428,7 @@ VarDecl *Sema::ActOnStatementFunctionArgument(ASTContext &C, SourceLocation IDLo
   VarDecl *VD = VarDecl::CreateArgument(C, CurContext, IDLoc, IDInfo);
   if(!Type.isNull())
     VD->setType(Type);
-  CurContext->addDecl(VD);
+  PushOnScopeChains(VD);
   return VD;
 }
 
@@ -428,6 +446,48 @@ void Sema::ActOnEndSubProgram(ASTContext &C, SourceLocation Loc) {
   PopDeclContext();
 }
 
+void Sema::ActOnDeferExecutionPart() {
+  // The statement labels are resolved and the body is created
+  // when the resumed unit is left.
+  CurStmtLabelScope = CurStmtLabelScope->getParent();
+  CurNamedConstructs = CurNamedConstructs->getParent();
+  CurImplicitTypingScope = CurImplicitTypingScope->getParent();
+  CurEquivalenceScope = nullptr;
+  CurCommonBlockScope = nullptr;
+  CurSpecScope = nullptr;
+  PopDeclContext();
+}
+
+void Sema::ActOnResumeExecutionPart(DeclContext *Unit,
+                                    ExecutableProgramUnitScope &Scope) {
+  auto Next = Decl::castFromDeclContext(Unit)->getNextDeclInContext();
+  for(auto I = DeclContext::decl_iterator(Next), End = DeclContext::decl_iterator();
+      I != End; ++I) {
+    if(auto ND = dyn_cast<NamedDecl>(*I))
+      IdResolver.RemoveDecl(ND);
+  }
+
+  PushDeclContext(Unit);
+  for(auto I = Unit->decls_begin(), End = Unit->decls_end();
+      I != End; ++I) {
+    if(auto ND = dyn_cast<NamedDecl>(*I))
+      IdResolver.AddDecl(ND);
+  }
+  PushExecutableProgramUnit(Scope);
+}
+
+void Sema::ActOnEndResumedExecutionPart(DeclContext *Unit, SourceLocation Loc) {
+  PopExecutableProgramUnit(Loc);
+  PopDeclContext();
+
+  auto Next = Decl::castFromDeclContext(Unit)->getNextDeclInContext();
+  for(auto I = DeclContext::decl_iterator(Next), End = DeclContext::decl_iterator();
+      I != End; ++I) {
+    if(auto ND = dyn_cast<NamedDecl>(*I))
+      IdResolver.AddDecl(ND);
+  }
+}
+
 bool Sema::IsValidStatementFunctionIdentifier(const IdentifierInfo *IDInfo) {
   if (auto Prev = LookupIdentifier(IDInfo)) {
     if(auto VD = dyn_cast<VarDecl>(Prev))
@@ -450,7 +510,7 @@ FunctionDecl *Sema::ActOnStatementFunction(ASTContext &C,
       Declare = false;
     } else {
       ReturnType = VD->getType();
-      CurContext->removeDecl(Prev);
+      RemoveFromScopeChains(VD);
     }
   }
 
@@ -460,7 +520,7 @@ FunctionDecl *Sema::ActOnStatementFunction(ASTContext &C,
   auto Func = FunctionDecl::Create(C, FunctionDecl::StatementFunction,
                                    ParentDC, NameInfo, ReturnType);
   if(Declare)
-    ParentDC->addDecl(Func);
+    PushOnScopeChains(Func);
   PushDeclContext(Func);
   return Func;
 }
@@ -482,10 +542,7 @@ void Sema::ActOnEndStatementFunction(ASTContext &C) {
 VarDecl *Sema::ActOnKindSelector(ASTContext &C, SourceLocation IDLoc,
                                  const IdentifierInfo *IDInfo) {
   VarDecl *VD = VarDecl::Create(C, CurContext, IDLoc, IDInfo, QualType());
-  CurContext->addDecl(VD);
-
-  // Store the Decl in the IdentifierInfo for easy access.
-  const_cast<IdentifierInfo*>(IDInfo)->setFETokenInfo(VD);
+  PushOnScopeChains(VD);
   return VD;
 }
 
@@ -522,7 +579,7 @@ Decl *Sema::ActOnImplicitFunctionDecl(ASTContext &C, SourceLocation IDLoc,
   if(!FuncResult.IsInvalid) {
     auto Func = IntrinsicFunctionDecl::Create(C, CurContext, IDLoc, IDInfo,
                                               C.IntegerTy, FuncResult.Function);
-    CurContext->addDecl(Func);
+    PushOnScopeChains(Func);
     return Func;
   }
 
@@ -553,8 +610,8 @@ Decl *Sema::ActOnPossibleImplicitFunctionDecl(ASTContext &C, SourceLocation IDLo
         // FIXME: what about intrinsic?
         auto Func = FunctionDecl::Create(C, FunctionDecl::External, CurContext,
                                          DeclarationNameInfo(IDInfo, IDLoc), VarType);
-        CurContext->removeDecl(VD);
-        CurContext->addDecl(Func);
+        RemoveFromScopeChains(VD);
+        PushOnScopeChains(Func);
         return Func;
       }
     }
@@ -580,27 +637,18 @@ bool Sema::ApplyImplicitRulesToArgument(VarDecl *Arg, SourceRange Range) {
 }
 
 Decl *Sema::LookupIdentifier(const IdentifierInfo *IDInfo) {
-  auto Result = CurContext->lookup(IDInfo);
-  if(Result.first >= Result.second) return nullptr;
-  assert(Result.first + 1 >= Result.second);
-  return *Result.first;
+  auto D = IdentifierResolver::getInnermostDecl(IDInfo);
+  if(D && D->getDeclContext() == CurContext)
+    return D;
+  return nullptr;
 }
 
 Decl *Sema::ResolveIdentifier(const IdentifierInfo *IDInfo) {
-  auto Context = CurContext;
-  auto Result = Context->lookup(IDInfo);
-  if(Result.first < Result.second) {
-    assert(Result.first + 1 >= Result.second);
-    return *Result.first;
-  }
-
-  for(; Context; Context = Context->getParent()) {
-    Result = Context->lookup(IDInfo);
-    if(Result.first < Result.second) {
-      assert(Result.first + 1 >= Result.second);
-      if(!isa<SelfDecl>(*Result.first))
-        return *Result.first;
-    }
+  for(auto I = IdentifierResolver::begin(IDInfo),
+      End = IdentifierResolver::end(); I != End; ++I) {
+    // The self declarations are only visible in their own context.
+    if((*I)->getDeclContext() == CurContext || !isa<SelfDecl>(*I))
+      return *I;
   }
   return nullptr;
 }
@@ -847,6 +895,26 @@ StmtResult Sema::ActOnSAVECommonBlock(ASTContext &C, SourceLocation Loc,
   return StmtResult();
 }
 
+StmtResult Sema::ActOnTHREADPRIVATE(ASTContext &C, SourceLocation Loc,
+                                    SourceLocation IDLoc,
+                                    const IdentifierInfo *IDInfo) {
+  CurSpecScope->AddThreadPrivateSpec(Loc, IDLoc, IDInfo);
+  return StmtResult();
+}
+
+StmtResult Sema::ActOnTHREADPRIVATECommonBlock(ASTContext &C, SourceLocation Loc,
+                                               SourceLocation IDLoc,
+                                               const IdentifierInfo *IDInfo) {
+  auto Block = CurCommonBlockScope->find(IDInfo);
+  if(!Block) {
+    Diags.Report(IDLoc, diag::err_undeclared_common_block_use)
+      << IDInfo;
+  } else
+    CurSpecScope->AddThreadPrivateSpec(Loc, IDLoc, Block);
+
+  return StmtResult();
+}
+
 /// FIXME: allow outer scope integer constants.
 /// FIXME: walk constant expressions like 1+1.
 ExprResult Sema::ActOnDATAOuterImpliedDoExpr(ASTContext &C,
@@ -243,20 +243,22 @@ void DataStmtEngine::CreateArrayElementExprInitializer(ArrayElementExpr *E,
   if(!ATy->EvaluateSize(ArraySize, Context))
     return VisitExpr(E);
 
-  SmallVector<Expr*, 32> Items(ArraySize);
+  uint64_t Offset;
+  if(!E->EvaluateOffset(Context, Offset, &ImpliedDoEvaluator))
+    return VisitExpr(E);
+
+  // The initializer is updated in place, so that the initialization of
+  // every element doesn't allocate a new constructor for the whole array.
+  ArrayConstructorExpr *Constructor;
   if(VD->hasInit()) {
     assert(isa<ArrayConstructorExpr>(VD->getInit()));
-    auto InsertPoint = cast<ArrayConstructorExpr>(VD->getInit())->getItems();
-    for(uint64_t I = 0; I < ArraySize; ++I)
-      Items[I] = InsertPoint[I];
+    Constructor = cast<ArrayConstructorExpr>(VD->getInit());
   } else {
-    for(uint64_t I = 0; I < ArraySize; ++I)
-      Items[I] = nullptr;
+    SmallVector<Expr*, 32> Items(ArraySize, nullptr);
+    Constructor = ArrayConstructorExpr::Create(Context, E->getLocation(),
+                                               Items, VD->getType());
   }
-
-  uint64_t Offset;
-  if(!E->EvaluateOffset(Context, Offset, &ImpliedDoEvaluator))
-    return VisitExpr(E);
+  auto Items = Constructor->getItems();
 
   ExprResult Val;
   if(Parent) {
@@ -271,9 +273,9 @@ void DataStmtEngine::CreateArrayElementExprInitializer(ArrayElementExpr *E,
   } else Val = getAndCheckAnyValue(ElementType, E);
 
   if(Val.isUsable() && Offset < Items.size()) {
-    Items[Offset] = Val.get();
-    VD->setInit(ArrayConstructorExpr::Create(Context, Val.get()->getLocation(),
-                                             Items, VD->getType()));
+    Constructor->setItem(Offset, Val.get());
+    if(!VD->hasInit())
+      VD->setInit(Constructor);
   }
 }
 
@@ -355,7 +357,7 @@ void DataStmtEngine::VisitMemberExpr(MemberExpr *E) {
   }
 
   auto Target = dyn_cast<VarExpr>(E->getTarget());
-  if(!Target)
+  if(!Target || E->getType()->isArrayType())
     return VisitExpr(E);
   if(CheckVar(Target))
     return;
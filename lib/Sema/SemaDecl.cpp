@@ -204,7 +204,7 @@ VarDecl *Sema::CreateImplicitEntityDecl(ASTContext &C, SourceLocation IDLoc,
   auto VD = VarDecl::Create(C, CurContext, IDLoc, IDInfo, Type);
   // FIXME: type checks?
   VD->setTypeImplicit(true);
-  CurContext->addDecl(VD);
+  PushOnScopeChains(VD);
   return VD;
 }
 
@@ -254,7 +254,7 @@ Decl *Sema::ActOnExternalEntityDecl(ASTContext &C, QualType T,
     if(VD && (VD->isUnusedSymbol() || VD->isArgument()) ) {
       T = VD->getType();
       TypeLoc = VD->getLocation();
-      CurContext->removeDecl(VD);
+      RemoveFromScopeChains(VD);
       if(VD->isArgument())
         ArgumentExternal = VD;
     } else {
@@ -270,7 +270,7 @@ Decl *Sema::ActOnExternalEntityDecl(ASTContext &C, QualType T,
                                                         FunctionDecl::External,
                                    CurContext, DeclName, T);
   SetFunctionType(Decl, T, TypeLoc, SourceRange()); //FIXME: proper loc, and range
-  CurContext->addDecl(Decl);
+  PushOnScopeChains(Decl);
   if(ArgumentExternal)
     ArgumentExternal->setType(C.getFunctionType(Decl));
   return Decl;
@@ -297,7 +297,7 @@ Decl *Sema::ActOnIntrinsicEntityDecl(ASTContext &C, QualType T,
     auto VD = dyn_cast<VarDecl>(Prev);
     if(VD && VD->isUnusedSymbol()) {
       Type = VD->getType();
-      CurContext->removeDecl(VD);
+      RemoveFromScopeChains(VD);
     } else {
       DiagnoseRedefinition(IDLoc, IDInfo, Prev);
       return nullptr;
@@ -306,7 +306,7 @@ Decl *Sema::ActOnIntrinsicEntityDecl(ASTContext &C, QualType T,
 
   auto Decl = IntrinsicFunctionDecl::Create(C, CurContext, IDLoc, IDInfo,
                                             Type, FuncResult.Function);
-  CurContext->addDecl(Decl);
+  PushOnScopeChains(Decl);
   return Decl;
 }
 
@@ -349,7 +349,7 @@ Decl *Sema::ActOnParameterEntityDecl(ASTContext &C, QualType T,
     QualType T = Value.get()->getType();
     VD = VarDecl::Create(C, CurContext, IDLoc, IDInfo, T);
     VD->MutateIntoParameter(Value.get());
-    CurContext->addDecl(VD);
+    PushOnScopeChains(VD);
   }
   return VD;
 }
@@ -388,7 +388,7 @@ Decl *Sema::ActOnEntityDecl(ASTContext &C, const QualType &T,
   }
 
   VarDecl *VD = VarDecl::Create(C, CurContext, IDLoc, IDInfo, T);
-  CurContext->addDecl(VD);
+  PushOnScopeChains(VD);
 
   if(!T.isNull()) {
     auto SubT = T;
@@ -419,7 +419,7 @@ RecordDecl *Sema::ActOnDerivedTypeDecl(ASTContext &C, SourceLocation Loc,
                                        const IdentifierInfo* IDInfo) {
   auto Record = RecordDecl::Create(C, CurContext, Loc, IDLoc, IDInfo);
   if(CheckDeclaration(IDInfo, IDLoc))
-    CurContext->addDecl(Record);
+    PushOnScopeChains(Record);
   PushDeclContext(Record);
   return Record;
 }
@@ -456,7 +456,7 @@ FieldDecl *Sema::ActOnDerivedTypeFieldDecl(ASTContext &C, DeclSpec &DS, SourceLo
     Diags.Report(IDLoc, diag::err_duplicate_member) << IDInfo;
     Diags.Report(Prev->getLocation(), diag::note_previous_declaration);
   } else
-    CurContext->addDecl(Field);
+    PushOnScopeChains(Field);
 
   return Field;
 }
@@ -838,7 +838,7 @@ StmtResult Sema::ActOnCallStmt(ASTContext &C, SourceLocation Loc, SourceLocation
     // an implicit function declaration.
     Function = FunctionDecl::Create(Context, FunctionDecl::External, CurContext,
                                     DeclarationNameInfo(IDInfo, IDLoc), QualType());
-    CurContext->addDecl(Function);
+    PushOnScopeChains(Function);
   }
 
   CheckCallArguments(Function, Arguments, RParenLoc, IDLoc);
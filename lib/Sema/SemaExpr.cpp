@@ -882,7 +882,17 @@ ExprResult Sema::ActOnStructureComponentExpr(ASTContext &C, SourceLocation Loc,
       << Target->getSourceRange();
     return ExprError();
   }
-  return MemberExpr::Create(C, Loc, Target, Field, Field->getType());
+  // A component of an array is an array with the shape of the target.
+  auto Type = Field->getType();
+  if(auto ATy = Target->getType()->asArrayType()) {
+    if(Type->isArrayType()) {
+      Diags.Report(IDLoc, diag::err_array_component_of_array)
+        << IDInfo << Target->getSourceRange();
+      return ExprError();
+    }
+    Type = C.getArrayType(Type, ATy->getDimensions());
+  }
+  return MemberExpr::Create(C, Loc, Target, Field, Type);
 }
 
 } // namespace flang
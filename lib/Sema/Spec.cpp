@@ -190,6 +190,63 @@ bool Sema::ApplySaveSpecification(SourceLocation Loc, SourceLocation IDLoc,
   return false;
 }
 
+void SpecificationScope::AddThreadPrivateSpec(SourceLocation Loc, SourceLocation IDLoc,
+                                              const IdentifierInfo *IDInfo) {
+  StoredThreadPrivateSpec Spec = { Loc, IDLoc, IDInfo, nullptr };
+  ThreadPrivateSpecs.push_back(Spec);
+}
+
+void SpecificationScope::AddThreadPrivateSpec(SourceLocation Loc, SourceLocation IDLoc,
+                                              CommonBlockDecl *Block) {
+  StoredThreadPrivateSpec Spec = { Loc, IDLoc, nullptr, Block };
+  ThreadPrivateSpecs.push_back(Spec);
+}
+
+void SpecificationScope::ApplyThreadPrivateSpecs(Sema &Visitor) {
+  for(auto Spec : ThreadPrivateSpecs) {
+    if(Spec.Block)
+      Visitor.ApplyThreadPrivateSpecification(Spec.Loc, Spec.IDLoc,
+                                              Spec.Block);
+    else
+      Visitor.ApplyThreadPrivateSpecification(Spec.Loc, Spec.IDLoc,
+                                              Spec.IDInfo);
+  }
+}
+
+/// The variables in the main program are never shared between the
+/// threads, so they don't have to be saved.
+bool Sema::ApplyThreadPrivateSpecification(SourceLocation Loc, SourceLocation IDLoc,
+                                           const IdentifierInfo *IDInfo) {
+  auto VD = GetVariableForSpecification(Loc, IDInfo, IDLoc, false);
+  if(!VD) return true;
+  if(VD->hasStorageSet()) {
+    if(isa<CommonBlockSet>(VD->getStorageSet())) {
+      Diags.Report(Loc, diag::err_spec_not_applicable_to_common_block)
+        << "threadprivate" << getTokenRange(IDLoc);
+      return true;
+    }
+  }
+  if(!isa<MainProgramDecl>(CurContext) &&
+     !VD->getType().hasAttributeSpec(Qualifiers::AS_save)) {
+    Diags.Report(Loc, diag::err_threadprivate_requires_save)
+      << IDInfo << getTokenRange(IDLoc);
+    return true;
+  }
+  if(VD->isThreadPrivate()) {
+    Diags.Report(Loc, diag::err_spec_qual_reapplication)
+      << "threadprivate" << IDInfo << getTokenRange(IDLoc);
+    return true;
+  }
+  VD->setThreadPrivate();
+  return false;
+}
+
+bool Sema::ApplyThreadPrivateSpecification(SourceLocation Loc, SourceLocation IDLoc,
+                                           CommonBlockDecl *Block) {
+  Block->setThreadPrivate();
+  return false;
+}
+
 void SpecificationScope::AddCommonSpec(SourceLocation Loc, SourceLocation IDLoc,
                                        const IdentifierInfo *IDInfo,
                                        CommonBlockDecl *Block) {
@@ -249,6 +306,7 @@ void Sema::ActOnSpecificationPart() {
   CBBuilder.CreateSets(Context);
 
   CurSpecScope->ApplySaveSpecs(*this);
+  CurSpecScope->ApplyThreadPrivateSpecs(*this);
 }
 
 } // namespace flang
@@ -0,0 +1,385 @@
+//===-- CompileServer.cpp - Persistent compilation server -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A request is a single message which carries the client's standard input,
+// output and error descriptors and the size of the request, followed by
+// the client's working directory and the arguments as null terminated
+// strings. The worker which compiles the request replies with the 32 bit
+// exit status of the compilation.
+//
+// The socket lives in a directory which only its owner can modify, and
+// both ends of a connection check that the peer runs as the same user,
+// since the server compiles the requests with the user's privileges.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CompileServer.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef LLVM_ON_UNIX
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace flang {
+
+#ifdef LLVM_ON_UNIX
+
+/// The standard streams which are passed to the server.
+static const int NumForwardedFDs = 3;
+
+std::string GetDefaultCompileServerSocket() {
+  SmallString<128> Path;
+  auto RuntimeDir = getenv("XDG_RUNTIME_DIR");
+  if(RuntimeDir && *RuntimeDir) {
+    Path = RuntimeDir;
+    llvm::sys::path::append(Path, "flang-server.sock");
+    return Path.str().str();
+  }
+  llvm::sys::path::system_temp_directory(/*ErasedOnReboot=*/true, Path);
+  llvm::sys::path::append(Path, llvm::Twine("flang-server-") +
+                                llvm::Twine(unsigned(getuid())),
+                          "server.sock");
+  return Path.str().str();
+}
+
+/// CheckSocketDirectory - Verifies that the directory of the socket belongs
+/// to the current user and that nobody else can replace the socket in it.
+/// Creates a private directory if it doesn't exist yet and Create is true.
+/// Returns true if the socket can't be used safely.
+static bool CheckSocketDirectory(StringRef SocketPath, bool Create) {
+  std::string Dir = llvm::sys::path::parent_path(SocketPath).str();
+  if(Dir.empty())
+    Dir = ".";
+  struct stat Status;
+  if(lstat(Dir.c_str(), &Status) != 0) {
+    if(errno != ENOENT || !Create || mkdir(Dir.c_str(), 0700) != 0 ||
+       lstat(Dir.c_str(), &Status) != 0) {
+      if(Create)
+        llvm::errs() << "flang: can't create the server directory '" << Dir
+                     << "': " << strerror(errno) << "\n";
+      return true;
+    }
+  }
+  if(!S_ISDIR(Status.st_mode) || Status.st_uid != getuid() ||
+     (Status.st_mode & (S_IWGRP | S_IWOTH))) {
+    llvm::errs() << "flang: the server directory '" << Dir
+                 << "' isn't a private directory of the current user\n";
+    return true;
+  }
+  return false;
+}
+
+/// IsPeerSameUser - Returns true if the other end of the connection runs
+/// as the current user.
+static bool IsPeerSameUser(int Conn) {
+#ifdef SO_PEERCRED
+  ucred Cred;
+  socklen_t Size = sizeof(Cred);
+  if(getsockopt(Conn, SOL_SOCKET, SO_PEERCRED, &Cred, &Size) != 0)
+    return false;
+  return Cred.uid == getuid();
+#else
+  uid_t UID;
+  gid_t GID;
+  if(getpeereid(Conn, &UID, &GID) != 0)
+    return false;
+  return UID == getuid();
+#endif
+}
+
+static bool WriteAll(int FD, const void *Data, size_t Size) {
+  auto Ptr = reinterpret_cast<const char *>(Data);
+  while(Size) {
+    auto Written = write(FD, Ptr, Size);
+    if(Written < 0) {
+      if(errno == EINTR) continue;
+      return true;
+    }
+    Ptr += Written;
+    Size -= Written;
+  }
+  return false;
+}
+
+static bool ReadAll(int FD, void *Data, size_t Size) {
+  auto Ptr = reinterpret_cast<char *>(Data);
+  while(Size) {
+    auto Read = read(FD, Ptr, Size);
+    if(Read < 0) {
+      if(errno == EINTR) continue;
+      return true;
+    }
+    if(Read == 0)
+      return true;
+    Ptr += Read;
+    Size -= Read;
+  }
+  return false;
+}
+
+static bool GetSocketAddress(StringRef SocketPath, sockaddr_un &Addr) {
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  if(SocketPath.size() >= sizeof(Addr.sun_path)) {
+    llvm::errs() << "flang: the server socket path '" << SocketPath
+                 << "' is too long\n";
+    return true;
+  }
+  memcpy(Addr.sun_path, SocketPath.data(), SocketPath.size());
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Server
+//===----------------------------------------------------------------------===//
+
+/// ReceiveRequest - Reads a request, returns true if the request is
+/// malformed.
+static bool ReceiveRequest(int Conn, int (&FDs)[NumForwardedFDs],
+                           std::string &Payload) {
+  uint32_t Size = 0;
+  iovec IOV;
+  IOV.iov_base = &Size;
+  IOV.iov_len = sizeof(Size);
+  char Control[CMSG_SPACE(sizeof(FDs))];
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control;
+  Msg.msg_controllen = sizeof(Control);
+  if(recvmsg(Conn, &Msg, 0) != sizeof(Size))
+    return true;
+
+  auto CMsg = CMSG_FIRSTHDR(&Msg);
+  if(!CMsg || CMsg->cmsg_level != SOL_SOCKET ||
+     CMsg->cmsg_type != SCM_RIGHTS ||
+     CMsg->cmsg_len != CMSG_LEN(sizeof(FDs)))
+    return true;
+  memcpy(FDs, CMSG_DATA(CMsg), sizeof(FDs));
+
+  Payload.resize(Size);
+  return Size && ReadAll(Conn, &Payload[0], Size);
+}
+
+/// CompileRequest - Compiles a request in a worker process.
+/// Doesn't return.
+static void CompileRequest(int Conn, CompileFunction Compile) {
+  int FDs[NumForwardedFDs];
+  std::string Payload;
+  if(ReceiveRequest(Conn, FDs, Payload))
+    _exit(1);
+
+  // The payload is the working directory followed by the arguments.
+  SmallVector<const char *, 32> Args;
+  for(size_t I = 0; I < Payload.size(); I += strlen(&Payload[I]) + 1)
+    Args.push_back(&Payload[I]);
+  if(Args.size() < 2 || chdir(Args[0]) != 0)
+    _exit(1);
+
+  for(int I = 0; I < NumForwardedFDs; ++I) {
+    dup2(FDs[I], I);
+    close(FDs[I]);
+  }
+
+  int32_t Status = Compile(int(Args.size() - 1), Args.data() + 1);
+  llvm::outs().flush();
+  llvm::errs().flush();
+  WriteAll(Conn, &Status, sizeof(Status));
+  _exit(Status);
+}
+
+int RunCompileServer(StringRef SocketPath, unsigned Jobs,
+                     CompileFunction Compile) {
+  sockaddr_un Addr;
+  if(GetSocketAddress(SocketPath, Addr) ||
+     CheckSocketDirectory(SocketPath, /*Create=*/true))
+    return 1;
+
+  // Replace the socket of a previous server, but nothing else.
+  struct stat Status;
+  if(lstat(Addr.sun_path, &Status) == 0) {
+    if(!S_ISSOCK(Status.st_mode) || Status.st_uid != getuid()) {
+      llvm::errs() << "flang: '" << SocketPath
+                   << "' already exists and isn't a server socket\n";
+      return 1;
+    }
+    unlink(Addr.sun_path);
+  }
+
+  int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(Listener < 0) {
+    llvm::errs() << "flang: can't create the server socket: "
+                 << strerror(errno) << "\n";
+    return 1;
+  }
+  if(bind(Listener, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) != 0 ||
+     listen(Listener, 64) != 0) {
+    llvm::errs() << "flang: can't listen on '" << SocketPath << "': "
+                 << strerror(errno) << "\n";
+    close(Listener);
+    return 1;
+  }
+  // A client which disconnects early shouldn't kill the worker.
+  signal(SIGPIPE, SIG_IGN);
+
+  unsigned ActiveWorkers = 0;
+  if(!Jobs) Jobs = 1;
+  while(true) {
+    // Reap the finished workers, and wait for one when the pool is full.
+    while(ActiveWorkers) {
+      int Status;
+      pid_t Pid = waitpid(-1, &Status, ActiveWorkers >= Jobs? 0 : WNOHANG);
+      if(Pid <= 0) {
+        if(Pid < 0 && errno == EINTR) continue;
+        break;
+      }
+      --ActiveWorkers;
+    }
+
+    int Conn = accept(Listener, nullptr, nullptr);
+    if(Conn < 0) {
+      if(errno == EINTR) continue;
+      llvm::errs() << "flang: accept failed: " << strerror(errno) << "\n";
+      break;
+    }
+    if(!IsPeerSameUser(Conn)) {
+      close(Conn);
+      continue;
+    }
+
+    pid_t Pid = fork();
+    if(Pid == 0) {
+      close(Listener);
+      CompileRequest(Conn, Compile);
+    }
+    if(Pid > 0)
+      ++ActiveWorkers;
+    else
+      llvm::errs() << "flang: fork failed: " << strerror(errno) << "\n";
+    close(Conn);
+  }
+
+  close(Listener);
+  unlink(Addr.sun_path);
+  return 1;
+}
+
+//===----------------------------------------------------------------------===//
+// Client
+//===----------------------------------------------------------------------===//
+
+static bool SendRequest(int Conn, const std::string &Payload) {
+  uint32_t Size = Payload.size();
+  iovec IOV;
+  IOV.iov_base = &Size;
+  IOV.iov_len = sizeof(Size);
+  int FDs[NumForwardedFDs] = { 0, 1, 2 };
+  char Control[CMSG_SPACE(sizeof(FDs))];
+  memset(Control, 0, sizeof(Control));
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control;
+  Msg.msg_controllen = sizeof(Control);
+  auto CMsg = CMSG_FIRSTHDR(&Msg);
+  CMsg->cmsg_level = SOL_SOCKET;
+  CMsg->cmsg_type = SCM_RIGHTS;
+  CMsg->cmsg_len = CMSG_LEN(sizeof(FDs));
+  memcpy(CMSG_DATA(CMsg), FDs, sizeof(FDs));
+
+  if(sendmsg(Conn, &Msg, 0) != sizeof(Size))
+    return true;
+  return WriteAll(Conn, Payload.data(), Payload.size());
+}
+
+bool RunCompileClient(StringRef SocketPath, ArrayRef<const char *> Args,
+                      int &ExitStatus) {
+  sockaddr_un Addr;
+  if(GetSocketAddress(SocketPath, Addr) ||
+     CheckSocketDirectory(SocketPath, /*Create=*/false))
+    return true;
+  int Conn = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(Conn < 0)
+    return true;
+  if(connect(Conn, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) != 0) {
+    close(Conn);
+    return true;
+  }
+  if(!IsPeerSameUser(Conn)) {
+    llvm::errs() << "flang: the compile server at '" << SocketPath
+                 << "' runs as a different user\n";
+    close(Conn);
+    return true;
+  }
+
+  std::string Payload;
+  char CWD[4096];
+  if(!getcwd(CWD, sizeof(CWD))) {
+    close(Conn);
+    return true;
+  }
+  Payload.append(CWD);
+  Payload.push_back('\0');
+  for(auto Arg : Args) {
+    Payload.append(Arg);
+    Payload.push_back('\0');
+  }
+
+  // The output is written to our streams directly by the server.
+  llvm::outs().flush();
+  int32_t Status = 1;
+  if(SendRequest(Conn, Payload)) {
+    close(Conn);
+    return true;
+  }
+  if(ReadAll(Conn, &Status, sizeof(Status))) {
+    llvm::errs() << "flang: the compile server didn't finish the compilation\n";
+    Status = 1;
+  }
+  close(Conn);
+  ExitStatus = Status;
+  return false;
+}
+
+#else
+
+std::string GetDefaultCompileServerSocket() {
+  return "";
+}
+
+int RunCompileServer(StringRef SocketPath, unsigned Jobs,
+                     CompileFunction Compile) {
+  llvm::errs() << "flang: the compile server isn't supported on this host\n";
+  return 1;
+}
+
+bool RunCompileClient(StringRef SocketPath, ArrayRef<const char *> Args,
+                      int &ExitStatus) {
+  return true;
+}
+
+#endif
+
+} // end namespace flang
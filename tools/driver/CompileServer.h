@@ -0,0 +1,51 @@
+//===-- CompileServer.h - Persistent compilation server ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The compile server keeps an initialized compiler running, and compiles
+// the command lines which are forwarded to it by the driver over a local
+// socket.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FLANG_DRIVER_COMPILESERVER_H
+#define FLANG_DRIVER_COMPILESERVER_H
+
+#include "flang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace flang {
+
+/// CompileFunction - Compiles the given command line, and
+/// returns the exit status of the compilation.
+typedef int (*CompileFunction)(int argc, const char **argv);
+
+/// \brief Returns the default path of the server's socket, which is in
+/// $XDG_RUNTIME_DIR, or in a private per-user temporary directory.
+std::string GetDefaultCompileServerSocket();
+
+/// RunCompileServer - Accepts the compilation requests on the given socket
+/// until the server is killed. Every request is compiled in a worker
+/// process which is forked from the server, so the workers start with
+/// the already initialized targets. At most Jobs requests are compiled
+/// at the same time. Returns the exit status of the server.
+int RunCompileServer(StringRef SocketPath, unsigned Jobs,
+                     CompileFunction Compile);
+
+/// RunCompileClient - Forwards the given command line, the working directory
+/// and the standard streams to the server. Returns false and sets the
+/// exit status if the server has compiled the request, or true if the
+/// server can't be reached and the request should be compiled locally.
+bool RunCompileClient(StringRef SocketPath, ArrayRef<const char *> Args,
+                      int &ExitStatus);
+
+} // end namespace flang
+
+#endif
@@ -12,6 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "CompileServer.h"
+#include "flang/Basic/StreamedSource.h"
 #include "flang/Frontend/TextDiagnosticPrinter.h"
 #include "flang/Frontend/VerifyDiagnosticConsumer.h"
 #include "flang/AST/ASTConsumer.h"
@@ -42,6 +44,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/raw_ostream.h"
@@ -77,6 +80,8 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
 #include <memory>
+#include <thread>
+#include <tuple>
 
 using namespace llvm;
 using namespace flang;
@@ -94,6 +99,9 @@ namespace {
   IncludeDirs("I", cl::desc("Directory of include files"),
               cl::value_desc("directory"), cl::Prefix);
 
+  cl::opt<bool>
+  SpliceIncludes("fsplice-includes", cl::desc("Read every included file only once, and notify the diagnostic client only about the outermost included files"), cl::init(false));
+
   cl::opt<bool>
   ReturnComments("C", cl::desc("Do not discard comments"), cl::init(false));
 
@@ -103,12 +111,21 @@ namespace {
   cl::opt<bool>
   SyntaxOnly("fsyntax-only", cl::desc("Do not compile code"), cl::init(false));
 
+  cl::opt<bool>
+  DeferExecutionParts("fdefer-execution-parts", cl::desc("Parse the execution parts of the program units after the specification parts of all the units"), cl::init(false));
+
+  cl::opt<bool>
+  SkipExecutionParts("fskip-execution-parts", cl::desc("Check only the specification parts of the program units with -fsyntax-only"), cl::init(false));
+
   cl::opt<bool>
   PrintAST("ast-print", cl::desc("Prints AST"), cl::init(false));
 
   cl::opt<bool>
   DumpAST("ast-dump", cl::desc("Dumps AST"), cl::init(false));
 
+  cl::opt<bool>
+  PrintStats("print-stats", cl::desc("Print the number and the size of the AST nodes"), cl::init(false));
+
   cl::opt<bool>
   EmitLLVM("emit-llvm", cl::desc("Emit llvm"), cl::init(false));
 
@@ -121,6 +138,47 @@ namespace {
   cl::opt<int>
   OptLevel("O", cl::desc("optimization level"), cl::init(0), cl::Prefix);
 
+  cl::opt<bool>
+  LoopIdiom("floop-idiom", cl::desc("Rewrite the DO loops which implement common array operations"), cl::init(false));
+
+  cl::opt<bool>
+  LoopInterchange("floop-interchange", cl::desc("Interchange and tile the DO loop nests which access arrays with a large stride"), cl::init(false));
+
+  cl::opt<bool>
+  FastMath("ffast-math", cl::desc("Allow the floating point optimizations which ignore the rounding, infinities and NaNs"), cl::init(false));
+
+  cl::opt<bool>
+  ThreadLocalCommon("fthread-local-common", cl::desc("Give every thread its own copy of the COMMON blocks and SAVE variables"), cl::init(false));
+
+  cl::opt<bool>
+  WholeProgram("fwhole-program", cl::desc("Assume that the source file is the whole program, pass the unmodified scalar arguments by value and clone the procedures for constant array dimensions"), cl::init(false));
+
+  cl::opt<bool>
+  InlineSmallProcedures("finline-small-procedures", cl::desc("Inline the calls to tiny leaf procedures during code generation, even without optimizations"), cl::init(false));
+
+  cl::opt<unsigned>
+  CodeGenThreads("fcodegen-threads", cl::desc("The number of threads which generate the code of the program units concurrently"), cl::init(0));
+
+  cl::list<std::string>
+  SoADerivedTypes("fsoa-derived-types", cl::desc("Store the local arrays of the given derived types with one array per component"),
+                  cl::value_desc("types"), cl::CommaSeparated);
+
+  cl::list<std::string>
+  Checks("fcheck", cl::desc("Enable the runtime checks (bounds, all)"),
+         cl::value_desc("checks"), cl::CommaSeparated);
+
+  cl::opt<std::string>
+  DenormalFPMath("fdenormal-fp-math", cl::desc("The handling of denormal floating point values (ieee, preserve-sign, positive-zero)"),
+                 cl::init("ieee"));
+
+  cl::list<std::string>
+  FPETraps("ffpe-trap", cl::desc("Trap on the given floating point exceptions (invalid, zero, overflow, underflow, inexact)"),
+           cl::value_desc("exceptions"), cl::CommaSeparated);
+
+  cl::list<std::string>
+  Remarks("R", cl::desc("Enable the optimization remarks in the given group"),
+          cl::value_desc("group"), cl::Prefix);
+
   cl::opt<bool>
   EmitDebugInfo("g", cl::desc("Emit debugging info"), cl::init(false));
 
@@ -139,6 +197,32 @@ namespace {
   cl::opt<std::string>
   TargetTriple("triple", cl::desc("target triple"), cl::init(""));
 
+  // The server reads -server and -server-jobs with ParseServerArgs, they
+  // are declared here for -help.
+  cl::opt<bool>
+  ServerMode("server", cl::desc("Run a compile server which compiles the command lines forwarded by -use-server"), cl::init(false));
+
+  cl::opt<bool>
+  UseServer("use-server", cl::desc("Forward the compilation to a running compile server"), cl::init(false));
+
+  cl::opt<std::string>
+  ServerSocket("server-socket", cl::desc("The socket of the compile server"), cl::value_desc("path"), cl::init(""));
+
+  cl::opt<unsigned>
+  ServerJobs("server-jobs", cl::desc("The number of compilations which the compile server runs at the same time"), cl::init(0));
+
+  cl::opt<unsigned>
+  ErrorLimit("ferror-limit", cl::desc("Stop showing the errors after the given number of errors (0 = no limit)"), cl::value_desc("N"), cl::init(0));
+
+  cl::opt<unsigned>
+  WarningLimit("fwarning-limit", cl::desc("Stop showing the warnings after the given number of warnings (0 = no limit)"), cl::value_desc("N"), cl::init(0));
+
+  cl::opt<bool>
+  StreamInput("stream-input", cl::desc("Read the input in chunks while it is parsed (the default for the standard input and pipes)"), cl::init(false));
+
+  cl::opt<unsigned>
+  InputChunkSize("input-chunk-size", cl::desc("The size of the chunks of a streamed input in bytes"), cl::value_desc("bytes"), cl::init(0));
+
   cl::opt<bool>
   DefaultReal8("fdefault-real-8", cl::desc("set the kind of the default real type to 8"), cl::init(false));
 
@@ -381,26 +465,57 @@ static bool ParseLineLengthArg(cl::opt<std::string> &Arg, unsigned &Val) {
   return false;
 }
 
-static bool ParseFile(const std::string &Filename,
-                      const std::vector<std::string> &IncludeDirs,
-                      SmallVectorImpl<std::string> &OutputFiles) {
-  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
-      MemoryBuffer::getFileOrSTDIN(Filename);
-  if (std::error_code EC = MBOrErr.getError()) {
-    llvm::errs() << "Could not open input file '" << Filename << "': " 
-                 << EC.message() <<"\n";
+// Parse the floating point environment arguments (-fdenormal-fp-math,
+// -ffpe-trap) into the code generation options.
+static bool ParseFPEnvironmentArgs(CodeGenOptions &CGOpts) {
+  if(DenormalFPMath == "ieee")
+    CGOpts.setFPDenormalMode(CodeGenOptions::FPD_IEEE);
+  else if(DenormalFPMath == "preserve-sign")
+    CGOpts.setFPDenormalMode(CodeGenOptions::FPD_PreserveSign);
+  else if(DenormalFPMath == "positive-zero")
+    CGOpts.setFPDenormalMode(CodeGenOptions::FPD_PositiveZero);
+  else {
+    DenormalFPMath.error("'" + DenormalFPMath + "' value invalid");
     return true;
   }
-  std::unique_ptr<llvm::MemoryBuffer> MB = std::move(MBOrErr.get());
 
+  for(auto Trap : FPETraps) {
+    unsigned Exception = llvm::StringSwitch<unsigned>(Trap)
+      .Case("invalid", CodeGenOptions::FPE_Invalid)
+      .Case("zero", CodeGenOptions::FPE_Zero)
+      .Case("overflow", CodeGenOptions::FPE_Overflow)
+      .Case("underflow", CodeGenOptions::FPE_Underflow)
+      .Case("inexact", CodeGenOptions::FPE_Inexact)
+      .Default(0);
+    if(!Exception) {
+      FPETraps.error("'" + Trap + "' value invalid");
+      return true;
+    }
+    CGOpts.FPExceptionTraps |= Exception;
+  }
+  return false;
+}
+
+/// IsStreamedInput - Returns true if the input can't be mapped into memory,
+/// like the standard input or a pipe.
+static bool IsStreamedInput(StringRef Filename) {
+  if (Filename == "-")
+    return true;
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Filename, Status))
+    return false;
+  return Status.type() == llvm::sys::fs::file_type::fifo_file ||
+         Status.type() == llvm::sys::fs::file_type::character_file;
+}
+
+static bool ParseFile(const std::string &Filename,
+                      const std::vector<std::string> &IncludeDirs,
+                      SmallVectorImpl<std::string> &OutputFiles) {
   // Record the location of the include directory so that the lexer can find it
   // later.
   SourceMgr SrcMgr;
   SrcMgr.setIncludeDirs(IncludeDirs);
 
-  // Tell SrcMgr about this buffer, which is what Parser will pick up.
-  SrcMgr.AddNewSourceBuffer(std::move(MB), llvm::SMLoc());
-
   LangOptions Opts;
   Opts.DefaultReal8 = DefaultReal8;
   Opts.DefaultDouble8 = DefaultDouble8;
@@ -433,19 +548,71 @@ static bool ParseFile(const std::string &Filename,
   if (Opts.FixedForm && !FixedFormLineLength.empty())
     Opts.LineLength = LineLength;
 
+  // The standard input and the pipes are read in chunks while they are
+  // parsed, so they don't have to be read completely first.
+  std::unique_ptr<StreamedSource> Streamed;
+  if (StreamInput || IsStreamedInput(Filename)) {
+    size_t ChunkSize = StreamedSource::DefaultChunkSize;
+    if (InputChunkSize)
+      ChunkSize = InputChunkSize;
+    Streamed.reset(new StreamedSource(SrcMgr, Opts.FixedForm, ChunkSize));
+    if (std::error_code EC = Streamed->Open(Filename)) {
+      llvm::errs() << "Could not open input file '" << Filename << "': "
+                   << EC.message() <<"\n";
+      return true;
+    }
+    // The first chunk is the main buffer, which the Parser will pick up.
+    Streamed->ReadNextChunk();
+  } else {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+        MemoryBuffer::getFileOrSTDIN(Filename);
+    if (std::error_code EC = MBOrErr.getError()) {
+      llvm::errs() << "Could not open input file '" << Filename << "': "
+                   << EC.message() <<"\n";
+      return true;
+    }
+
+    // Tell SrcMgr about this buffer, which is what Parser will pick up.
+    SrcMgr.AddNewSourceBuffer(std::move(MBOrErr.get()), llvm::SMLoc());
+  }
+
   TextDiagnosticPrinter TDP(SrcMgr);
+  TDP.setStreamedSource(Streamed.get());
   DiagnosticsEngine Diag(new DiagnosticIDs,&SrcMgr, &TDP, false);
+  Diag.setErrorLimit(ErrorLimit);
+  Diag.setWarningLimit(WarningLimit);
   // Chain in -verify checker, if requested.
   if(RunVerifier)
     Diag.setClient(new VerifyDiagnosticConsumer(Diag));
+  for(auto Group : Remarks) {
+    if(Diag.setDiagnosticGroupMapping(Group, diag::MAP_WARNING)) {
+      Remarks.error("unknown remark group '" + Group + "'");
+      return true;
+    }
+  }
+
+  if(PrintStats) {
+    Expr::EnableStatistics();
+    Stmt::EnableStatistics();
+  }
 
   ASTContext Context(SrcMgr, Opts);
   Sema SA(Context, Diag);
   Parser P(SrcMgr, Opts, Diag, SA);
+  P.setStreamedSource(Streamed.get());
+  P.setSpliceIncludes(SpliceIncludes);
+  // The code can't be generated without the execution parts.
+  if(SkipExecutionParts && SyntaxOnly)
+    P.setExecutionPartMode(Parser::EP_Skip);
+  else if(SkipExecutionParts || DeferExecutionParts)
+    P.setExecutionPartMode(Parser::EP_Defer);
   Diag.getClient()->BeginSourceFile(Opts, &P.getLexer());
   P.ParseProgramUnits();
   Diag.getClient()->EndSourceFile();
 
+  if(PrintStats)
+    Context.PrintStats();
+
   // Dump
   if(PrintAST || DumpAST) {
     auto Dumper = CreateASTDumper("");
@@ -460,8 +627,32 @@ static bool ParseFile(const std::string &Filename,
                                                  TargetTriple;
     TargetOptions.CPU = llvm::sys::getHostCPUName();
 
+    CodeGenOptions CGOpts;
+    CGOpts.OptimizationLevel = OptLevel;
+    if(ParseFPEnvironmentArgs(CGOpts))
+      return true;
+    for(auto Check : Checks) {
+      if(Check == "bounds" || Check == "all")
+        CGOpts.BoundsCheck = 1;
+      else {
+        Checks.error("unknown runtime check '" + Check + "'");
+        return true;
+      }
+    }
+    CGOpts.UnsafeFPMath = FastMath;
+    CGOpts.NoInfsFPMath = FastMath;
+    CGOpts.NoNaNsFPMath = FastMath;
+    CGOpts.ThreadLocalCommon = ThreadLocalCommon;
+    CGOpts.LoopIdiomRecognize = LoopIdiom;
+    CGOpts.LoopInterchange = LoopInterchange;
+    CGOpts.WholeProgram = WholeProgram;
+    CGOpts.InlineSmallProcedures = InlineSmallProcedures;
+    CGOpts.CodeGenThreads = CodeGenThreads;
+    for(auto &Name : SoADerivedTypes)
+      CGOpts.SoADerivedTypes.push_back(StringRef(Name).lower());
+
     auto CG = CreateLLVMCodeGen(Diag, Filename == ""? std::string("module") : Filename,
-                                CodeGenOptions(), TargetOptions, llvm::getGlobalContext());
+                                CGOpts, TargetOptions, llvm::getGlobalContext());
     CG->Initialize(Context);
     CG->HandleTranslationUnit(Context);
 
@@ -492,6 +683,9 @@ static bool ParseFile(const std::string &Filename,
       //FPM->add(new DataLayoutPass());
       //PM->add(new llvm::DataLayoutPass());
       //TM->addAnalysisPasses(*PM);
+      // The vectorizers need the target's cost model to see its vector
+      // registers.
+      PM->add(createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
       PM->add(createPromoteMemoryToRegisterPass());
 
       PassManagerBuilder PMBuilder;
@@ -515,6 +709,10 @@ static bool ParseFile(const std::string &Filename,
       //delete MPM;
     }
 
+    // The code generator reports its remarks and warnings after the source
+    // file has ended, so write them out before the output can reach stdout.
+    TDP.flush();
+
     if (Interpret) {
       //const char *Env[] = { "", nullptr };
       //Execute(CG->ReleaseModule(), Env);
@@ -532,23 +730,9 @@ static bool ParseFile(const std::string &Filename,
   return Diag.hadErrors();
 }
 
-int main(int argc, char **argv) {
-  sys::PrintStackTraceOnErrorSignal();
-  PrettyStackTraceProgram X(argc, argv);
-  cl::ParseCommandLineOptions(argc, argv, "LLVM Fortran compiler");
-
-  bool CanonicalPrefixes = true;
-  for (int i = 1; i < argc; ++i)
-    if (llvm::StringRef(argv[i]) == "-no-canonical-prefixes") {
-      CanonicalPrefixes = false;
-      break;
-    }
-
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmPrinters();
-  llvm::InitializeAllAsmParsers();
-
+/// CompileInputFiles - Compiles and links the input files from the
+/// command line. Returns true if there were errors.
+static bool CompileInputFiles() {
   // Parse the input file.
   bool HadErrors = false;
   SmallVector <std::string, 32> OutputFiles;
@@ -570,6 +754,120 @@ int main(int argc, char **argv) {
   // If any timers were active but haven't been destroyed yet, print their
   // results now. This happens in -disable-free mode.
   llvm::TimerGroup::printAll(llvm::errs());
+  return HadErrors;
+}
+
+/// CompileServerRequest - Compiles a command line which was forwarded
+/// to the compile server. This runs in a worker forked from the server.
+static int CompileServerRequest(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "LLVM Fortran compiler");
+  return CompileInputFiles();
+}
+
+/// IsServerCommandLine - Returns true if the command line starts
+/// a compile server.
+static bool IsServerCommandLine(int argc, char **argv) {
+  for(int I = 1; I < argc; ++I) {
+    llvm::StringRef Arg = argv[I];
+    if(Arg == "-server" || Arg == "--server")
+      return true;
+  }
+  return false;
+}
+
+/// ParseServerArgs - Reads the arguments of the compile server. The server
+/// doesn't parse its command line with the option parser, so every worker
+/// parses the forwarded command line starting from the default values of
+/// the options. Returns true if an argument is invalid.
+static bool ParseServerArgs(int argc, char **argv, std::string &SocketPath,
+                            unsigned &Jobs) {
+  for(int I = 1; I < argc; ++I) {
+    llvm::StringRef Arg = argv[I];
+    if(Arg.startswith("--"))
+      Arg = Arg.drop_front();
+    if(Arg == "-server")
+      continue;
+    bool HasValue = Arg.find('=') != llvm::StringRef::npos;
+    llvm::StringRef Name, Value;
+    std::tie(Name, Value) = Arg.split('=');
+    if(Name != "-server-socket" && Name != "-server-jobs") {
+      errs() << "flang: the compile server doesn't accept the option '"
+             << argv[I] << "'\n";
+      return true;
+    }
+    if(!HasValue) {
+      if(++I == argc) {
+        errs() << "flang: missing the value of '" << Name << "'\n";
+        return true;
+      }
+      Value = argv[I];
+    }
+    if(Name == "-server-socket")
+      SocketPath = Value;
+    else if(Value.getAsInteger(10, Jobs)) {
+      errs() << "flang: invalid number of server jobs '" << Value << "'\n";
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  if(IsServerCommandLine(argc, argv)) {
+    std::string SocketPath;
+    unsigned Jobs = 0;
+    if(ParseServerArgs(argc, argv, SocketPath, Jobs))
+      return 1;
+    if(SocketPath.empty())
+      SocketPath = GetDefaultCompileServerSocket();
+    if(!Jobs)
+      Jobs = std::thread::hardware_concurrency();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmPrinters();
+    llvm::InitializeAllAsmParsers();
+    return RunCompileServer(SocketPath, Jobs, CompileServerRequest);
+  }
+
+  cl::ParseCommandLineOptions(argc, argv, "LLVM Fortran compiler");
+
+  if(UseServer) {
+    std::string SocketPath = ServerSocket.empty()?
+                               GetDefaultCompileServerSocket() : ServerSocket;
+    // The socket options are handled by the client.
+    SmallVector<const char *, 32> Args;
+    for(int I = 0; I < argc; ++I) {
+      llvm::StringRef Arg = argv[I];
+      if(Arg == "-server-socket" || Arg == "--server-socket") {
+        ++I;
+        continue;
+      }
+      if(Arg.startswith("-server-socket=") || Arg.startswith("--server-socket="))
+        continue;
+      Args.push_back(argv[I]);
+    }
+    int ExitStatus;
+    if(!RunCompileClient(SocketPath, Args, ExitStatus))
+      return ExitStatus;
+    // The server isn't running, compile locally.
+  }
+
+  bool CanonicalPrefixes = true;
+  for (int i = 1; i < argc; ++i)
+    if (llvm::StringRef(argv[i]) == "-no-canonical-prefixes") {
+      CanonicalPrefixes = false;
+      break;
+    }
+
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::InitializeAllAsmParsers();
+
+  bool HadErrors = CompileInputFiles();
 
   llvm::llvm_shutdown();
   return HadErrors;
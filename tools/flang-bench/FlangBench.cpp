@@ -0,0 +1,286 @@
+//===-- FlangBench.cpp - Compiler throughput benchmarks -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the throughput of the lexer, the parser and semantic analysis,
+// and the LLVM IR generation on a generated Fortran program.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceGenerator.h"
+#include "flang/AST/ASTContext.h"
+#include "flang/Basic/Diagnostic.h"
+#include "flang/CodeGen/ModuleBuilder.h"
+#include "flang/Frontend/TextDiagnosticPrinter.h"
+#include "flang/Parse/Lexer.h"
+#include "flang/Parse/Parser.h"
+#include "flang/Sema/Sema.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace llvm;
+using namespace flang;
+
+//===----------------------------------------------------------------------===//
+// Command line options.
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+  cl::list<std::string>
+  Benchmarks("bench", cl::desc("The benchmarks to run (lex, parse, codegen)"),
+             cl::value_desc("benchmarks"), cl::CommaSeparated);
+
+  cl::opt<unsigned>
+  Iterations("iterations", cl::desc("The number of runs of every benchmark"), cl::init(5));
+
+  cl::opt<unsigned>
+  ProgramUnits("units", cl::desc("The number of subroutines in the generated program"), cl::init(100));
+
+  cl::opt<unsigned>
+  Continuations("continuations", cl::desc("The number of continuation lines in the long statements"), cl::init(20));
+
+  cl::opt<unsigned>
+  DataElements("data-elements", cl::desc("The number of array elements initialized by every DATA statement"), cl::init(256));
+
+  cl::opt<unsigned>
+  Seed("seed", cl::desc("The seed of the source generator"), cl::init(1));
+
+  cl::opt<bool>
+  FixedForm("ffixed-form", cl::desc("Generate fixed form source"), cl::init(false));
+
+  cl::opt<bool>
+  PrintSource("print-source", cl::desc("Print the generated program and exit"), cl::init(false));
+
+}
+
+//===----------------------------------------------------------------------===//
+// Memory accounting.
+//===----------------------------------------------------------------------===//
+
+/// The number of bytes allocated by the global operator new.
+static size_t HeapAllocatedBytes = 0;
+
+void *operator new(size_t Size) {
+  HeapAllocatedBytes += Size;
+  if(void *Result = std::malloc(Size? Size : 1))
+    return Result;
+  llvm::report_fatal_error("out of memory");
+}
+
+void operator delete(void *Ptr) throw() {
+  std::free(Ptr);
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmarks.
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// BenchmarkResult - The cost of one benchmark run.
+struct BenchmarkResult {
+  double Seconds;
+  size_t HeapBytes;
+  size_t ASTBytes;
+
+  BenchmarkResult()
+    : Seconds(0.0), HeapBytes(0), ASTBytes(0) {}
+};
+
+/// BenchmarkTimer - Measures the time and the memory of a benchmark run.
+class BenchmarkTimer {
+  BenchmarkResult &Result;
+  double Start;
+  size_t StartBytes;
+public:
+  BenchmarkTimer(BenchmarkResult &R)
+    : Result(R), Start(TimeRecord::getCurrentTime(true).getWallTime()),
+      StartBytes(HeapAllocatedBytes) {}
+  ~BenchmarkTimer() {
+    Result.Seconds = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+    Result.HeapBytes = HeapAllocatedBytes - StartBytes;
+  }
+};
+
+/// BenchmarkInput - The generated program and the options
+/// it is compiled with.
+class BenchmarkInput {
+  std::string Source;
+  LangOptions Opts;
+  unsigned Lines;
+
+  std::unique_ptr<TextDiagnosticPrinter> DiagPrinter;
+  std::unique_ptr<DiagnosticsEngine> Diag;
+public:
+  SourceMgr SrcMgr;
+
+  BenchmarkInput(const std::string &Src, unsigned NumLines, bool IsFixedForm)
+    : Source(Src), Lines(NumLines) {
+    if(IsFixedForm) {
+      Opts.FixedForm = 1;
+      Opts.FreeForm = 0;
+      Opts.LineLength = 72;
+    }
+    SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBufferCopy(Source, "bench"),
+                              llvm::SMLoc());
+    DiagPrinter.reset(new TextDiagnosticPrinter(SrcMgr));
+    Diag.reset(new DiagnosticsEngine(new DiagnosticIDs, &SrcMgr,
+                                     DiagPrinter.get(), false));
+  }
+
+  const LangOptions &getLangOpts() const { return Opts; }
+  DiagnosticsEngine &getDiagnostics() { return *Diag; }
+  unsigned getNumLines() const { return Lines; }
+};
+
+} // end anonymous namespace
+
+static bool RunLexer(BenchmarkInput &Input, BenchmarkResult &Result) {
+  auto &Diag = Input.getDiagnostics();
+  BenchmarkTimer Timer(Result);
+  Lexer L(Input.SrcMgr, Input.getLangOpts(), Diag);
+  L.setBuffer(Input.SrcMgr.getMemoryBuffer(Input.SrcMgr.getMainFileID()));
+  Token Tok;
+  do {
+    L.Lex(Tok);
+  } while(Tok.isNot(tok::eof));
+  return Diag.hadErrors();
+}
+
+static bool RunParser(BenchmarkInput &Input, BenchmarkResult &Result) {
+  auto &Diag = Input.getDiagnostics();
+  BenchmarkTimer Timer(Result);
+  ASTContext Context(Input.SrcMgr, Input.getLangOpts());
+  Sema SA(Context, Diag);
+  Parser P(Input.SrcMgr, Input.getLangOpts(), Diag, SA);
+  Diag.getClient()->BeginSourceFile(Input.getLangOpts(), &P.getLexer());
+  P.ParseProgramUnits();
+  Diag.getClient()->EndSourceFile();
+  Result.ASTBytes = Context.getASTAllocatedMemory();
+  return Diag.hadErrors();
+}
+
+static bool RunCodeGen(BenchmarkInput &Input, BenchmarkResult &Result) {
+  auto &Diag = Input.getDiagnostics();
+  ASTContext Context(Input.SrcMgr, Input.getLangOpts());
+  Sema SA(Context, Diag);
+  Parser P(Input.SrcMgr, Input.getLangOpts(), Diag, SA);
+  Diag.getClient()->BeginSourceFile(Input.getLangOpts(), &P.getLexer());
+  P.ParseProgramUnits();
+  Diag.getClient()->EndSourceFile();
+  if(Diag.hadErrors())
+    return true;
+
+  flang::TargetOptions TargetOptions;
+  TargetOptions.Triple = llvm::sys::getDefaultTargetTriple();
+  TargetOptions.CPU = llvm::sys::getHostCPUName();
+  CodeGenOptions CGOpts;
+
+  LLVMContext VMContext;
+  BenchmarkTimer Timer(Result);
+  std::unique_ptr<CodeGenerator> CG(CreateLLVMCodeGen(Diag, "bench", CGOpts,
+                                                      TargetOptions,
+                                                      VMContext));
+  CG->Initialize(Context);
+  CG->HandleTranslationUnit(Context);
+  return Diag.hadErrors();
+}
+
+typedef bool (*BenchmarkFunction)(BenchmarkInput &, BenchmarkResult &);
+
+/// RunBenchmark - Runs the given benchmark a number of times, and
+/// reports the fastest run.
+static bool RunBenchmark(StringRef Name, BenchmarkFunction Function,
+                         BenchmarkInput &Input) {
+  BenchmarkResult Best;
+  for(unsigned I = 0; I < std::max(1u, unsigned(Iterations)); ++I) {
+    BenchmarkResult Result;
+    if(Function(Input, Result)) {
+      llvm::errs() << "flang-bench: the generated program has errors\n";
+      return true;
+    }
+    if(I == 0 || Result.Seconds < Best.Seconds)
+      Best = Result;
+  }
+
+  double LinesPerSecond = Best.Seconds > 0.0?
+                            double(Input.getNumLines()) / Best.Seconds : 0.0;
+  llvm::outs() << llvm::format("%-8s %10.4f s %12.0f lines/s %12zu heap bytes"
+                               " %12zu AST bytes\n",
+                               Name.str().c_str(), Best.Seconds,
+                               LinesPerSecond, Best.HeapBytes, Best.ASTBytes);
+  return false;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "Fortran compiler benchmarks");
+
+  bench::SourceGeneratorOptions GenOpts;
+  GenOpts.FixedForm = FixedForm;
+  GenOpts.ProgramUnits = ProgramUnits;
+  GenOpts.Continuations = Continuations;
+  GenOpts.DataElements = std::max(1u, unsigned(DataElements));
+  GenOpts.Seed = Seed;
+
+  std::string Source;
+  llvm::raw_string_ostream OS(Source);
+  unsigned Lines = bench::SourceGenerator(GenOpts, OS).Generate();
+  OS.flush();
+  if(PrintSource) {
+    llvm::outs() << Source;
+    return 0;
+  }
+
+  if(Benchmarks.empty()) {
+    Benchmarks.push_back("lex");
+    Benchmarks.push_back("parse");
+    Benchmarks.push_back("codegen");
+  }
+
+  llvm::outs() << Lines << " lines, " << Source.size() << " bytes of "
+               << (FixedForm? "fixed" : "free") << " form source\n";
+
+  BenchmarkInput Input(Source, Lines, FixedForm);
+  bool HadErrors = false;
+  for(const auto &Name : Benchmarks) {
+    BenchmarkFunction Function = StringSwitch<BenchmarkFunction>(Name)
+      .Case("lex", RunLexer)
+      .Case("parse", RunParser)
+      .Case("codegen", RunCodeGen)
+      .Default(nullptr);
+    if(!Function) {
+      Benchmarks.error("unknown benchmark '" + Name + "'");
+      HadErrors = true;
+      break;
+    }
+    if(RunBenchmark(Name, Function, Input)) {
+      HadErrors = true;
+      break;
+    }
+  }
+
+  llvm::llvm_shutdown();
+  return HadErrors;
+}
@@ -0,0 +1,150 @@
+//===--- SourceGenerator.cpp - Generator of Fortran benchmark inputs ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceGenerator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+
+namespace flang {
+namespace bench {
+
+/// The number of common blocks which are shared by the subroutines.
+static const unsigned NumCommonBlocks = 8;
+
+SourceGenerator::SourceGenerator(const SourceGeneratorOptions &Options,
+                                 llvm::raw_ostream &Out)
+  : Opts(Options), OS(Out), State(Options.Seed), Lines(0) {}
+
+unsigned SourceGenerator::Random(unsigned Max) {
+  // A linear congruential generator, the results don't depend
+  // on the standard library.
+  State = State * 1103515245u + 12345u;
+  return (State >> 16) % Max;
+}
+
+void SourceGenerator::EmitLine(llvm::StringRef Line) {
+  OS << (Opts.FixedForm? "      " : "  ") << Line << "\n";
+  ++Lines;
+}
+
+void SourceGenerator::EmitContinuedStmt(llvm::StringRef First,
+                                        llvm::ArrayRef<std::string> Parts,
+                                        llvm::StringRef Last) {
+  if(Opts.FixedForm) {
+    OS << "      " << First << "\n";
+    for(const auto &Part : Parts)
+      OS << "     &" << Part << "\n";
+    OS << "     &" << Last << "\n";
+  } else {
+    OS << "  " << First << " &\n";
+    for(const auto &Part : Parts)
+      OS << "    & " << Part << " &\n";
+    OS << "    & " << Last << "\n";
+  }
+  Lines += Parts.size() + 2;
+}
+
+void SourceGenerator::EmitSubroutine(unsigned I) {
+  std::string Name = (llvm::Twine("SUB") + llvm::Twine(I)).str();
+  std::string DataSize = llvm::Twine(Opts.DataElements).str();
+  std::string Block = (llvm::Twine("BLK") +
+                       llvm::Twine(I % NumCommonBlocks)).str();
+
+  EmitLine("SUBROUTINE " + Name + "(A, N)");
+  EmitLine("INTEGER N, I, J");
+  EmitLine("REAL A(N), B(64), C(8, 8), S");
+  EmitLine("INTEGER K(" + DataSize + ")");
+  EmitLine("REAL X, Y, Z(16)");
+  EmitLine("COMMON /" + Block + "/ X, Y, Z");
+  EmitLine("EQUIVALENCE (B(1), C(1, 1))");
+  EmitLine("SAVE S");
+
+  // The values of the DATA statement are split into the continuation
+  // lines which fit into the fixed form line length.
+  llvm::SmallVector<std::string, 32> Parts;
+  std::string Part;
+  for(unsigned J = 0; J < Opts.DataElements; ++J) {
+    Part += llvm::Twine(Random(100)).str();
+    if(J + 1 == Opts.DataElements)
+      break;
+    Part += ", ";
+    if(Part.size() > 56) {
+      Parts.push_back(Part);
+      Part.clear();
+    }
+  }
+  EmitContinuedStmt("DATA (K(J), J = 1, " + DataSize + ") /",
+                    Parts, Part + " /");
+
+  EmitLine("S = 0.0");
+  EmitLine("DO I = 1, N");
+  for(unsigned J = 0; J < Opts.LoopStatements; ++J) {
+    std::string Value = llvm::Twine(Random(1000)).str();
+    switch(Random(6)) {
+    case 0:
+      EmitLine("  A(I) = A(I) * " + Value + ".5 + X");
+      break;
+    case 1:
+      EmitLine("  S = S + A(I) * Y - " + Value + ".0");
+      break;
+    case 2:
+      EmitLine("  B(MOD(I, 64) + 1) = A(I) - Z(MOD(I, 16) + 1)");
+      break;
+    case 3:
+      EmitLine("  C(MOD(I, 8) + 1, MOD(I / 8, 8) + 1) = S * 0.5");
+      break;
+    case 4:
+      EmitLine("  IF (A(I) .LT. " + Value + ".0) A(I) = -A(I)");
+      break;
+    default:
+      EmitLine("  K(MOD(I, " + DataSize + ") + 1) = K(MOD(I, " + DataSize +
+               ") + 1) + " + Value);
+      break;
+    }
+  }
+  EmitLine("END DO");
+
+  // A long expression which is split into many continuation lines.
+  Parts.clear();
+  for(unsigned J = 0; J < Opts.Continuations; ++J)
+    Parts.push_back((llvm::Twine("+ B(") + llvm::Twine(Random(64) + 1) +
+                     ") * " + llvm::Twine(Random(100)) + ".25").str());
+  EmitContinuedStmt("S = S", Parts, "+ X * Y");
+
+  EmitLine("IF (S .GT. 100.0) THEN");
+  EmitLine("  S = 0.0");
+  EmitLine("END IF");
+  EmitLine("END SUBROUTINE");
+  OS << "\n";
+  ++Lines;
+}
+
+void SourceGenerator::EmitMainProgram() {
+  EmitLine("PROGRAM BENCH");
+  EmitLine("REAL A(100)");
+  EmitLine("INTEGER I");
+  EmitLine("DO I = 1, 100");
+  EmitLine("  A(I) = I");
+  EmitLine("END DO");
+  for(unsigned I = 0; I < Opts.ProgramUnits; ++I)
+    EmitLine((llvm::Twine("CALL SUB") + llvm::Twine(I) + "(A, 100)").str());
+  EmitLine("END PROGRAM");
+}
+
+unsigned SourceGenerator::Generate() {
+  State = Opts.Seed;
+  Lines = 0;
+  for(unsigned I = 0; I < Opts.ProgramUnits; ++I)
+    EmitSubroutine(I);
+  EmitMainProgram();
+  return Lines;
+}
+
+} // end namespace bench
+} // end namespace flang
@@ -0,0 +1,89 @@
+//===--- SourceGenerator.h - Generator of Fortran benchmark inputs --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the generator of the Fortran programs which are
+// compiled by the compiler benchmarks.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef FLANG_BENCH_SOURCEGENERATOR_H
+#define FLANG_BENCH_SOURCEGENERATOR_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <string>
+
+namespace flang {
+namespace bench {
+
+/// SourceGeneratorOptions - The shape of the generated program.
+struct SourceGeneratorOptions {
+  /// \brief Generate fixed form source instead of free form source.
+  bool FixedForm;
+
+  /// \brief The number of subroutines in the program.
+  unsigned ProgramUnits;
+
+  /// \brief The number of continuation lines used by the long statements.
+  unsigned Continuations;
+
+  /// \brief The number of elements initialized by the DATA statements.
+  unsigned DataElements;
+
+  /// \brief The number of statements in the loop of every subroutine.
+  unsigned LoopStatements;
+
+  /// \brief The seed of the pseudo random number generator.
+  uint32_t Seed;
+
+  SourceGeneratorOptions()
+    : FixedForm(false), ProgramUnits(100), Continuations(20),
+      DataElements(256), LoopStatements(16), Seed(1) {}
+};
+
+/// SourceGenerator - Generates a valid Fortran program which exercises
+/// the lexer (long lines with many continuations), the specification
+/// statements (DATA, EQUIVALENCE, COMMON) and the executable statements.
+/// The output depends only on the options, so that the results of the
+/// different benchmark runs are comparable.
+class SourceGenerator {
+  const SourceGeneratorOptions &Opts;
+  llvm::raw_ostream &OS;
+  uint32_t State;
+  unsigned Lines;
+
+  /// \brief Returns the next pseudo random number in the range [0, Max).
+  unsigned Random(unsigned Max);
+
+  /// \brief Writes a line which starts a statement.
+  void EmitLine(llvm::StringRef Line);
+
+  /// \brief Writes a statement which is split into the given parts,
+  /// one part per continuation line.
+  void EmitContinuedStmt(llvm::StringRef First,
+                         llvm::ArrayRef<std::string> Parts,
+                         llvm::StringRef Last);
+
+  void EmitSubroutine(unsigned I);
+  void EmitMainProgram();
+public:
+  SourceGenerator(const SourceGeneratorOptions &Options,
+                  llvm::raw_ostream &Out);
+
+  /// \brief Writes the program, and returns the number of lines
+  /// in it.
+  unsigned Generate();
+};
+
+} // end namespace bench
+} // end namespace flang
+
+#endif
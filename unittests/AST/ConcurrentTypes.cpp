@@ -0,0 +1,76 @@
+//===-- ConcurrentTypes.cpp - Unittests for concurrent type uniquing ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "flang/AST/ASTContext.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <thread>
+#include <vector>
+
+using namespace flang;
+
+static const unsigned NumThreads = 8;
+static const unsigned NumLengths = 64;
+
+/// Creates the same sequence of types in every thread.
+static void UniqueTypes(ASTContext *C, std::vector<const void*> *Result) {
+  for(unsigned Length = 1; Length <= NumLengths; ++Length) {
+    auto Char = C->getCharacterType(Length);
+    Result->push_back(Char);
+    Result->push_back(C->getPointerType(Char, Length % 4 + 1));
+    Result->push_back(C->getBuiltinType(BuiltinType::Integer,
+                                        Length % 2? BuiltinType::Int4 :
+                                                    BuiltinType::Int8,
+                                        true));
+    Result->push_back(C->getComplexType(C->DoublePrecisionTy).getAsOpaquePtr());
+  }
+}
+
+int test(ASTContext &C) {
+  std::vector<const void*> Types[NumThreads];
+  std::vector<std::thread> Threads;
+  for(unsigned I = 0; I < NumThreads; ++I)
+    Threads.push_back(std::thread(UniqueTypes, &C, &Types[I]));
+  for(auto &Thread : Threads)
+    Thread.join();
+
+  for(unsigned I = 1; I < NumThreads; ++I) {
+    if(Types[I].size() != Types[0].size()) {
+      llvm::errs() << "Expected the same number of types in every thread\n";
+      return 1;
+    }
+    for(size_t J = 0; J < Types[0].size(); ++J) {
+      if(Types[I][J] != Types[0][J]) {
+        llvm::errs() << "Expected the type " << J << " of thread " << I
+                     << " to be the same as in the first thread\n";
+        return 1;
+      }
+    }
+  }
+
+  // The types are uniqued in the same way without the locks.
+  C.setConcurrentAccess(false);
+  std::vector<const void*> SerialTypes;
+  UniqueTypes(&C, &SerialTypes);
+  if(SerialTypes != Types[0]) {
+    llvm::errs() << "Expected the same types after the concurrent access\n";
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  auto SM = new llvm::SourceMgr();
+  auto Context = new ASTContext(*SM, LangOptions());
+  Context->setConcurrentAccess(true);
+  auto Result = test(*Context);
+  delete Context;
+  delete SM;
+  return Result;
+}
@@ -0,0 +1,120 @@
+//===-- ASTUnit.cpp - Unittests for the incremental reparsing -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "flang/Frontend/ASTUnit.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+
+using namespace flang;
+
+static const char *Source =
+  "! The first subroutine.\n"
+  "SUBROUTINE FOO(X)\n"
+  "  INTEGER X\n"
+  "  X = 1\n"
+  "END SUBROUTINE\n"
+  "\n"
+  "INTEGER FUNCTION BAR(Y)\n"
+  "  INTEGER Y\n"
+  "  BAR = Y * 2\n"
+  "END FUNCTION\n"
+  "\n"
+  "PROGRAM P\n"
+  "  INTEGER I\n"
+  "  CALL FOO(I)\n"
+  "  I = BAR(I)\n"
+  "END PROGRAM\n";
+
+static const char *ChangedSource =
+  "! The first subroutine.\n"
+  "SUBROUTINE FOO(X)\n"
+  "  INTEGER X\n"
+  "  X = 1\n"
+  "END SUBROUTINE\n"
+  "\n"
+  "INTEGER FUNCTION BAR(Y)\n"
+  "  INTEGER Y\n"
+  "  BAR = Y * 3\n"
+  "END FUNCTION\n"
+  "\n"
+  "PROGRAM P\n"
+  "  INTEGER I\n"
+  "  CALL FOO(I)\n"
+  "  I = BAR(I)\n"
+  "END PROGRAM\n";
+
+bool CheckSplit(StringRef Src, unsigned NumUnits) {
+  SmallVector<StringRef, 8> Units;
+  SplitProgramUnits(Src, false, Units);
+  if(Units.size() != NumUnits) {
+    llvm::errs() << "Expected " << NumUnits << " program units instead of "
+                 << Units.size() << "\n";
+    return true;
+  }
+  return false;
+}
+
+bool CheckReparsed(const ASTUnit &AST, unsigned I, bool Value) {
+  if(AST.getProgramUnit(I).Reparsed != Value) {
+    llvm::errs() << "Expected the program unit " << I << " to be "
+                 << (Value? "reparsed" : "kept") << "\n";
+    return true;
+  }
+  return false;
+}
+
+int test() {
+  if(CheckSplit(Source, 3)) return 1;
+  if(CheckSplit("X = 1\nEND\n", 1)) return 1;
+  if(CheckSplit("MODULE M\nCONTAINS\nSUBROUTINE S\nEND SUBROUTINE\n"
+                "END MODULE\nREAL FUNCTION F()\nF = 1.0\nEND\n", 2))
+    return 1;
+
+  std::unique_ptr<ASTUnit> AST(ASTUnit::LoadFromSource("test.f95", Source,
+                                                       LangOptions()));
+  if(AST->hadErrors()) {
+    llvm::errs() << "Unexpected errors\n";
+    return 1;
+  }
+  if(AST->getNumProgramUnits() != 3) {
+    llvm::errs() << "Expected 3 program units\n";
+    return 1;
+  }
+
+  // Only the changed function and the program which calls it are parsed
+  // again.
+  AST->Reparse(ChangedSource);
+  if(AST->hadErrors()) {
+    llvm::errs() << "Unexpected errors after the reparse\n";
+    return 1;
+  }
+  if(CheckReparsed(*AST, 0, false)) return 1;
+  if(CheckReparsed(*AST, 1, true)) return 1;
+  if(CheckReparsed(*AST, 2, true)) return 1;
+
+  // The locations are reported in the lines of the whole source.
+  auto &Decls = AST->getProgramUnit(1).Decls;
+  unsigned Line, Column;
+  if(Decls.empty() ||
+     AST->getLineAndColumn(Decls.front()->getLocation(), Line, Column) ||
+     Line != 7) {
+    llvm::errs() << "Expected the function BAR on the line 7\n";
+    return 1;
+  }
+
+  AST->Reparse(ChangedSource);
+  for(unsigned I = 0; I < AST->getNumProgramUnits(); ++I) {
+    if(CheckReparsed(*AST, I, false)) return 1;
+  }
+  return 0;
+}
+
+int main() {
+  return test();
+}
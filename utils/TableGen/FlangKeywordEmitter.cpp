@@ -0,0 +1,80 @@
+//=== FlangKeywordEmitter.cpp - Generate Flang keyword matchers -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These tablegen backends emit the functions which recognize the keywords
+// and the format descriptors. The keywords are taken from TokenKinds.def,
+// which is compiled into this backend.
+//
+//===----------------------------------------------------------------------===//
+
+#include "TableGenBackends.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TableGen/StringMatcher.h"
+#include "llvm/TableGen/TableGenBackend.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+namespace {
+
+struct KeywordInfo {
+  const char *Name;
+  const char *Kind;
+  const char *Flags;
+};
+
+} // end anonymous namespace
+
+static const KeywordInfo Keywords[] = {
+#define KEYWORD(NAME, FLAGS) { #NAME, "kw_" #NAME, #FLAGS },
+#define FORMAT_SPEC(NAME, FLAGS)
+#define OPERATOR(NAME, FLAGS)
+#include "flang/Basic/TokenKinds.def"
+};
+
+static const KeywordInfo FormatSpecs[] = {
+#define KEYWORD(NAME, FLAGS)
+#define FORMAT_SPEC(NAME, FLAGS) { #NAME, "fs_" #NAME, #FLAGS },
+#define OPERATOR(NAME, FLAGS)
+#include "flang/Basic/TokenKinds.def"
+};
+
+/// EmitMatcher - Emits a function which returns the token kind of the given
+/// upper case spelling, and the languages which have this token.
+static void EmitMatcher(raw_ostream &OS, StringRef FunctionName,
+                        ArrayRef<KeywordInfo> Infos) {
+  std::vector<StringMatcher::StringPair> Matches;
+  size_t MaxLength = 0;
+  for(const auto &Info : Infos) {
+    Matches.push_back(StringMatcher::StringPair(Info.Name,
+      std::string("{ Flags = tok::") + Info.Flags +
+      "; return tok::" + Info.Kind + "; }"));
+    MaxLength = std::max(MaxLength, StringRef(Info.Name).size());
+  }
+
+  OS << "static const unsigned " << FunctionName << "MaxLength = "
+     << MaxLength << ";\n\n";
+  OS << "static tok::TokenKind " << FunctionName
+     << "(llvm::StringRef Name, unsigned &Flags) {\n";
+  StringMatcher("Name", Matches, OS).Emit();
+  OS << "  return tok::unknown;\n}\n\n";
+}
+
+namespace flang {
+
+void EmitFlangKeywordMatcher(RecordKeeper &Records, raw_ostream &OS) {
+  emitSourceFileHeader("Keyword and format descriptor matchers", OS);
+  EmitMatcher(OS, "MatchKeyword", Keywords);
+  EmitMatcher(OS, "MatchFormatSpec", FormatSpecs);
+}
+
+} // end namespace flang
@@ -28,7 +28,8 @@ enum ActionType {
   GenFlangDiagsIndexName,
   GenFlangDeclNodes,
   GenFlangStmtNodes,
-  GenFlangExprNodes
+  GenFlangExprNodes,
+  GenFlangKeywordMatcher
 };
 
 namespace {
@@ -47,6 +48,9 @@ namespace {
                                "Generate Flang AST statement nodes"),
                     clEnumValN(GenFlangExprNodes, "gen-flang-expr-nodes",
                                "Generate Flang AST expression nodes"),
+                    clEnumValN(GenFlangKeywordMatcher,
+                               "gen-flang-keyword-matcher",
+                               "Generate Flang keyword matchers"),
                     clEnumValEnd));
 
   cl::opt<std::string>
@@ -75,6 +79,9 @@ bool FlangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenFlangExprNodes:
     EmitFlangASTNodes(Records, OS, "Expr", "");
     break;
+  case GenFlangKeywordMatcher:
+    EmitFlangKeywordMatcher(Records, OS);
+    break;
   }
 
   return false;
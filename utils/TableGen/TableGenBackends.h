@@ -34,4 +34,6 @@ void EmitFlangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
 void EmitFlangDiagGroups(RecordKeeper &Records, raw_ostream &OS);
 void EmitFlangDiagsIndexName(RecordKeeper &Records, raw_ostream &OS);
 
+void EmitFlangKeywordMatcher(RecordKeeper &Records, raw_ostream &OS);
+
 } // end namespace flang
@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+"""
+Runs the Fortran kernels from test/Benchmarks and reports their run time.
+
+Every kernel is compiled with flang at each of the given optimization
+levels, executed a number of times, and the fastest run is reported.
+The output of a kernel has to be the same at all optimization levels.
+
+The results can be saved to a JSON file with --save, and compared with a
+previously saved file with --baseline. A kernel which is slower than the
+baseline by more than --threshold is reported as a regression, and the
+script exits with a non-zero status.
+
+The IR properties of the kernels (vectorized loops, no runtime calls in
+the hot loops) are checked by the lit tests in the same directory.
+
+Example:
+  utils/run-benchmarks.py --flang build/bin/flang -L build/lib --save base.json
+  utils/run-benchmarks.py --flang build/bin/flang -L build/lib --baseline base.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+def compile_kernel(args, source, level, work_dir):
+    name = os.path.splitext(os.path.basename(source))[0]
+    binary = os.path.join(work_dir, '%s-O%s' % (name, level))
+    cmd = [args.flang, '-O%s' % level, source, '-o', binary]
+    cmd += ['-L%s' % d for d in args.link_dirs]
+    # The driver writes the object file into the current directory.
+    if subprocess.call(cmd, cwd=work_dir) != 0 or not os.path.exists(binary):
+        raise RuntimeError('failed to compile %s at -O%s' % (source, level))
+    return binary
+
+def run_kernel(args, binary):
+    best = None
+    output = None
+    for _ in range(args.repeat):
+        start = time.time()
+        proc = subprocess.Popen([binary], stdout=subprocess.PIPE)
+        out, _ = proc.communicate()
+        elapsed = time.time() - start
+        if proc.returncode != 0:
+            raise RuntimeError('%s exited with %d' % (binary, proc.returncode))
+        if output is not None and out != output:
+            raise RuntimeError('%s printed different results' % binary)
+        output = out
+        if best is None or elapsed < best:
+            best = elapsed
+    return best, output
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--flang', default='flang',
+                        help='the flang executable')
+    parser.add_argument('-L', dest='link_dirs', action='append', default=[],
+                        help='a directory with the runtime library')
+    parser.add_argument('--levels', default='0,2,3',
+                        help='the optimization levels (default: 0,2,3)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='the number of runs of every kernel')
+    parser.add_argument('--baseline', help='compare with the saved results')
+    parser.add_argument('--save', help='save the results to a JSON file')
+    parser.add_argument('--threshold', type=float, default=0.10,
+                        help='the allowed slowdown (default: 0.10)')
+    parser.add_argument('kernels', nargs='*',
+                        help='the kernels to run (default: all of them)')
+    args = parser.parse_args()
+
+    bench_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             os.pardir, 'test', 'Benchmarks')
+    sources = args.kernels or sorted(glob.glob(os.path.join(bench_dir, '*.f95')))
+    levels = args.levels.split(',')
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    results = {}
+    failures = []
+    work_dir = tempfile.mkdtemp(prefix='flang-bench-')
+    try:
+        for source in sources:
+            name = os.path.splitext(os.path.basename(source))[0]
+            reference = None
+            for level in levels:
+                key = '%s-O%s' % (name, level)
+                try:
+                    binary = compile_kernel(args, os.path.abspath(source),
+                                            level, work_dir)
+                    seconds, output = run_kernel(args, binary)
+                except RuntimeError as e:
+                    failures.append(str(e))
+                    print('%-24s error' % key)
+                    continue
+                if reference is None:
+                    reference = output
+                elif output != reference:
+                    failures.append('%s printed different results than -O%s'
+                                    % (key, levels[0]))
+                results[key] = seconds
+
+                line = '%-24s %9.3f s' % (key, seconds)
+                if key in baseline and baseline[key] > 0:
+                    change = seconds / baseline[key] - 1.0
+                    line += '  %+6.1f%%' % (change * 100.0)
+                    if change > args.threshold:
+                        line += '  REGRESSION'
+                        failures.append('%s is %.1f%% slower than the baseline'
+                                        % (key, change * 100.0))
+                print(line)
+    finally:
+        shutil.rmtree(work_dir)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    for failure in failures:
+        print('error: %s' % failure, file=sys.stderr)
+    return 1 if failures else 0
+
+if __name__ == '__main__':
+    sys.exit(main())